@@ -0,0 +1,217 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+#include <reflect.h>
+
+// Allocation rate and resident memory of reflect_alloc() against the former malloc path with its
+// 32 byte header. Objects are spread round robin over the small structs of a reflection.dat.
+// Every mode runs in its own child process so the resident size of one doesn't count for the next.
+
+#define DEFAULT_OBJECTS 4000000
+#define MAX_TYPE_SIZE   64 // the small objects headers hurt most
+#define MAX_TYPES       64
+
+typedef enum {
+    MODE_MALLOC_HEADER, // malloc with a 32 byte header in front, what reflect_alloc() did before pools
+    MODE_ALLOCATOR,     // reflect_alloc() with an allocator, 16 byte header
+    MODE_POOL,          // reflect_alloc() without an allocator, pooled
+    MODE_ARRAY,         // one reflect_alloc_array() per type
+    MODE_ARENA,         // one reflect_arena_t per type, objects allocated one at a time
+    MODE_COUNT
+} alloc_mode_t;
+
+static const char* mode_names[MODE_COUNT] = { "malloc + 32B header", "reflect_alloc(allocator)", "reflect_alloc (pool)", "reflect_alloc_array", "reflect_arena_alloc" };
+
+static double get_time_us(void) {
+    struct timespec ts;
+    if (clock_gettime(CLOCK_MONOTONIC, &ts) != 0) {
+        perror("clock_gettime");
+        exit(EXIT_FAILURE);
+    }
+    return (ts.tv_sec * 1e6) + (ts.tv_nsec / 1e3);
+}
+
+static char* read_file(const char* path) {
+    FILE* f = fopen(path, "rb");
+    if (f == NULL) {
+        perror(path);
+        exit(EXIT_FAILURE);
+    }
+
+    fseek(f, 0, SEEK_END);
+    const long size = ftell(f);
+    rewind(f);
+
+    // the loader wants 8 byte alignment, malloc gives at least that
+    char* data = malloc(size);
+    if (fread(data, 1, size, f) != (size_t)size) {
+        fprintf(stderr, "Could not read %s\n", path);
+        exit(EXIT_FAILURE);
+    }
+    fclose(f);
+
+    return data;
+}
+
+// Resident set size in bytes, 0 where /proc isn't available
+static size_t resident_bytes(void) {
+    FILE* f = fopen("/proc/self/statm", "r");
+    size_t pages = 0, resident = 0;
+
+    if (f == NULL)
+        return 0;
+
+    if (fscanf(f, "%zu %zu", &pages, &resident) != 2)
+        resident = 0;
+    fclose(f);
+
+    return resident * (size_t)sysconf(_SC_PAGESIZE);
+}
+
+static void* malloc_allocator(void* allocator, size_t size) {
+    (void)allocator;
+    return malloc(size);
+}
+
+static void free_allocator(void* allocator, void* ptr) {
+    (void)allocator;
+    free(ptr);
+}
+
+static void run_mode(const alloc_mode_t mode, const type_info_t** types, const size_t type_count, const size_t objects) {
+    void** pointers = malloc(objects * sizeof(void*));
+    reflect_arena_t* arenas[MAX_TYPES];
+    size_t payload = 0;
+
+    for (size_t t = 0; t < type_count; t++)
+        arenas[t] = mode == MODE_ARENA ? reflect_arena_create(types[t]) : NULL;
+
+    // touch the pointer array first so it isn't part of the measured growth
+    memset(pointers, 0, objects * sizeof(void*));
+    const size_t rss_before = resident_bytes();
+    const double start = get_time_us();
+
+    if (mode == MODE_ARRAY) {
+        for (size_t t = 0; t < type_count; t++) {
+            const size_t count = objects / type_count;
+            char* array = reflect_alloc_array(types[t], count);
+            for (size_t i = 0; i < count; i++)
+                pointers[t * count + i] = array + i * types[t]->size;
+        }
+    } else {
+        for (size_t i = 0; i < objects; i++) {
+            const type_info_t* type = types[i % type_count];
+
+            if (mode == MODE_MALLOC_HEADER)
+                pointers[i] = (char*)malloc(32 + type->size) + 32;
+            else if (mode == MODE_ALLOCATOR)
+                pointers[i] = reflect_alloc(type, NULL, malloc_allocator);
+            else if (mode == MODE_ARENA)
+                pointers[i] = reflect_arena_alloc(arenas[i % type_count], 1);
+            else
+                pointers[i] = reflect_alloc(type, NULL, NULL);
+        }
+    }
+
+    const double allocated = get_time_us();
+
+    // write every object so all of it is resident, arrays hold their type's objects consecutively
+    for (size_t i = 0; i < objects; i++) {
+        if (pointers[i] != NULL) {
+            const size_t size = types[mode == MODE_ARRAY ? i / (objects / type_count) : i % type_count]->size;
+            memset(pointers[i], 1, size);
+            payload += size;
+        }
+    }
+
+    const size_t rss = resident_bytes() - rss_before;
+    const double free_start = get_time_us();
+
+    if (mode == MODE_ARRAY) {
+        for (size_t t = 0; t < type_count; t++)
+            reflect_free(pointers[t * (objects / type_count)], NULL, NULL);
+    } else if (mode == MODE_ARENA) {
+        for (size_t t = 0; t < type_count; t++)
+            reflect_arena_destroy(arenas[t]);
+    } else {
+        for (size_t i = 0; i < objects; i++) {
+            if (mode == MODE_MALLOC_HEADER)
+                free((char*)pointers[i] - 32);
+            else if (mode == MODE_ALLOCATOR)
+                reflect_free(pointers[i], NULL, free_allocator);
+            else
+                reflect_free(pointers[i], NULL, NULL);
+        }
+    }
+
+    const double freed = get_time_us();
+
+    printf("%-26s %10.1f %10.1f %10.1f %9.2fx\n", mode_names[mode], objects / (allocated - start), objects / (freed - free_start),
+           rss / 1e6, payload ? (double)rss / payload : 0.0);
+
+    free(pointers);
+}
+
+/*
+ *   Usage: ./alloc_benchmark <reflection.dat> [objects]
+ *   A large blob can be made with gen_synthetic.py --layouts and merge.py.
+ */
+int main(int argc, char *argv[]) {
+    if (argc < 2) {
+        fprintf(stderr, "Usage: %s <reflection.dat> [objects]\n", argv[0]);
+        return 1;
+    }
+
+    size_t objects = DEFAULT_OBJECTS;
+    if (argc > 2) {
+        const long value = atol(argv[2]);
+        if (value <= 0) {
+            fprintf(stderr, "Invalid number of objects specified: %s\n", argv[2]);
+            return 1;
+        }
+        objects = value;
+    }
+
+    char* blob = read_file(argv[1]);
+    reflect_load_bytes(blob, false);
+
+    const type_info_t* types[MAX_TYPES];
+    size_t type_count = 0, total_size = 0;
+
+    for (size_t id = 1; reflect_type_info_from_id(id) != NULL && type_count < MAX_TYPES; id++) {
+        const type_info_t* type = reflect_type_info_from_id(id);
+
+        if (type->variant == Struct && type->size > 0 && type->size <= MAX_TYPE_SIZE) {
+            types[type_count++] = type;
+            total_size += type->size;
+        }
+    }
+
+    if (type_count == 0) {
+        fprintf(stderr, "No struct of %s is at most %d bytes\n", argv[1], MAX_TYPE_SIZE);
+        return 1;
+    }
+
+    objects -= objects % type_count;
+    printf("%zu objects over %zu structs, %.1f bytes on average\n", objects, type_count, (double)total_size / type_count);
+    printf("%-26s %10s %10s %10s %10s\n", "", "M alloc/s", "M free/s", "RSS MB", "RSS/data");
+
+    for (int mode = 0; mode < MODE_COUNT; mode++) {
+        fflush(stdout);
+        const pid_t child = fork();
+
+        if (child == 0) {
+            run_mode(mode, types, type_count, objects);
+            exit(EXIT_SUCCESS);
+        }
+
+        waitpid(child, NULL, 0);
+    }
+
+    free(blob);
+    return 0;
+}
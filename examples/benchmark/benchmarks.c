@@ -20,9 +20,14 @@ static double get_time_us(void) {
 typedef struct {
     int num_structs;
     char **type_names;
+    // filled by init_field_names() once the data is loaded, types that aren't found have no fields
+    const type_info_t **types;
+    const char ***field_names;
+    size_t *field_counts;
+    const field_info_t **field_out; // room for the fields of the largest type
 } bench_config_t;
 
-static bench_config_t g_cfg = { DEFAULT_NUM_STRUCTS, NULL };
+static bench_config_t g_cfg = { DEFAULT_NUM_STRUCTS, NULL, NULL, NULL, NULL, NULL };
 
 static void init_type_names(void) {
     const int n = g_cfg.num_structs;
@@ -48,11 +53,70 @@ static void free_type_names(void) {
     free(g_cfg.type_names);
 }
 
+// The names of every field of every type, so the field benchmarks time nothing but the lookups
+static void init_field_names(void) {
+    if (g_cfg.types) {
+        return;
+    }
+
+    const int n = g_cfg.num_structs;
+    size_t max_fields = 1;
+
+    g_cfg.types = calloc(n, sizeof(const type_info_t *));
+    g_cfg.field_names = calloc(n, sizeof(const char **));
+    g_cfg.field_counts = calloc(n, sizeof(size_t));
+    if (!g_cfg.types || !g_cfg.field_names || !g_cfg.field_counts) {
+        perror("calloc");
+        exit(EXIT_FAILURE);
+    }
+
+    reflect_load();
+    reflect_type_info_from_names((const char **)g_cfg.type_names, n, g_cfg.types);
+
+    for (int i = 0; i < n; i++) {
+        const type_info_t *type = g_cfg.types[i];
+        const size_t count = type ? (size_t)(reflect_field_info_iter_end(type) - reflect_field_info_iter_begin(type)) : 0;
+
+        g_cfg.field_names[i] = malloc((count > 0 ? count : 1) * sizeof(const char *));
+        if (!g_cfg.field_names[i]) {
+            perror("malloc");
+            exit(EXIT_FAILURE);
+        }
+        for (size_t j = 0; j < count; j++) {
+            g_cfg.field_names[i][j] = reflect_field_info_iter_begin(type)[j].name;
+        }
+        g_cfg.field_counts[i] = count;
+        if (count > max_fields) {
+            max_fields = count;
+        }
+    }
+
+    g_cfg.field_out = malloc(max_fields * sizeof(const field_info_t *));
+    if (!g_cfg.field_out) {
+        perror("malloc");
+        exit(EXIT_FAILURE);
+    }
+}
+
+static void free_field_names(void) {
+    if (!g_cfg.types) {
+        return;
+    }
+    for (int i = 0; i < g_cfg.num_structs; i++) {
+        free(g_cfg.field_names[i]);
+    }
+    free(g_cfg.field_names);
+    free(g_cfg.field_counts);
+    free(g_cfg.field_out);
+    free(g_cfg.types);
+}
+
 typedef void (*benchmark_func_t)(void);
 
 typedef struct {
     const char *name;
     benchmark_func_t func;
+    benchmark_func_t setup; // run once before the timed runs, may be NULL
 } benchmark_t;
 
 static void bench_reflect_load(void) {
@@ -75,6 +139,35 @@ static void bench_reflect_field_info(void) {
     }
 }
 
+// Same lookups as above, resolved through the batched API
+static void bench_reflect_type_info_batched(void) {
+    static const type_info_t* out[DEFAULT_NUM_STRUCTS];
+    const char** names = (const char**)g_cfg.type_names;
+
+    for (int start = 0; start < g_cfg.num_structs; start += DEFAULT_NUM_STRUCTS) {
+        const int n = g_cfg.num_structs - start < DEFAULT_NUM_STRUCTS ? g_cfg.num_structs - start : DEFAULT_NUM_STRUCTS;
+        reflect_type_info_from_names(names + start, n, out);
+    }
+}
+
+// Every field of every type by name, one lookup per name
+static void bench_reflect_field_types(void) {
+    for (int i = 0; i < g_cfg.num_structs; i++) {
+        for (size_t j = 0; j < g_cfg.field_counts[i]; j++) {
+            g_cfg.field_out[j] = reflect_get_field_type(g_cfg.types[i], g_cfg.field_names[i][j]);
+        }
+    }
+}
+
+// The same lookups, one batch per type
+static void bench_reflect_field_types_batched(void) {
+    for (int i = 0; i < g_cfg.num_structs; i++) {
+        if (g_cfg.field_counts[i] > 0) {
+            reflect_get_field_types(g_cfg.types[i], g_cfg.field_names[i], g_cfg.field_counts[i], g_cfg.field_out);
+        }
+    }
+}
+
 static void run_benchmark(const benchmark_t *bm, int num_runs) {
     double *times = malloc(num_runs * sizeof(double));
     if (!times) {
@@ -82,6 +175,10 @@ static void run_benchmark(const benchmark_t *bm, int num_runs) {
         exit(EXIT_FAILURE);
     }
 
+    if (bm->setup) {
+        bm->setup();
+    }
+
     for (int i = 0; i < num_runs; i++) {
         const double start = get_time_us();
         bm->func();
@@ -133,9 +230,12 @@ int main(int argc, char *argv[]) {
     init_type_names();
 
     const benchmark_t benchmarks[] = {
-        { "reflect_load",                bench_reflect_load },
-        { "reflect_type_info_from_name", bench_reflect_type_info },
-        { "reflect_get_field_type",      bench_reflect_field_info }
+        { "reflect_load",                bench_reflect_load, NULL },
+        { "reflect_type_info_from_name", bench_reflect_type_info, NULL },
+        { "reflect_get_field_type",      bench_reflect_field_info, NULL },
+        { "reflect_type_info_from_names (batched)", bench_reflect_type_info_batched, NULL },
+        { "reflect_get_field_type (all fields)", bench_reflect_field_types, init_field_names },
+        { "reflect_get_field_types (batched)", bench_reflect_field_types_batched, init_field_names }
     };
 
     const size_t numBenchmarks = sizeof(benchmarks) / sizeof(benchmark_t);
@@ -145,6 +245,7 @@ int main(int argc, char *argv[]) {
         run_benchmark(&benchmarks[i], num_runs);
     }
 
+    free_field_names();
     free_type_names();
     return 0;
 }
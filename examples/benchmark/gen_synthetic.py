@@ -107,6 +107,70 @@ def generate_field(indent=""):
     lines.append(indent + "isstruct " + random_bool_str(0.2))
     return "\n".join(lines)
 
+# --layouts: real C base types and fields packed into their struct, for benchmarks that touch values
+LAYOUT_BASES = [("char", 1), ("short", 2), ("int", 4), ("unsigned int", 4), ("long", 8), ("float", 4), ("double", 8)]
+POINTER_SIZE = 8
+
+def generate_layout_bases():
+    entries = []
+    for name, size in LAYOUT_BASES:
+        entries.append("base\nname {}\nsize {}".format(name, size))
+    return "\n".join(entries)
+
+def generate_layout_field(offset, earlier_structs, indent=""):
+    """Returns the field text and its end, earlier structs (name, size, align) can be embedded"""
+    pdepth = random.choice([0, 0, 0, 0, 1, 2])
+    arrsize = random.choice([0, 0, 0, random.randint(1, 10)])
+
+    # only small structs are embedded, nesting would make sizes grow without bound otherwise
+    small_structs = [entry for entry in earlier_structs[-64:] if entry[1] <= 64]
+    if small_structs and random.random() < 0.15:
+        field_type, size, align = random.choice(small_structs)
+        is_struct = "true"
+    else:
+        field_type, size = random.choice(LAYOUT_BASES)
+        align = size
+        is_struct = "false"
+
+    if pdepth > 0:
+        size = align = POINTER_SIZE
+
+    offset = (offset + align - 1) // align * align
+
+    lines = [
+        indent + "field",
+        indent + "name f" + next_field_identifier(),
+        indent + "type " + field_type,
+        indent + "offset " + str(offset),
+        indent + "pdepth " + str(pdepth),
+        indent + "arrsize " + str(arrsize),
+        indent + "const " + random_bool_str(0.3),
+        indent + "isstruct " + is_struct,
+    ]
+    return "\n".join(lines), offset + size * max(arrsize, 1), align
+
+def generate_layout_struct_entry(num_fields, earlier_structs):
+    sid = next_struct_identifier()
+    name = "struct_" + sid
+
+    fields = []
+    offset = 0
+    max_align = 1
+    for _ in range(num_fields):
+        text, offset, align = generate_layout_field(offset, earlier_structs)
+        fields.append(text)
+        max_align = max(max_align, align)
+
+    size = max((offset + max_align - 1) // max_align * max_align, 1)
+    lines = ["struct", "name " + name]
+    if random.random() < 0.3:
+        lines.append("alias alias_" + next_alias_identifier())
+    lines.append("size " + str(size))
+    lines.extend(fields)
+
+    earlier_structs.append((name, size, max_align))
+    return "\n".join(lines)
+
 def generate_union_entry(_, num_fields):
     lines = []
     lines.append("union")
@@ -164,6 +228,8 @@ def main():
     parser.add_argument("--fields", type=int, default=3, help="Number of fields per union/struct")
     parser.add_argument("--enumerators", type=int, default=4, help="Number of enumerators per enum")
     parser.add_argument("--output", type=str, default="synthetic_data.txt", help="Output file name")
+    parser.add_argument("--layouts", action="store_true",
+                        help="Structs with real base types and consistent offsets, for serialization benchmarks")
     args = parser.parse_args()
     
     with open(args.output, "w") as f:
@@ -175,8 +241,15 @@ def main():
         for i in range(args.unions):
             f.write(generate_union_entry(i, args.fields) + "\n")
         
+        if args.layouts:
+            f.write(generate_layout_bases() + "\n")
+
+        earlier_structs = []
         for i in range(args.structs):
-            f.write(generate_struct_entry(i, args.fields) + "\n")
+            if args.layouts:
+                f.write(generate_layout_struct_entry(args.fields, earlier_structs) + "\n")
+            else:
+                f.write(generate_struct_entry(i, args.fields) + "\n")
         
         for i in range(args.enums):
             f.write(generate_enum_entry(i, args.enumerators) + "\n")
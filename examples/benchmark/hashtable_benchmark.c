@@ -0,0 +1,220 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <stdbool.h>
+
+// The runtime name table used when reflection.dat carries no prebuilt index
+#include "../../src/hashtable.c"
+
+#define DEFAULT_NUM_LOOKUPS 1000000
+#define NUM_ROUNDS          7 // best round is reported
+#define TYPE_NAME_SIZE      32
+
+/* Previous chained implementation, kept here as the baseline */
+
+typedef struct ChainedBucket {
+    hash_t data;
+    struct ChainedBucket* next;
+} chained_bucket_t;
+
+typedef struct {
+    chained_bucket_t* data;
+    size_t capacity;
+} chained_table_t;
+
+static uint32_t chained_hash(const char *key) {
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; key[i]; i++) {
+        hash ^= (uint8_t)key[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+static chained_table_t chained_create(const size_t capacity) {
+    const chained_table_t ht = {
+        .capacity = capacity,
+        .data = calloc(capacity, sizeof(chained_bucket_t)),
+    };
+    return ht;
+}
+
+static size_t chained_get(const chained_table_t *ht, const char *key) {
+    const chained_bucket_t* bucket = ht->data + chained_hash(key) % ht->capacity;
+
+    while (bucket != NULL) {
+        if (bucket->data.name == NULL)
+            return -1;
+        if (strcmp(bucket->data.name, key) == 0)
+            return bucket->data.id;
+        bucket = bucket->next;
+    }
+    return -1;
+}
+
+static void chained_insert(const chained_table_t* ht, const hash_t* value) {
+    chained_bucket_t* entry = ht->data + chained_hash(value->name) % ht->capacity;
+
+    if (entry->data.name == NULL) {
+        entry->data = *value;
+        entry->next = NULL;
+        return;
+    }
+
+    while (entry != NULL) {
+        if (strcmp(entry->data.name, value->name) == 0) {
+            entry->data = *value;
+            return;
+        }
+        if (entry->next == NULL) {
+            entry->next = malloc(sizeof(chained_bucket_t));
+            entry->next->data = *value;
+            entry->next->next = NULL;
+            return;
+        }
+        entry = entry->next;
+    }
+}
+
+static void chained_destroy(chained_table_t* ht) {
+    for (size_t i = 0; i < ht->capacity; i++) {
+        chained_bucket_t* entry = ht->data[i].next;
+        while (entry != NULL) {
+            chained_bucket_t* next = entry->next;
+            free(entry);
+            entry = next;
+        }
+    }
+    free(ht->data);
+}
+
+static double get_time_us(void) {
+    struct timespec ts;
+    if (clock_gettime(CLOCK_MONOTONIC, &ts) != 0) {
+        perror("clock_gettime");
+        exit(EXIT_FAILURE);
+    }
+    return (ts.tv_sec * 1e6) + (ts.tv_nsec / 1e3);
+}
+
+static char** make_names(const char* prefix, const int n) {
+    char** names = malloc(n * sizeof(char*));
+    for (int i = 0; i < n; i++) {
+        names[i] = malloc(TYPE_NAME_SIZE);
+        snprintf(names[i], TYPE_NAME_SIZE, "%s_%d", prefix, i);
+    }
+    return names;
+}
+
+// lookup order, scrambled so the access pattern isn't sequential
+static char** make_order(char** names, const int n) {
+    char** order = malloc(n * sizeof(char*));
+    for (int i = 0; i < n; i++)
+        order[i] = names[(size_t)i * 7919 % n];
+    return order;
+}
+
+static void free_names(char** names, const int n) {
+    for (int i = 0; i < n; i++)
+        free(names[i]);
+    free(names);
+}
+
+static double bench_swiss(const hashtable_t* ht, char** keys, const int n, const int lookups, const bool expect_hit) {
+    volatile size_t sink = 0;
+    double best = 0;
+
+    for (int round = 0; round < NUM_ROUNDS; round++) {
+        const double start = get_time_us();
+        for (int i = 0, k = 0; i < lookups; i++, k = k + 1 == n ? 0 : k + 1) {
+            const size_t id = hashtable_get(ht, keys[k]);
+            if ((id != (size_t)-1) != expect_hit) {
+                fprintf(stderr, "swiss table returned a wrong result\n");
+                exit(EXIT_FAILURE);
+            }
+            sink += id;
+        }
+        const double elapsed = get_time_us() - start;
+        if (round == 0 || elapsed < best)
+            best = elapsed;
+    }
+
+    return best * 1e3 / lookups;
+}
+
+static double bench_chained(const chained_table_t* ht, char** keys, const int n, const int lookups, const bool expect_hit) {
+    volatile size_t sink = 0;
+    double best = 0;
+
+    for (int round = 0; round < NUM_ROUNDS; round++) {
+        const double start = get_time_us();
+        for (int i = 0, k = 0; i < lookups; i++, k = k + 1 == n ? 0 : k + 1) {
+            const size_t id = chained_get(ht, keys[k]);
+            if ((id != (size_t)-1) != expect_hit) {
+                fprintf(stderr, "chained table returned a wrong result\n");
+                exit(EXIT_FAILURE);
+            }
+            sink += id;
+        }
+        const double elapsed = get_time_us() - start;
+        if (round == 0 || elapsed < best)
+            best = elapsed;
+    }
+
+    return best * 1e3 / lookups;
+}
+
+/*
+ *   Usage: ./hashtable_benchmark [num_lookups]
+ */
+int main(int argc, char *argv[]) {
+    int num_lookups = DEFAULT_NUM_LOOKUPS;
+    const int sizes[] = { 100, 2000, 50000 };
+
+    // name hashing for the loader and blob indexes, the table itself doesn't use them
+    (void)hash_fnv1a64;
+    (void)hash_mix64;
+
+    if (argc > 1) {
+        num_lookups = atoi(argv[1]);
+        if (num_lookups <= 0) {
+            fprintf(stderr, "Invalid number of lookups specified: %s\n", argv[1]);
+            return 1;
+        }
+    }
+
+    printf("%8s %14s %14s %14s %14s\n", "types", "chained hit", "swiss hit", "chained miss", "swiss miss");
+
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+        const int n = sizes[s];
+        char** names = make_names("struct", n);
+        char** missing = make_names("missing", n);
+        char** hit_order = make_order(names, n);
+        char** miss_order = make_order(missing, n);
+
+        // same sizing as the loader, twice the entry count
+        chained_table_t chained = chained_create(n * 2);
+        hashtable_t swiss = hashtable_create(n * 2);
+
+        for (int i = 0; i < n; i++) {
+            chained_insert(&chained, &(hash_t){ .name = names[i], .id = i });
+            hashtable_insert(&swiss, &(hash_t){ .name = names[i], .id = i });
+        }
+
+        printf("%8d %11.2f ns %11.2f ns %11.2f ns %11.2f ns\n", n,
+               bench_chained(&chained, hit_order, n, num_lookups, true),
+               bench_swiss(&swiss, hit_order, n, num_lookups, true),
+               bench_chained(&chained, miss_order, n, num_lookups, false),
+               bench_swiss(&swiss, miss_order, n, num_lookups, false));
+
+        chained_destroy(&chained);
+        hashtable_destroy(&swiss);
+        free(hit_order);
+        free(miss_order);
+        free_names(names, n);
+        free_names(missing, n);
+    }
+
+    return 0;
+}
@@ -0,0 +1,213 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <reflect.h>
+
+// JSON write and read throughput over every struct of a reflection.dat a JSON plan can be compiled for.
+// MB/s is measured over the JSON text.
+
+#define DEFAULT_VALUES_PER_TYPE 64
+#define NUM_ROUNDS              5 // best round is reported
+
+typedef struct {
+    const type_info_t* type;
+    reflect_json_plan_t* plan;
+    char* values;
+} bench_type_t;
+
+static double get_time_us(void) {
+    struct timespec ts;
+    if (clock_gettime(CLOCK_MONOTONIC, &ts) != 0) {
+        perror("clock_gettime");
+        exit(EXIT_FAILURE);
+    }
+    return (ts.tv_sec * 1e6) + (ts.tv_nsec / 1e3);
+}
+
+static char* read_file(const char* path) {
+    FILE* f = fopen(path, "rb");
+    if (f == NULL) {
+        perror(path);
+        exit(EXIT_FAILURE);
+    }
+
+    fseek(f, 0, SEEK_END);
+    const long size = ftell(f);
+    rewind(f);
+
+    // the loader wants 8 byte alignment, malloc gives at least that
+    char* data = malloc(size);
+    if (fread(data, 1, size, f) != (size_t)size) {
+        fprintf(stderr, "Could not read %s\n", path);
+        exit(EXIT_FAILURE);
+    }
+    fclose(f);
+
+    return data;
+}
+
+// Random integers, floats with a few decimals and short printable strings, closer to real payloads
+// than random bytes. Pointers are NULL, plans follow them and random ones would crash.
+static void fill_fields(const type_info_t* type, char* value) {
+    for (const field_info_t* it = reflect_field_info_iter_begin(type); it != reflect_field_info_iter_end(type); ++it) {
+        const size_t count = it->arr_size > 0 ? it->arr_size : 1;
+        const size_t element = it->ptr_depth > 0 ? sizeof(void*) : it->type_ptr->size;
+        char* field = value + it->offset;
+
+        if (it->offset + element * count > type->size)
+            continue;
+
+        for (size_t i = 0; i < count; i++, field += element) {
+            if (it->ptr_depth > 0) {
+                memset(field, 0, element);
+            } else if (it->type_ptr->variant == Struct || it->type_ptr->variant == Union) {
+                fill_fields(it->type_ptr, field);
+            } else if (strcmp(it->type_ptr->name, "double") == 0) {
+                const double number = (rand() % 2000000 - 1000000) / 100.0;
+                memcpy(field, &number, sizeof(number));
+            } else if (strcmp(it->type_ptr->name, "float") == 0) {
+                const float number = (rand() % 200000 - 100000) / 100.0f;
+                memcpy(field, &number, sizeof(number));
+            } else if (strcmp(it->type_ptr->name, "char") == 0 && it->arr_size > 0) {
+                *field = i + 1 == count || rand() % 8 == 0 ? 0 : (char)('a' + rand() % 26);
+            }
+        }
+    }
+}
+
+static void fill_value(const type_info_t* type, char* value) {
+    for (size_t i = 0; i < type->size; i++)
+        value[i] = (char)rand();
+
+    fill_fields(type, value);
+}
+
+static double run_write(const bench_type_t* types, const size_t type_count, const size_t values, reflect_json_writer_t* writer) {
+    const double start = get_time_us();
+
+    writer->pos = 0;
+    for (size_t t = 0; t < type_count; t++) {
+        const size_t size = types[t].type->size;
+        for (size_t i = 0; i < values; i++)
+            reflect_json_plan_write(types[t].plan, types[t].values + i * size, writer);
+    }
+
+    return get_time_us() - start;
+}
+
+static double run_read(const bench_type_t* types, const size_t type_count, const size_t values, reflect_json_reader_t* reader) {
+    const double start = get_time_us();
+
+    reader->pos = 0;
+    for (size_t t = 0; t < type_count; t++) {
+        const size_t size = types[t].type->size;
+        for (size_t i = 0; i < values; i++) {
+            if (!reflect_json_plan_read(types[t].plan, reader, types[t].values + i * size)) {
+                fprintf(stderr, "Reading %s back failed at %zu\n", types[t].type->name, reader->pos);
+                exit(EXIT_FAILURE);
+            }
+        }
+    }
+
+    return get_time_us() - start;
+}
+
+/*
+ *   Usage: ./json_benchmark <reflection.dat> [values_per_type]
+ *   A large blob can be made with gen_synthetic.py and merge.py.
+ */
+int main(int argc, char *argv[]) {
+    if (argc < 2) {
+        fprintf(stderr, "Usage: %s <reflection.dat> [values_per_type]\n", argv[0]);
+        return 1;
+    }
+
+    size_t values = DEFAULT_VALUES_PER_TYPE;
+    if (argc > 2) {
+        const long value = atol(argv[2]);
+        if (value <= 0) {
+            fprintf(stderr, "Invalid number of values specified: %s\n", argv[2]);
+            return 1;
+        }
+        values = value;
+    }
+
+    char* blob = read_file(argv[1]);
+    reflect_load_bytes(blob, false);
+
+    size_t struct_count = 0, type_count = 0;
+    bench_type_t* types = NULL;
+
+    for (size_t id = 1; reflect_type_info_from_id(id) != NULL; id++) {
+        const type_info_t* type = reflect_type_info_from_id(id);
+
+        if (type->variant != Struct)
+            continue;
+
+        struct_count++;
+        reflect_json_plan_t* plan = reflect_json_plan_compile(type);
+
+        // synthetic layouts can have fields outside of their struct
+        if (plan == NULL)
+            continue;
+
+        bench_type_t bench = { .type = type, .plan = plan, .values = malloc(type->size * values) };
+        for (size_t i = 0; i < values; i++)
+            fill_value(type, bench.values + i * type->size);
+
+        types = realloc(types, (type_count + 1) * sizeof(bench_type_t));
+        types[type_count++] = bench;
+    }
+
+    if (type_count == 0) {
+        fprintf(stderr, "No struct of %s can be written as JSON\n", argv[1]);
+        return 1;
+    }
+
+    // one sizing pass without a buffer, writes then fail but pos counts nothing, so grow until it fits
+    size_t capacity = 1 << 20;
+    reflect_json_writer_t writer = { 0 };
+    for (;;) {
+        writer = (reflect_json_writer_t){ .buf = malloc(capacity), .size = capacity };
+        run_write(types, type_count, values, &writer);
+
+        if (!writer.failed)
+            break;
+
+        free(writer.buf);
+        capacity *= 2;
+    }
+
+    // the first read normalizes the values (NaN becomes null and so on), later writes match it
+    reflect_json_reader_t reader = { .data = writer.buf, .size = writer.pos };
+    run_read(types, type_count, values, &reader);
+
+    double write = 0, read = 0;
+    for (int round = 0; round < NUM_ROUNDS; round++) {
+        const double write_round = run_write(types, type_count, values, &writer);
+        reader.size = writer.pos;
+        const double read_round = run_read(types, type_count, values, &reader);
+
+        if (round == 0 || write_round < write)
+            write = write_round;
+        if (round == 0 || read_round < read)
+            read = read_round;
+    }
+
+    printf("%zu of %zu structs, %zu values each, %.2f MB of JSON\n", type_count, struct_count, values, writer.pos / 1e6);
+    printf("%-24s %10s\n", "", "MB/s");
+    printf("%-24s %10.2f\n", "reflect_json_plan_write", writer.pos / write);
+    printf("%-24s %10.2f\n", "reflect_json_plan_read", writer.pos / read);
+
+    for (size_t i = 0; i < type_count; i++) {
+        reflect_json_plan_free(types[i].plan);
+        free(types[i].values);
+    }
+    free(types);
+    free(writer.buf);
+    free(blob);
+
+    return 0;
+}
@@ -0,0 +1,193 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+
+#include <reflect.h>
+
+// Lookup throughput with 1 to 64 reader threads sharing one loaded reflection.dat.
+// Every thread also calls reflect_load_bytes(), which returns at once when the blob is already loaded.
+
+#define DEFAULT_LOOKUPS_PER_THREAD 1000000
+#define MAX_THREADS                64
+#define NUM_ROUNDS                 3 // best round is reported
+
+typedef struct {
+    char* blob;
+    const char** type_names;
+    const char** field_names; // a field of the type with the same index, NULL if it has none
+    size_t name_count;
+    size_t lookups;
+    size_t thread_index;
+    pthread_barrier_t* barrier;
+} thread_args_t;
+
+static double get_time_us(void) {
+    struct timespec ts;
+    if (clock_gettime(CLOCK_MONOTONIC, &ts) != 0) {
+        perror("clock_gettime");
+        exit(EXIT_FAILURE);
+    }
+    return (ts.tv_sec * 1e6) + (ts.tv_nsec / 1e3);
+}
+
+static char* read_file(const char* path) {
+    FILE* f = fopen(path, "rb");
+    if (f == NULL) {
+        perror(path);
+        exit(EXIT_FAILURE);
+    }
+
+    fseek(f, 0, SEEK_END);
+    const long size = ftell(f);
+    rewind(f);
+
+    // the loader wants 8 byte alignment, malloc gives at least that
+    char* data = malloc(size);
+    if (fread(data, 1, size, f) != (size_t)size) {
+        fprintf(stderr, "Could not read %s\n", path);
+        exit(EXIT_FAILURE);
+    }
+    fclose(f);
+
+    return data;
+}
+
+static void* lookup_thread(void* arg) {
+    const thread_args_t* args = arg;
+    size_t sink = 0;
+
+    reflect_load_bytes(args->blob, false);
+    pthread_barrier_wait(args->barrier);
+
+    // each thread walks the names with its own stride so they don't move in lockstep
+    size_t k = args->thread_index * 7919 % args->name_count;
+    for (size_t i = 0; i < args->lookups; i++) {
+        const type_info_t* type = reflect_type_info_from_name(args->type_names[k]);
+
+        if (type == NULL) {
+            fprintf(stderr, "Lookup of %s failed\n", args->type_names[k]);
+            exit(EXIT_FAILURE);
+        }
+
+        if (args->field_names[k] != NULL)
+            sink += reflect_get_field_type(type, args->field_names[k])->offset;
+
+        sink += type->id;
+        k += 7919;
+        while (k >= args->name_count)
+            k -= args->name_count;
+    }
+
+    return (void*)sink;
+}
+
+static double run_round(thread_args_t* template, const size_t thread_count) {
+    pthread_t threads[MAX_THREADS];
+    thread_args_t args[MAX_THREADS];
+    pthread_barrier_t barrier;
+
+    // the main thread joins the barrier too, so the clock starts with every reader ready
+    pthread_barrier_init(&barrier, NULL, thread_count + 1);
+
+    for (size_t i = 0; i < thread_count; i++) {
+        args[i] = *template;
+        args[i].thread_index = i;
+        args[i].barrier = &barrier;
+        pthread_create(&threads[i], NULL, lookup_thread, &args[i]);
+    }
+
+    pthread_barrier_wait(&barrier);
+    const double start = get_time_us();
+
+    for (size_t i = 0; i < thread_count; i++)
+        pthread_join(threads[i], NULL);
+
+    const double elapsed = get_time_us() - start;
+    pthread_barrier_destroy(&barrier);
+
+    return elapsed;
+}
+
+/*
+ *   Usage: ./mt_benchmark <reflection.dat> [lookups_per_thread]
+ *   A large blob can be made with gen_synthetic.py and merge.py.
+ */
+int main(int argc, char *argv[]) {
+    if (argc < 2) {
+        fprintf(stderr, "Usage: %s <reflection.dat> [lookups_per_thread]\n", argv[0]);
+        return 1;
+    }
+
+    size_t lookups = DEFAULT_LOOKUPS_PER_THREAD;
+    if (argc > 2) {
+        const long value = atol(argv[2]);
+        if (value <= 0) {
+            fprintf(stderr, "Invalid number of lookups specified: %s\n", argv[2]);
+            return 1;
+        }
+        lookups = value;
+    }
+
+    char* blob = read_file(argv[1]);
+
+    // collect the names once up front, lookups then only go through the name API
+    reflect_load_bytes(blob, false);
+
+    size_t name_count = 0;
+    while (reflect_type_info_from_id(name_count + 1) != NULL)
+        name_count++;
+
+    if (name_count == 0) {
+        fprintf(stderr, "%s holds no types\n", argv[1]);
+        return 1;
+    }
+
+    const char** type_names = malloc(name_count * sizeof(char*));
+    const char** field_names = malloc(name_count * sizeof(char*));
+
+    for (size_t i = 0; i < name_count; i++) {
+        const type_info_t* type = reflect_type_info_from_id(i + 1);
+        type_names[i] = type->name;
+        field_names[i] = NULL;
+
+        if ((type->variant == Struct || type->variant == Union) && type->field_count > 0 &&
+            reflect_field_info_iter_begin(type)->name[0] != 0)
+            field_names[i] = reflect_field_info_iter_begin(type)->name;
+    }
+
+    thread_args_t template = {
+        .blob = blob,
+        .type_names = type_names,
+        .field_names = field_names,
+        .name_count = name_count,
+        .lookups = lookups,
+    };
+
+    printf("%zu types, %zu lookups per thread\n", name_count, lookups);
+    printf("%8s %16s %12s\n", "threads", "Mlookups/s", "speedup");
+
+    double single = 0;
+    for (size_t thread_count = 1; thread_count <= MAX_THREADS; thread_count *= 2) {
+        double best = 0;
+
+        for (int round = 0; round < NUM_ROUNDS; round++) {
+            const double elapsed = run_round(&template, thread_count);
+            if (round == 0 || elapsed < best)
+                best = elapsed;
+        }
+
+        const double rate = (double)lookups * thread_count / best;
+        if (thread_count == 1)
+            single = rate;
+
+        printf("%8zu %16.2f %11.2fx\n", thread_count, rate, rate / single);
+    }
+
+    free(type_names);
+    free(field_names);
+    free(blob);
+
+    return 0;
+}
@@ -0,0 +1,217 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <reflect.h>
+
+// Serialization plan throughput against a hand-written memcpy of the same values, over every struct
+// of a reflection.dat a plan can be compiled for. Values are random bytes with all pointers NULL.
+
+#define DEFAULT_VALUES_PER_TYPE 256
+#define NUM_ROUNDS              5 // best round is reported
+
+typedef struct {
+    const type_info_t* type;
+    reflect_plan_t* plan;
+    char* values;
+    char* serialized;
+    size_t serialized_size;
+} bench_type_t;
+
+static double get_time_us(void) {
+    struct timespec ts;
+    if (clock_gettime(CLOCK_MONOTONIC, &ts) != 0) {
+        perror("clock_gettime");
+        exit(EXIT_FAILURE);
+    }
+    return (ts.tv_sec * 1e6) + (ts.tv_nsec / 1e3);
+}
+
+static char* read_file(const char* path) {
+    FILE* f = fopen(path, "rb");
+    if (f == NULL) {
+        perror(path);
+        exit(EXIT_FAILURE);
+    }
+
+    fseek(f, 0, SEEK_END);
+    const long size = ftell(f);
+    rewind(f);
+
+    // the loader wants 8 byte alignment, malloc gives at least that
+    char* data = malloc(size);
+    if (fread(data, 1, size, f) != (size_t)size) {
+        fprintf(stderr, "Could not read %s\n", path);
+        exit(EXIT_FAILURE);
+    }
+    fclose(f);
+
+    return data;
+}
+
+// plans follow pointers, random ones would crash
+static void clear_pointers(const type_info_t* type, char* value) {
+    for (const field_info_t* it = reflect_field_info_iter_begin(type); it != reflect_field_info_iter_end(type); ++it) {
+        const size_t count = it->arr_size > 0 ? it->arr_size : 1;
+        const size_t element = it->ptr_depth > 0 ? sizeof(void*) : it->type_ptr->size;
+
+        if (it->offset + element * count > type->size)
+            continue;
+
+        if (it->ptr_depth > 0) {
+            memset(value + it->offset, 0, element * count);
+        } else if (it->type_ptr->variant == Struct || it->type_ptr->variant == Union) {
+            for (size_t i = 0; i < count; i++)
+                clear_pointers(it->type_ptr, value + it->offset + i * element);
+        }
+    }
+}
+
+static void fill_value(const type_info_t* type, char* value) {
+    for (size_t i = 0; i < type->size; i++)
+        value[i] = (char)rand();
+
+    clear_pointers(type, value);
+}
+
+static double run_memcpy(const bench_type_t* types, const size_t type_count, const size_t values) {
+    const double start = get_time_us();
+
+    for (size_t t = 0; t < type_count; t++) {
+        const size_t size = types[t].type->size;
+        for (size_t i = 0; i < values; i++)
+            memcpy(types[t].serialized + i * size, types[t].values + i * size, size);
+    }
+
+    return get_time_us() - start;
+}
+
+static double run_serialize(const bench_type_t* types, const size_t type_count, const size_t values) {
+    const double start = get_time_us();
+
+    for (size_t t = 0; t < type_count; t++) {
+        const size_t size = types[t].type->size;
+        char* out = types[t].serialized;
+        const char* end = out + types[t].serialized_size;
+
+        for (size_t i = 0; i < values; i++)
+            out += reflect_plan_serialize(types[t].plan, types[t].values + i * size, out, end - out);
+    }
+
+    return get_time_us() - start;
+}
+
+static double run_deserialize(const bench_type_t* types, const size_t type_count, const size_t values) {
+    const double start = get_time_us();
+
+    for (size_t t = 0; t < type_count; t++) {
+        const size_t size = types[t].type->size;
+        const char* in = types[t].serialized;
+        const char* end = in + types[t].serialized_size;
+
+        for (size_t i = 0; i < values; i++)
+            in += reflect_plan_deserialize(types[t].plan, types[t].values + i * size, in, end - in);
+    }
+
+    return get_time_us() - start;
+}
+
+static double best_of(double (*run)(const bench_type_t*, size_t, size_t), const bench_type_t* types, const size_t type_count, const size_t values) {
+    double best = 0;
+
+    for (int round = 0; round < NUM_ROUNDS; round++) {
+        const double elapsed = run(types, type_count, values);
+        if (round == 0 || elapsed < best)
+            best = elapsed;
+    }
+
+    return best;
+}
+
+/*
+ *   Usage: ./serialize_benchmark <reflection.dat> [values_per_type]
+ *   A large blob can be made with gen_synthetic.py and merge.py.
+ */
+int main(int argc, char *argv[]) {
+    if (argc < 2) {
+        fprintf(stderr, "Usage: %s <reflection.dat> [values_per_type]\n", argv[0]);
+        return 1;
+    }
+
+    size_t values = DEFAULT_VALUES_PER_TYPE;
+    if (argc > 2) {
+        const long value = atol(argv[2]);
+        if (value <= 0) {
+            fprintf(stderr, "Invalid number of values specified: %s\n", argv[2]);
+            return 1;
+        }
+        values = value;
+    }
+
+    char* blob = read_file(argv[1]);
+    reflect_load_bytes(blob, false);
+
+    size_t struct_count = 0, type_count = 0, pod_count = 0, total_bytes = 0;
+    bench_type_t* types = NULL;
+
+    for (size_t id = 1; reflect_type_info_from_id(id) != NULL; id++) {
+        const type_info_t* type = reflect_type_info_from_id(id);
+
+        if (type->variant != Struct)
+            continue;
+
+        struct_count++;
+        reflect_plan_t* plan = reflect_plan_compile(type);
+
+        // synthetic layouts can have fields outside of their struct or of unknown types
+        if (plan == NULL)
+            continue;
+
+        bench_type_t bench = { .type = type, .plan = plan, .values = malloc(type->size * values) };
+
+        for (size_t i = 0; i < values; i++) {
+            fill_value(type, bench.values + i * type->size);
+            bench.serialized_size += reflect_plan_serialize(plan, bench.values + i * type->size, NULL, 0);
+        }
+
+        // memcpy writes type->size per value into the same buffer
+        if (bench.serialized_size < type->size * values)
+            bench.serialized_size = type->size * values;
+        bench.serialized = malloc(bench.serialized_size);
+
+        pod_count += reflect_plan_serialize(plan, bench.values, NULL, 0) == type->size;
+        total_bytes += type->size * values;
+
+        types = realloc(types, (type_count + 1) * sizeof(bench_type_t));
+        types[type_count++] = bench;
+    }
+
+    if (type_count == 0) {
+        fprintf(stderr, "No struct of %s can be serialized\n", argv[1]);
+        return 1;
+    }
+
+    printf("%zu of %zu structs serializable (%zu copied whole), %zu values each, %.2f MB\n",
+           type_count, struct_count, pod_count, values, total_bytes / 1e6);
+
+    // GB/s over the in memory size of the values
+    const double copy = best_of(run_memcpy, types, type_count, values);
+    const double serialize = best_of(run_serialize, types, type_count, values);
+    const double deserialize = best_of(run_deserialize, types, type_count, values);
+
+    printf("%-24s %10s %10s\n", "", "GB/s", "vs memcpy");
+    printf("%-24s %10.2f %9.2fx\n", "memcpy", total_bytes / copy / 1e3, 1.0);
+    printf("%-24s %10.2f %9.2fx\n", "reflect_plan_serialize", total_bytes / serialize / 1e3, copy / serialize);
+    printf("%-24s %10.2f %9.2fx\n", "reflect_plan_deserialize", total_bytes / deserialize / 1e3, copy / deserialize);
+
+    for (size_t i = 0; i < type_count; i++) {
+        reflect_plan_free(types[i].plan);
+        free(types[i].values);
+        free(types[i].serialized);
+    }
+    free(types);
+    free(blob);
+
+    return 0;
+}
@@ -33,7 +33,7 @@ typedef struct {
 
 typedef struct {
     const char* name;
-    size_t value;
+    int64_t value;
 } enum_field_info_t;
 
 typedef union {
@@ -41,26 +41,284 @@ typedef union {
     enum_field_info_t enum_field;
 } base_field_info_t;
 
+// Pre-hashed name, create once with reflect_name() and reuse it with the _h lookups.
+// The string is not copied and must outlive the handle.
+typedef struct {
+    const char* name;
+    size_t length;
+    uint64_t hash;
+} reflect_name_t;
+
+// Zero-copy records of a reflection.dat blob, see reflect_load_mapped().
+// Names are offsets into the blob string volume, resolve them with reflect_mapped_string().
+typedef struct {
+    uint64_t size;
+    uint32_t name;
+    uint32_t variant;      // reflect_obj_type_t
+    uint32_t field_count;
+    uint32_t fields;       // index of the first field (or enum field) record
+    uint32_t field_index;
+    uint32_t alias_count;
+    uint32_t aliases;
+    uint32_t value_index;  // enums, value to enumerator index, 0 if absent
+} reflect_mapped_type_t;
+
+typedef struct {
+    uint32_t name;
+    uint32_t type_id;      // reflect_mapped_type_from_id()
+    uint32_t offset;
+    uint32_t arr_size;
+    uint32_t ptr_depth;
+    uint8_t is_const;
+    uint8_t reserved[3];
+} reflect_mapped_field_t;
+
+typedef struct {
+    uint32_t name;
+    uint32_t reserved;
+    int64_t value;
+} reflect_mapped_enum_field_t;
+
+// Memory owned by the loader, reserved is allocated at load and used is the part handed out so far
+typedef struct {
+    size_t reserved;
+    size_t used;
+} reflect_memory_usage_t;
+
+/* A registry holding one loaded reflection.dat. Functions without a context use the default one.
+   Type infos know their context, so field lookups and iterators work on types of any context. */
+typedef struct reflect_context reflect_context_t;
+
+/* Loading runs once, concurrent callers return after the first one has published the tables.
+   After that every lookup and iterator below is safe from any number of threads without locks.
+   reflect_unload() must not run concurrently with anything else. */
 void reflect_load();
 void reflect_load_bytes(char* reflection_metadata, bool copy);
+void reflect_unload();
+reflect_memory_usage_t reflect_memory_usage();
+
+reflect_context_t* reflect_context_default();
+reflect_context_t* reflect_context_create();
+void reflect_context_destroy(reflect_context_t* ctx);
+void reflect_context_load_bytes(reflect_context_t* ctx, char* reflection_metadata, bool copy);
+void reflect_context_unload(reflect_context_t* ctx);
+reflect_memory_usage_t reflect_context_memory_usage(const reflect_context_t* ctx);
+/* Name lookups that miss in ctx continue in parent, the tables are shared and not copied */
+bool reflect_context_set_parent(reflect_context_t* ctx, reflect_context_t* parent);
+
+/* Mapped mode: uses the blob in place (mmap, linked symbol), no parsing or allocation.
+   The memory must be 8 byte aligned and outlive every lookup. */
+bool reflect_load_mapped(const void* data, size_t size);
+const char* reflect_mapped_string(uint32_t offset);
+const reflect_mapped_type_t* reflect_mapped_type_from_name(const char* name);
+const reflect_mapped_type_t* reflect_mapped_type_from_id(size_t id);
+const reflect_mapped_field_t* reflect_mapped_get_field_type(const reflect_mapped_type_t* type, const char* field_name);
+const reflect_mapped_field_t* reflect_mapped_field_iter_begin(const reflect_mapped_type_t* type);
+const reflect_mapped_field_t* reflect_mapped_field_iter_end(const reflect_mapped_type_t* type);
+const int64_t* reflect_mapped_get_enum_value(const reflect_mapped_type_t* enum_type, const char* field_name);
+const reflect_mapped_enum_field_t* reflect_mapped_enum_iter_begin(const reflect_mapped_type_t* enum_type);
+const reflect_mapped_enum_field_t* reflect_mapped_enum_iter_end(const reflect_mapped_type_t* enum_type);
+const reflect_mapped_enum_field_t* reflect_mapped_enum_field_from_value(const reflect_mapped_type_t* enum_type, int64_t value);
 
+/* Without an allocator reflect_alloc() takes objects from a pool of their type. Like malloc'd objects they
+   stay valid until reflect_free(), also across reflect_context_unload(). reflect_get_type_info() returns NULL
+   for them while their type is unloaded and the new type once one of the same name and size is loaded. */
 void* reflect_alloc(const type_info_t* type, void* allocator, void*(*alloc)(void*, size_t));
 void reflect_free(void* ptr, void* allocator, void (*free_func)(void*, void*));
+void* reflect_alloc_array(const type_info_t* type, size_t count);
+
+/* Slab pools of one type without per-object headers, reflect_get_type_info() finds the type through a
+   page map. Each thread caches a few free slots per pool and returns them when it exits. reflect_alloc() uses one pool per type. */
+typedef struct reflect_pool reflect_pool_t;
+
+reflect_pool_t* reflect_pool_create(const type_info_t* type);
+void reflect_pool_destroy(reflect_pool_t* pool);
+void* reflect_pool_alloc(reflect_pool_t* pool);
+void reflect_pool_free(reflect_pool_t* pool, void* ptr);
+
+/* Typed arenas: bump allocation of elements of one type with no per-object overhead, freed all at
+   once. reflect_get_type_info() resolves their elements through the same page map. An arena is used
+   by one thread at a time.
+   Building with REFLECT_HEADERLESS puts every reflect_alloc() object into a span and makes
+   reflect_get_type_info() return NULL for any other pointer instead of reading a header before it. */
+typedef struct reflect_arena reflect_arena_t;
+
+reflect_arena_t* reflect_arena_create(const type_info_t* type);
+void reflect_arena_destroy(reflect_arena_t* arena);
+void* reflect_arena_alloc(reflect_arena_t* arena, size_t count);
+
+reflect_name_t reflect_name(const char* name);
 
 const type_info_t* reflect_type_info_from_name(const char* name);
+const type_info_t* reflect_type_info_from_name_h(reflect_name_t name);
+const type_info_t* reflect_type_info_from_id(size_t id);
+/* Batched lookups, independent names are resolved interleaved so their cache misses overlap.
+   Return the number of names found, out[i] is NULL for the others. */
+size_t reflect_type_info_from_names(const char** names, size_t count, const type_info_t** out);
+size_t reflect_ctx_type_info_from_names(const reflect_context_t* ctx, const char** names, size_t count, const type_info_t** out);
+const type_info_t* reflect_ctx_type_info_from_name(const reflect_context_t* ctx, const char* name);
+const type_info_t* reflect_ctx_type_info_from_name_h(const reflect_context_t* ctx, reflect_name_t name);
+const type_info_t* reflect_ctx_type_info_from_id(const reflect_context_t* ctx, size_t id);
 const type_info_t* reflect_get_type_info(const void* ptr);
 
 void* reflect_get_field(void* struct_ptr, const char* field_name);
+void* reflect_get_field_h(void* struct_ptr, reflect_name_t field_name);
 void* reflect_get_field_manual(void* struct_ptr, const char* field_name, const type_info_t* type_info);
+void* reflect_get_field_manual_h(void* struct_ptr, reflect_name_t field_name, const type_info_t* type_info);
 
 const field_info_t* reflect_get_field_type(const type_info_t* type, const char* field_name);
+const field_info_t* reflect_get_field_type_h(const type_info_t* type, reflect_name_t field_name);
+
+size_t reflect_get_field_types(const type_info_t* type, const char** field_names, size_t count, const field_info_t** out);
 
 field_info_t* reflect_field_info_iter_begin(const type_info_t* type_info);
 field_info_t* reflect_field_info_iter_end(const type_info_t* type_info);
 
-const size_t* reflect_get_enum_value(const type_info_t *enum_type, const char *field_name);
+// Like the iter functions, but embedded structs are expanded into "outer.inner" fields with offsets from the
+// start of type_info whichever way the blob stores them. Built on first use for hierarchical blobs, if that
+// allocation fails these are the fields as the blob stores them.
+field_info_t* reflect_field_info_flat_begin(const type_info_t* type_info);
+field_info_t* reflect_field_info_flat_end(const type_info_t* type_info);
+
+const int64_t* reflect_get_enum_value(const type_info_t *enum_type, const char *field_name);
+const int64_t* reflect_get_enum_value_h(const type_info_t *enum_type, reflect_name_t field_name);
 enum_field_info_t* reflect_enum_info_iter_begin(const type_info_t* enum_type);
 enum_field_info_t* reflect_enum_info_iter_end(const type_info_t* enum_type);
 
+/* Value to name through the enum's value index, NULL if no enumerator has the value.
+   Several enumerators with the same value resolve to the first declared one. */
+const char* reflect_enum_name_from_value(const type_info_t* enum_type, int64_t value);
+/* Splits a bitmask value into enumerator names, largest enumerator values first. An enumerator equal to
+   value is returned alone. Writes at most capacity names and returns how many were written, bits not covered
+   by a written name are left in remainder (may be NULL). */
+size_t reflect_enum_decompose_flags(const type_info_t* enum_type, int64_t value, const char** names, size_t capacity, int64_t* remainder);
+
+/* Bulk copy of one field between an array of structs and a packed array, stride 0 means type->size */
+void reflect_gather(const type_info_t* type, const field_info_t* field, const void* base, size_t count, size_t stride, void* out);
+void reflect_scatter(const type_info_t* type, const field_info_t* field, void* base, size_t count, size_t stride, const void* in);
+
+/* Structure of arrays: one 64 byte aligned column per field. Flattened embedded struct fields get
+   their own columns, pointers are copied as opaque values and a union, top level or embedded, is a
+   single column of its size (its members get none). */
+#define REFLECT_SOA_EXPLODE_ARRAYS 1 // one column per array element instead of one per array field
+
+typedef struct {
+    const field_info_t* field; // source field, NULL for the column of a whole union
+    size_t element;            // array element of exploded array fields, else 0
+    size_t size;               // bytes per row
+    void* data;                // count * size bytes
+    field_info_t layout;       // bytes of the struct this column holds
+} reflect_soa_column_t;
+
+typedef struct {
+    const type_info_t* type;
+    size_t count;
+    size_t column_count;
+    reflect_soa_column_t* columns;
+    void* block;
+} reflect_soa_t;
+
+reflect_soa_t* reflect_soa_create(const type_info_t* type, size_t count, uint32_t flags);
+reflect_soa_t* reflect_soa_from_aos(const type_info_t* type, const void* base, size_t count, uint32_t flags);
+void reflect_soa_to_aos(const reflect_soa_t* soa, void* base);
+const reflect_soa_column_t* reflect_soa_column(const reflect_soa_t* soa, const char* field_name, size_t element);
+void reflect_soa_free(reflect_soa_t* soa);
+
+/* Binary serialization through a plan compiled once per type. Adjacent fields are copied in single runs
+   and padding is skipped, types without pointers are copied whole. Pointers are followed as trees (no
+   sharing or cycles) and written as a presence byte and the pointee, char pointers as strings.
+   Unions are copied as raw bytes and pointers to void or functions come back NULL.
+   The format is native endian and only meant to be read by the same build. */
+typedef struct reflect_plan reflect_plan_t;
+
+reflect_plan_t* reflect_plan_compile(const type_info_t* type);
+void reflect_plan_free(reflect_plan_t* plan);
+size_t reflect_plan_serialize(const reflect_plan_t* plan, const void* ptr, void* buf, size_t buf_size);
+size_t reflect_plan_deserialize(const reflect_plan_t* plan, void* ptr, const void* buf, size_t buf_size);
+void reflect_plan_release(const reflect_plan_t* plan, void* ptr);
+size_t reflect_serialize(const void* ptr, const type_info_t* type, void* buf, size_t buf_size);
+size_t reflect_deserialize(void* ptr, const type_info_t* type, const void* buf, size_t buf_size);
+
+/* Copy, equality and hashing through the same plans. Fields are compared and hashed as the bytes of
+   their padding-free runs, unions as all their bytes. Pointers are compared by address unless
+   REFLECT_DEEP is given, then they are followed like in serialization and compared by pointee. */
+#define REFLECT_DEEP 1 // follow pointers, a deep copy mallocs its pointees
+
+bool reflect_plan_copy(const reflect_plan_t* plan, void* dst, const void* src, uint32_t flags);
+bool reflect_plan_equal(const reflect_plan_t* plan, const void* a, const void* b, uint32_t flags);
+uint64_t reflect_plan_hash(const reflect_plan_t* plan, const void* ptr, uint32_t flags);
+bool reflect_copy(void* dst, const void* src, const type_info_t* type, uint32_t flags);
+bool reflect_equal(const void* a, const void* b, const type_info_t* type, uint32_t flags);
+uint64_t reflect_hash(const void* ptr, const type_info_t* type, uint32_t flags);
+
+/* Field deltas for replication. Fields are numbered in field list order, a mask holds one bit per
+   field. Fields lying inside another field (flattened members of embedded structs, smaller union
+   members) are never reported, the covering field carries their bytes. Changes are found by comparing
+   whole values in wide blocks, padding excluded, and pointers are compared and copied as raw values.
+   Patches hold only the changed fields and are native endian. */
+#define REFLECT_DELTA_MASK_WORDS(field_count) (((field_count) + 63) / 64)
+
+typedef struct reflect_delta_plan reflect_delta_plan_t;
+
+reflect_delta_plan_t* reflect_delta_plan_compile(const type_info_t* type);
+void reflect_delta_plan_free(reflect_delta_plan_t* plan);
+size_t reflect_delta_plan_diff(const reflect_delta_plan_t* plan, const void* old, const void* new, uint64_t* mask);
+size_t reflect_delta_plan_encode(const reflect_delta_plan_t* plan, const void* old, const void* new, void* buf, size_t buf_size);
+size_t reflect_delta_plan_apply(const reflect_delta_plan_t* plan, void* ptr, const void* buf, size_t buf_size);
+size_t reflect_diff(const type_info_t* type, const void* old, const void* new, uint64_t* out_mask);
+size_t reflect_delta_encode(const type_info_t* type, const void* old, const void* new, void* buf, size_t buf_size);
+size_t reflect_delta_apply(const type_info_t* type, void* ptr, const void* buf, size_t buf_size);
+
+/* JSON through a plan compiled once per type, streamed without building a document. Structs are objects
+   (embedded structs nested), arrays are arrays, char arrays and char pointers strings, enums their
+   enumerator names and pointers are followed (null if NULL). Unions are objects of their members without
+   pointers: only one member is valid and JSON can't tell which, so members holding pointers or char*
+   strings are left out, of anonymous unions flattened into a struct too. Fields JSON has no value for
+   (void or function pointers, unknown types) are left out as well. */
+typedef struct reflect_json_plan reflect_json_plan_t;
+
+typedef struct {
+    char* buf;
+    size_t size;
+    size_t pos; // bytes in buf that weren't flushed yet
+    bool (*flush)(void* user, const char* data, size_t size); // called when buf is full, NULL makes writes fail instead
+    void* user;
+    bool failed;
+} reflect_json_writer_t;
+
+typedef struct {
+    const char* data;
+    size_t size;
+    size_t pos; // moved past every value read, so several values can be read in a row
+} reflect_json_reader_t;
+
+reflect_json_plan_t* reflect_json_plan_compile(const type_info_t* type);
+void reflect_json_plan_free(reflect_json_plan_t* plan);
+bool reflect_json_plan_write(const reflect_json_plan_t* plan, const void* ptr, reflect_json_writer_t* writer);
+bool reflect_json_plan_read(const reflect_json_plan_t* plan, reflect_json_reader_t* reader, void* ptr);
+void reflect_json_plan_release(const reflect_json_plan_t* plan, void* ptr);
+bool reflect_json_flush(reflect_json_writer_t* writer);
+bool reflect_json_write(const void* ptr, const type_info_t* type, reflect_json_writer_t* writer);
+bool reflect_json_read(reflect_json_reader_t* reader, void* ptr, const type_info_t* type);
+
+/* Compiled access paths: "a.b[3]->c" is resolved once, reflect_path_get() then only adds offsets and
+   loads pointers. '[' indexes arrays in place or a pointer after loading it, '->' loads a pointer. */
+typedef struct reflect_path reflect_path_t;
+
+reflect_path_t* reflect_path_compile(const type_info_t* type, const char* path);
+void reflect_path_free(reflect_path_t* path);
+void* reflect_path_get(const reflect_path_t* path, void* struct_ptr);
+const type_info_t* reflect_path_type(const reflect_path_t* path);
+const field_info_t* reflect_path_field(const reflect_path_t* path);
+
+/* Compile time lookups, need the reflect_generated.h written by merge.py --header.
+   struct_name and field are the type and field names as identifiers (non identifier characters become '_'). */
+#define REFLECT_TYPE_ID(struct_name) REFLECT_TYPE_ID_##struct_name
+#define REFLECT_TYPE(struct_name) reflect_type_info_from_id(REFLECT_TYPE_ID_##struct_name)
+#define REFLECT_FIELD_OFFSET(struct_name, field) REFLECT_OFFSET_##struct_name##__##field
+#define REFLECT_FIELD_PTR(ptr, struct_name, field) ((void*)((char*)(ptr) + REFLECT_OFFSET_##struct_name##__##field))
+#define REFLECT_FIELD_INFO(struct_name, field) \
+    (reflect_field_info_iter_begin(REFLECT_TYPE(struct_name)) + REFLECT_FIELD_INDEX_##struct_name##__##field)
+
 /* WebAssembly hotreloading by copying state */
 void* reflect_hotreload_get_state_ptr();
\ No newline at end of file
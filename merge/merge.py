@@ -3,59 +3,155 @@
 # This should be ran after compilation (perhaps before linking)
 
 import os
-import sys
 import glob
+import argparse
 import json
+import math
 import struct
 
 type_name_map = {}  # type name -> type data
-global_string_volume = {} # string literal -> relative offset in reflection.dat
 arch = -1           # 8 or 4
+odr_conflicts = []  # (name, kept source, replaced source), same name with a different fingerprint
+duplicate_count = 0 # definitions dropped because an identical one was already merged
+
+# reflection.dat v2 layout, mirrored by src/blob.c. Every section is 8 byte aligned and
+# every reference is an offset relative to the start of the blob, so the runtime can use
+# the file as-is from an mmap or the linked _reflection_dat_start symbol.
+BLOB_MAGIC = 0x324C4652  # "RFL2"
+BLOB_VERSION = 2
+BLOB_HEADER_FORMAT = "<14I"
+BLOB_TYPE_FORMAT = "<QIIIIIIII"
+BLOB_FIELD_FORMAT = "<IIIIIB3x"
+BLOB_ENUM_FIELD_FORMAT = "<I4xq"
+BLOB_INDEX_HEADER_FORMAT = "<II"
+BLOB_INDEX_SLOT_FORMAT = "<III"
+BLOB_VALUE_INDEX_HEADER_FORMAT = "<IIq"
+BLOB_ENUM_VALUE_FORMAT = "<qI4x"
+BLOB_VALUES_DENSE = 1
+BLOB_VALUES_SORTED = 2
+BLOB_VALUE_HOLE = 0xFFFFFFFF
+BLOB_INDEX_BUCKET_SIZE = 4    # average keys per displacement bucket
+BLOB_INDEX_LOAD_FACTOR = 0.99  # keeps the seed search short for the last buckets
+MASK64 = 0xFFFFFFFFFFFFFFFF
+
+# Binary fragments written by the plugin, see plugin/ReflectionDataSerializer.hpp.
+# Plugins run with format=text write the line oriented format instead, both are read.
+FRAGMENT_MAGIC = 0x31464652  # "RFF1"
+FRAGMENT_VERSION = 2
+FRAGMENT_HEADER_FORMAT = "<8I"
+FRAGMENT_TYPE_FORMAT = "<IIQQIIII"
+FRAGMENT_FIELD_FORMAT = "<IIIIIBB2x"
+FRAGMENT_ENUMERATOR_FORMAT = "<I4xq"
+FRAGMENT_VARIANTS = {1: "base", 2: "struct", 3: "union", 4: "enum"}
+
+# <object>.layout.json written by plugins run with layout-report, see plugin/LayoutReport.hpp
+LAYOUT_REPORT_VERSION = 1
+LAYOUT_SUMMARY_RECORDS = 10
+
+
+def hash_fnv1a64(name):
+    value = 14695981039346656037
+    for byte in name.encode("utf-8"):
+        value ^= byte
+        value = (value * 1099511628211) & MASK64
+    return value
+
+
+def phf_mix(x):
+    # murmur3 fmix64, fnv alone leaves the high bits of similar names clustered
+    x ^= x >> 33
+    x = (x * 0xFF51AFD7ED558CCD) & MASK64
+    x ^= x >> 33
+    x = (x * 0xC4CEB9FE1A85EC53) & MASK64
+    x ^= x >> 33
+    return x
+
+
+def phf_split(hash_value):
+    # bucket selector, base position and displacement step of a key
+    x = phf_mix(hash_value)
+    return x >> 32, x & 0xFFFFFFFF, (((x * 0x9E3779B97F4A7C15) & MASK64) >> 32) | 1
+
+
+def fast_range(value, size):
+    return (value * size) >> 32
+
 
 class BinWriter:
-    def __init__(self, size, arch):
-        self.data = bytearray(size)
-        self.offset = 0
-        self.arch = arch
-
-    def ensure_capacity(self, extra):
-        if self.offset + extra > len(self.data):
-            raise RuntimeError("Buffer overflow; increase the buffer size.")
-
-    def write_uint32(self, value):
-        self.ensure_capacity(4)
-        struct.pack_into("<I", self.data, self.offset, value)
-        self.offset += 4
-
-    def write_int64(self, value):
-        self.ensure_capacity(8)
-        struct.pack_into("<q", self.data, self.offset, value)
-        self.offset += 8
-
-    def write_uint8(self, value):
-        self.ensure_capacity(1)
-        struct.pack_into("<B", self.data, self.offset, value)
-        self.offset += 1
-
-    def write_bool(self, value):
-        self.write_uint8(1 if value else 0)
-
-    def write_c_string(self, s):
-        encoded = s.encode("utf-8")
-        self.ensure_capacity(len(encoded) + 1)
-        self.data[self.offset:self.offset+len(encoded)] = encoded
-        self.offset += len(encoded)
-        self.write_uint8(0)
-
-    def write_arch_size(self, value):
-        if self.arch == 8:
-            self.write_int64(value)
+    def __init__(self):
+        self.data = bytearray()
+
+    @property
+    def offset(self):
+        return len(self.data)
+
+    def write(self, fmt, *values):
+        self.data += struct.pack(fmt, *values)
+
+    def patch(self, offset, fmt, *values):
+        struct.pack_into(fmt, self.data, offset, *values)
+
+    def align(self, alignment=8):
+        self.data += bytes(-len(self.data) % alignment)
+
+
+class StringVolume:
+    def __init__(self):
+        # offset 0 is always the empty string, the indexes use it to mark empty slots
+        self.offsets = {"": 0}
+        self.data = bytearray(b"\0")
+
+    def add(self, s):
+        if s not in self.offsets:
+            self.offsets[s] = len(self.data)
+            self.data += s.encode("utf-8") + b"\0"
+        return self.offsets[s]
+
+
+def structural_fingerprint(type_data):
+    # Same hash as StructuralFingerprint() in plugin/ReflectionTypes.cpp, for text fragments without one
+    tokens = [type_data["type"], type_data["name"], type_data.get("size", 0)]
+    for field in type_data.get("fields", []):
+        if type_data["type"] == "enum":
+            tokens += [field.get("name", ""), field.get("value", 0)]
         else:
-            self.write_uint32(value)
+            tokens += [field.get("name", ""), field.get("type", ""), field.get("offset", 0), field.get("arrsize", 0),
+                       field.get("pdepth", 0), int(field.get("const", False)), int(field.get("struct", False))]
+    return hash_fnv1a64("".join(f"{token}\0" for token in tokens))
+
+
+def merge_duplicate(name, fingerprint, aliases):
+    # Identical definitions from another TU only contribute their aliases. Returns False for new names
+    # and for conflicting definitions, which then replace the older one like before.
+    global duplicate_count
+
+    existing = type_name_map.get(name)
+    if existing is None:
+        return False
+    if existing["fingerprint"] != fingerprint:
+        return False
+
+    known = existing.setdefault("aliases", [])
+    for alias in aliases:
+        if alias not in known:
+            known.append(alias)
+    duplicate_count += 1
+    return True
+
+
+def add_type(type_data, source):
+    name = type_data["name"]
+    if merge_duplicate(name, type_data["fingerprint"], type_data.get("aliases", [])):
+        return
+
+    if name in type_name_map:
+        odr_conflicts.append((name, source, type_name_map[name]["source"]))
+    type_data["source"] = source
+    type_name_map[name] = type_data
 
 
 def parse_reflection_files(root_dir):
-    global arch, type_name_map, global_string_volume, global_string_writer
+    global arch, type_name_map
 
     pattern = os.path.join(root_dir, "**", "*.reflection.dat")
     files = glob.glob(pattern, recursive=True)
@@ -69,198 +165,453 @@ def parse_reflection_files(root_dir):
 
     for file in files:
         try:
-            with open(file, "r") as f:
-                content = f.read().splitlines()
+            with open(file, "rb") as f:
+                data = f.read()
         except Exception as e:
             print(f"Error reading file {file}: {e}")
             continue
 
-        current_data = {}
-        current_field_data = {}
+        if len(data) >= 4 and struct.unpack_from("<I", data)[0] == FRAGMENT_MAGIC:
+            parse_binary_fragment(file, data)
+        else:
+            parse_text_fragment(file, data.decode("utf-8").splitlines())
+
+    if duplicate_count:
+        print(f"Merged {duplicate_count} identical duplicate definitions.")
+    for name, kept, replaced in odr_conflicts:
+        print(f"Warning: '{name}' is defined differently in {replaced} and {kept}, using the one from {kept}")
+
+
+def collapse_nested_fields():
+    # --nested hierarchical: embedded structs of a known type keep only the field referencing that type,
+    # their flattened "outer.inner" children are dropped. Fragments of plugins running with
+    # nested=hierarchical have none to begin with.
+    removed = 0
+
+    for type_data in type_name_map.values():
+        if type_data["type"] not in ("struct", "union"):
+            continue
+
+        embedded = set()
+        for field in type_data.get("fields", []):
+            nested = type_name_map.get(field.get("type", ""))
+            if (field.get("name") and field.get("pdepth", 0) == 0 and field.get("arrsize", 0) == 0 and
+                    nested is not None and nested["type"] in ("struct", "union") and nested.get("fields")):
+                embedded.add(field["name"])
+
+        if not embedded:
+            continue
+
+        kept = []
+        for field in type_data["fields"]:
+            parts = field.get("name", "").split(".")
+            if any(".".join(parts[:i]) in embedded for i in range(1, len(parts))):
+                removed += 1
+            else:
+                kept.append(field)
+        type_data["fields"] = kept
+
+    if removed:
+        print(f"Collapsed {removed} flattened fields of embedded structs.")
+
+
+def parse_binary_fragment(file, data):
+    global arch, type_name_map
+
+    header_size = struct.calcsize(FRAGMENT_HEADER_FORMAT)
+    if len(data) < header_size:
+        print(f"Truncated reflection fragment {file}")
+        return
+
+    (_, version, fragment_arch, type_count, field_count, enumerator_count, alias_count,
+     strings_size) = struct.unpack_from(FRAGMENT_HEADER_FORMAT, data)
+    type_size = struct.calcsize(FRAGMENT_TYPE_FORMAT)
+    field_size = struct.calcsize(FRAGMENT_FIELD_FORMAT)
+    enumerator_size = struct.calcsize(FRAGMENT_ENUMERATOR_FORMAT)
+
+    types_offset = header_size
+    fields_offset = types_offset + type_count * type_size
+    enumerators_offset = fields_offset + field_count * field_size
+    aliases_offset = enumerators_offset + enumerator_count * enumerator_size
+    strings_offset = aliases_offset + alias_count * 4
+
+    if version != FRAGMENT_VERSION or strings_offset + strings_size != len(data):
+        print(f"Unsupported or corrupt reflection fragment {file} (rebuild it with the current plugin)")
+        return
+
+    arch = fragment_arch
+
+    # every string starts right after a terminator, so one split resolves all offsets
+    strings = {}
+    position = 0
+    for s in data[strings_offset:strings_offset + strings_size].split(b"\0"):
+        strings[position] = s.decode("utf-8")
+        position += len(s) + 1
+
+    # member records are only turned into dicts for types not merged already
+    fields = list(struct.iter_unpack(FRAGMENT_FIELD_FORMAT, data[fields_offset:enumerators_offset]))
+    enumerators = list(struct.iter_unpack(FRAGMENT_ENUMERATOR_FORMAT, data[enumerators_offset:aliases_offset]))
+    aliases = [strings[name] for (name,) in struct.iter_unpack("<I", data[aliases_offset:strings_offset])]
+
+    for variant, name, size, fingerprint, first_member, member_count, first_alias, alias_count in \
+            struct.iter_unpack(FRAGMENT_TYPE_FORMAT, data[types_offset:fields_offset]):
+        kind = FRAGMENT_VARIANTS.get(variant)
+        if kind is None or not name:
+            continue
+
+        type_aliases = aliases[first_alias:first_alias + alias_count]
+        if merge_duplicate(strings[name], fingerprint, type_aliases):
+            continue
+
+        type_data = {"type": kind, "name": strings[name], "size": size, "aliases": type_aliases,
+                     "fingerprint": fingerprint}
+        members = range(first_member, first_member + member_count)
+        if kind == "enum":
+            type_data["fields"] = [{"name": strings[enumerators[i][0]], "value": enumerators[i][1]} for i in members]
+        elif kind != "base":
+            type_data["fields"] = [{"name": strings[fname], "type": strings[ftype], "offset": offset, "arrsize": arr_size,
+                                    "pdepth": ptr_depth, "const": bool(is_const), "struct": bool(is_struct)}
+                                   for fname, ftype, offset, arr_size, ptr_depth, is_const, is_struct
+                                   in fields[first_member:first_member + member_count]]
+        add_type(type_data, file)
+
+
+def parse_text_fragment(file, content):
+    global arch, type_name_map
+
+    current_data = {}
+    current_field_data = {}
+    is_in_field_mode = False
+
+    def flush_current_field_data():
+        nonlocal is_in_field_mode, current_field_data, current_data
+        if not is_in_field_mode:
+            return
+        if "name" in current_field_data:
+            current_data.setdefault("fields", []).append(
+                current_field_data.copy())
         is_in_field_mode = False
+        current_field_data = {}
+
+    def flush_current_data():
+        nonlocal current_data
+        global type_name_map
+        flush_current_field_data()
+        if "type" in current_data and "name" in current_data:
+            if "fingerprint" not in current_data:
+                current_data["fingerprint"] = structural_fingerprint(current_data)
+            add_type(current_data.copy(), file)
+        current_data = {}
 
-        def flush_current_field_data():
-            nonlocal is_in_field_mode, current_field_data, current_data
-            if not is_in_field_mode:
-                return
-            if "name" in current_field_data:
-                current_data.setdefault("fields", []).append(
-                    current_field_data.copy())
-            is_in_field_mode = False
-            current_field_data = {}
-
-        def flush_current_data():
-            nonlocal current_data
-            global type_name_map
+    for line in content:
+        parts = line.strip().split()
+        if not parts:
+            continue
+        command = parts[0]
+        arg = " ".join(parts[1:]) if len(parts) > 1 else ""
+        if command == "arch":
+            try:
+                arch = int(arg)
+            except Exception:
+                pass
+        elif command in ("base", "enum", "struct", "union"):
+            flush_current_field_data()
+            flush_current_data()
+            if command == "base":
+                current_data = {"type": "base"}
+            elif command == "enum":
+                current_data = {"type": "enum",
+                                "fields": [], "aliases": []}
+            elif command == "struct":
+                current_data = {"type": "struct",
+                                "fields": [], "aliases": []}
+            elif command == "union":
+                current_data = {"type": "union",
+                                "fields": [], "aliases": []}
+        elif command in ("field", "enumerator"):
             flush_current_field_data()
-            if "type" in current_data and "name" in current_data:
-                type_name_map[current_data["name"]] = current_data.copy()
-            current_data = {}
+            is_in_field_mode = True
+        elif command == "ek":
+            current_field_data["name"] = arg
+        elif command == "ev":
+            try:
+                current_field_data["value"] = int(arg)
+            except Exception:
+                current_field_data["value"] = 0
+        elif command == "name":
+            if is_in_field_mode:
+                current_field_data["name"] = arg
+            else:
+                current_data["name"] = arg
+        elif command == "alias":
+            current_data.setdefault("aliases", []).append(arg)
+        elif command == "type":
+            current_field_data["type"] = arg
+        elif command == "offset":
+            try:
+                current_field_data["offset"] = int(arg)
+            except Exception:
+                current_field_data["offset"] = 0
+        elif command == "pdepth":
+            try:
+                current_field_data["pdepth"] = int(arg)
+            except Exception:
+                current_field_data["pdepth"] = 0
+        elif command == "arrsize":
+            try:
+                current_field_data["arrsize"] = int(arg)
+            except Exception:
+                current_field_data["arrsize"] = 0
+        elif command == "const":
+            current_field_data["const"] = (arg == "true")
+        elif command == "size":
+            try:
+                current_data["size"] = int(arg)
+            except Exception:
+                current_data["size"] = 0
+        elif command == "fingerprint":
+            try:
+                current_data["fingerprint"] = int(arg, 16)
+            except Exception:
+                pass
+        elif command == "isstruct":
+            current_field_data["struct"] = (arg == "true")
+    flush_current_field_data()
+    flush_current_data()
+
+
+def write_name_index(writer, entries):
+    # Perfect hash over (name, value) pairs (CHD style hash and displace), looked up by
+    # blob_index_get() in src/blob.c with a single probe. Keys are grouped into buckets by
+    # hash, then buckets are placed largest first by searching a per-bucket seed so that
+    # base + seed * step sends all of their keys to free slots. Unused slots keep name 0
+    # and never verify.
+    keys = {}
+    for name, name_offset, value in entries:
+        if name:
+            keys[name] = (name_offset, value)  # later entries override earlier ones
+
+    count = math.ceil(len(keys) / BLOB_INDEX_LOAD_FACTOR)
+    bucket_count = max(1, (len(keys) + BLOB_INDEX_BUCKET_SIZE - 1) // BLOB_INDEX_BUCKET_SIZE)
+    buckets = [[] for _ in range(bucket_count)]
+    for name in keys:
+        hash_value = hash_fnv1a64(name)
+        selector, base, step = phf_split(hash_value)
+        buckets[fast_range(selector, bucket_count)].append((name, hash_value, base, step))
+
+    seeds = [0] * bucket_count
+    slots = [None] * count
+    for bucket_id in sorted(range(bucket_count), key=lambda b: -len(buckets[b])):
+        bucket = buckets[bucket_id]
+        if not bucket:
+            break
+        if len({hash_value for _, hash_value, _, _ in bucket}) != len(bucket):
+            raise RuntimeError(f"fnv1a64 collision between {[key[0] for key in bucket]}")
+
+        seed = 0
+        while True:
+            positions = []
+            for _, _, base, step in bucket:
+                position = fast_range((base + seed * step) & 0xFFFFFFFF, count)
+                if slots[position] is not None or position in positions:
+                    break
+                positions.append(position)
+            if len(positions) == len(bucket):
+                break
+            seed += 1
+
+        seeds[bucket_id] = seed
+        for (name, hash_value, _, _), position in zip(bucket, positions):
+            slots[position] = (hash_value & 0xFFFFFFFF, keys[name][0], keys[name][1])
+
+    writer.align()
+    offset = writer.offset
+    writer.write(BLOB_INDEX_HEADER_FORMAT, bucket_count, count)
+    for seed in seeds:
+        writer.write("<I", seed)
+    for slot in slots:
+        writer.write(BLOB_INDEX_SLOT_FORMAT, *(slot or (0, 0, 0)))
+    return offset
+
+
+def write_value_index(writer, values):
+    # Value -> enumerator index of one enum, looked up by blob_value_index_get() in src/blob.c.
+    # Dense enums get a direct table over [min, max], sparse ones their distinct values sorted
+    # for a binary search. The first declared enumerator of a value wins.
+    first = {}
+    for i, value in enumerate(values):
+        first.setdefault(value, i)
+
+    low, high = min(first), max(first)
+    writer.align()
+    offset = writer.offset
+    if high - low + 1 <= 2 * len(first) + 8:
+        writer.write(BLOB_VALUE_INDEX_HEADER_FORMAT, BLOB_VALUES_DENSE, high - low + 1, low)
+        for value in range(low, high + 1):
+            writer.write("<I", first.get(value, BLOB_VALUE_HOLE))
+    else:
+        writer.write(BLOB_VALUE_INDEX_HEADER_FORMAT, BLOB_VALUES_SORTED, len(first), 0)
+        for value in sorted(first):
+            writer.write(BLOB_ENUM_VALUE_FORMAT, value, first[value])
+    return offset
+
 
-        for line in content:
-            parts = line.strip().split()
-            if not parts:
+def c_identifier(name):
+    return "".join(c if c.isalnum() or c == "_" else "_" for c in name)
+
+
+# Compile time constants for REFLECT_TYPE / REFLECT_FIELD_PTR, ids match the blob written in the same run
+def write_generated_header(output_file, types):
+    lines = []
+    defined = set()
+
+    def define(name, value):
+        if name in defined:
+            lines.append(f"/* {name} skipped, name collides after sanitizing */")
+            return
+        defined.add(name)
+        lines.append(f"#define {name} {value}")
+
+    define("REFLECT_GENERATED_TYPE_COUNT", f"{len(types)}u")
+
+    for type_data, _, field_names, _ in types:
+        ident = c_identifier(type_data["name"])
+        lines.append("")
+        define(f"REFLECT_TYPE_ID_{ident}", f"{type_data['id']}u")
+        define(f"REFLECT_SIZE_{ident}", f"{type_data.get('size', 0)}u")
+        for alias in type_data.get("aliases", []):
+            define(f"REFLECT_TYPE_ID_{c_identifier(alias)}", f"{type_data['id']}u")
+
+        if type_data["type"] not in ("struct", "union"):
+            continue
+
+        offsets = {field.get("name", ""): field.get("offset", 0) for field in type_data.get("fields", [])}
+        for index, name in enumerate(field_names):
+            if name == "":
                 continue
-            command = parts[0]
-            arg = " ".join(parts[1:]) if len(parts) > 1 else ""
-            if command == "arch":
-                try:
-                    if arch == -1:
-                        global global_string_volume, global_string_writer
-                        global_string_writer = BinWriter(10000000, int(arg))
-                        global_string_volume = {}
-
-                    arch = int(arg)
-                except Exception:
-                    pass
-            elif command in ("base", "enum", "struct", "union"):
-                flush_current_field_data()
-                flush_current_data()
-                if command == "base":
-                    current_data = {"type": "base"}
-                elif command == "enum":
-                    current_data = {"type": "enum",
-                                    "fields": [], "aliases": []}
-                elif command == "struct":
-                    current_data = {"type": "struct",
-                                    "fields": [], "aliases": []}
-                elif command == "union":
-                    current_data = {"type": "union",
-                                    "fields": [], "aliases": []}
-            elif command in ("field", "enumerator"):
-                flush_current_field_data()
-                is_in_field_mode = True
-            elif command == "ek":
-                if arg not in global_string_volume:
-                    global_string_volume[arg] = global_string_writer.offset + arch*2
-                    global_string_writer.write_c_string(arg)
-                current_field_data["name"] = arg
-            elif command == "ev":
-                try:
-                    current_field_data["value"] = int(arg)
-                except Exception:
-                    current_field_data["value"] = 0
-            elif command == "name":
-                if arg not in global_string_volume:
-                    global_string_volume[arg] = global_string_writer.offset + arch*2
-                    global_string_writer.write_c_string(arg)
-
-                if is_in_field_mode:
-                    current_field_data["name"] = arg
-                else:
-                    current_data["name"] = arg
-            elif command == "alias":
-                if arg not in global_string_volume:
-                    global_string_volume[arg] = global_string_writer.offset + arch*2
-                    global_string_writer.write_c_string(arg)
-                current_data.setdefault("aliases", []).append(arg)
-            elif command == "type":
-                if arg not in global_string_volume:
-                    global_string_volume[arg] = global_string_writer.offset + arch*2
-                    global_string_writer.write_c_string(arg)
-                current_field_data["type"] = arg
-            elif command == "offset":
-                try:
-                    current_field_data["offset"] = int(arg)
-                except Exception:
-                    current_field_data["offset"] = 0
-            elif command == "pdepth":
-                try:
-                    current_field_data["pdepth"] = int(arg)
-                except Exception:
-                    current_field_data["pdepth"] = 0
-            elif command == "arrsize":
-                try:
-                    current_field_data["arrsize"] = int(arg)
-                except Exception:
-                    current_field_data["arrsize"] = 0
-            elif command == "const":
-                current_field_data["const"] = (arg == "true")
-            elif command == "size":
-                try:
-                    current_data["size"] = int(arg)
-                except Exception:
-                    current_data["size"] = 0
-            elif command == "isstruct":
-                current_field_data["struct"] = (arg == "true")
-        flush_current_field_data()
-        flush_current_data()
+            define(f"REFLECT_OFFSET_{ident}__{c_identifier(name)}", f"{offsets[name]}u")
+            define(f"REFLECT_FIELD_INDEX_{ident}__{c_identifier(name)}", f"{index}u")
+
+    with open(output_file, "w") as f:
+        f.write("/* Generated by merge.py, do not edit */\n")
+        f.write("#ifndef REFLECT_GENERATED_H\n#define REFLECT_GENERATED_H\n\n")
+        f.write("\n".join(lines))
+        f.write("\n\n#endif\n")
 
 
-def write_reflection_dat(output_file, output_asm_file, output_c_file):
-    global arch, type_name_map, global_string_volume, global_string_writer
+def write_reflection_dat(output_file, output_asm_file, output_c_file, with_index=True, header_file=None):
+    global arch, type_name_map
+
+    type_name_map.pop("", None)
 
     type_id = 1
     for name, data in type_name_map.items():
         data["id"] = type_id
         type_id += 1
-    type_name_map.pop("", None)
 
     # Debug
     with open("reflectionOutput.json", "w") as f:
         json.dump(type_name_map, f, indent=4)
 
-    # Hmm should probably not hardcode this
-    writer = BinWriter(10000000, arch)
     object_types = {"base": 1, "struct": 2, "union": 3, "enum": 4}
+    strings = StringVolume()
+
+    types = []        # (data, first_field, field_count, first_alias)
+    fields = []       # packed field records
+    enum_fields = []  # packed enum field records
+    aliases = []      # string offsets
+    for type_data in type_name_map.values():
+        is_enum = type_data["type"] == "enum"
+        first_field = len(enum_fields) if is_enum else len(fields)
+        field_names = []
+
+        for field in type_data.get("fields", []):
+            name = field.get("name", "")
+            if is_enum:
+                enum_fields.append(struct.pack(BLOB_ENUM_FIELD_FORMAT, strings.add(name), field.get("value", 0)))
+            else:
+                if field.get("struct", False) and field.get("type", "") not in type_name_map:
+                    continue
+                ftype = field.get("type", "")
+                ref_id = type_name_map[ftype]["id"] if ftype in type_name_map else 0
+                fields.append(struct.pack(BLOB_FIELD_FORMAT, strings.add(name), ref_id,
+                                          field.get("offset", 0), field.get("arrsize", 0),
+                                          field.get("pdepth", 0), 1 if field.get("const", False) else 0))
+            field_names.append(name)
+
+        first_alias = len(aliases)
+        for alias in type_data.get("aliases", []):
+            aliases.append(strings.add(alias))
+
+        strings.add(type_data["name"])
+        types.append((type_data, first_field, field_names, first_alias))
+
+    writer = BinWriter()
+    writer.write(BLOB_HEADER_FORMAT, *([0] * 14))
+
+    # type records are indexed by type id, slot 0 is the unknown type
+    writer.align()
+    types_offset = writer.offset
+    writer.write(BLOB_TYPE_FORMAT, 0, 0, 0, 0, 0, 0, 0, 0, 0)
+    type_record_offsets = []
+    for type_data, first_field, field_names, first_alias in types:
+        type_record_offsets.append(writer.offset)
+        writer.write(BLOB_TYPE_FORMAT, type_data.get("size", 0), strings.offsets[type_data["name"]],
+                     object_types.get(type_data["type"], 0), len(field_names), first_field, 0,
+                     len(type_data.get("aliases", [])), first_alias, 0)
+
+    writer.align()
+    fields_offset = writer.offset
+    for record in fields:
+        writer.data += record
+
+    writer.align()
+    enum_fields_offset = writer.offset
+    for record in enum_fields:
+        writer.data += record
+
+    writer.align()
+    aliases_offset = writer.offset
+    for alias in aliases:
+        writer.write("<I", alias)
+
+    type_index_offset = 0
+    if with_index:
+        entries = []
+        for type_data, _, _, _ in types:
+            entries.append((type_data["name"], strings.offsets[type_data["name"]], type_data["id"]))
+            for alias in type_data.get("aliases", []):
+                entries.append((alias, strings.offsets[alias], type_data["id"]))
+        type_index_offset = write_name_index(writer, entries)
 
-    head_writer = BinWriter(arch*2, arch)
+        for record_offset, (type_data, _, field_names, _) in zip(type_record_offsets, types):
+            if not field_names:
+                continue
+            entries = [(name, strings.offsets[name], i) for i, name in enumerate(field_names)]
+            # patch field_index of the type record
+            writer.patch(record_offset + 24, "<I", write_name_index(writer, entries))
 
-    # header
-    head_writer.write_arch_size(arch * 2) # location of global string literal volume
-    head_writer.write_arch_size(arch * 2 + global_string_writer.offset) # location of actual table data
+            if type_data["type"] == "enum":
+                values = [field.get("value", 0) for field in type_data.get("fields", [])]
+                # patch value_index of the type record
+                writer.patch(record_offset + 36, "<I", write_value_index(writer, values))
 
-    writer.write_arch_size(len(type_name_map))
+    writer.align()
+    strings_offset = writer.offset
+    writer.data += strings.data
+    writer.align()
 
-    for type_data in type_name_map.values():
-        if type_data["type"] == "base":
-            writer.write_arch_size(type_data["id"])
-            writer.write_uint8(1)  # base type code
-            writer.write_arch_size(global_string_volume[type_data["name"]])
-            writer.write_arch_size(type_data.get("size", 0))
-        else:
-            writer.write_arch_size(type_data["id"])
-            writer.write_uint8(object_types.get(type_data["type"], 0))
-            writer.write_arch_size(global_string_volume[type_data["name"]])
-            writer.write_arch_size(type_data.get("size", 0))
-            field_count_offset = writer.offset
-            writer.write_arch_size(0)  # placeholder for field count
-            field_count = 0
-            for field in type_data.get("fields", []):
-                if type_data["type"] != "enum":
-                    if field.get("struct", False) and field.get("type", "") not in type_name_map:
-                        continue
-                    writer.write_arch_size(global_string_volume[field.get("name", "")])
-                    writer.write_bool(field.get("const", False))
-                    writer.write_uint32(field.get("pdepth", 0))
-                    writer.write_arch_size(field.get("offset", 0))
-                    writer.write_arch_size(field.get("arrsize", 0))
-                    ftype = field.get("type", "")
-                    ref_id = type_name_map[ftype]["id"] if ftype in type_name_map else 0
-                    writer.write_arch_size(ref_id)
-                    field_count += 1
-                else:
-                    writer.write_arch_size(global_string_volume[field.get("name", "")])
-                    writer.write_arch_size(field.get("value", 0))
-                    field_count += 1
-            current_offset = writer.offset
-            if arch == 8:
-                struct.pack_into("<q", writer.data,
-                                 field_count_offset, field_count)
-            else:
-                struct.pack_into("<I", writer.data,
-                                 field_count_offset, field_count)
-            writer.offset = current_offset
+    writer.patch(0, BLOB_HEADER_FORMAT, BLOB_MAGIC, BLOB_VERSION, writer.offset, len(types),
+                 types_offset, fields_offset, len(fields), enum_fields_offset, len(enum_fields),
+                 aliases_offset, len(aliases), strings_offset, len(strings.data), type_index_offset)
 
-            # aliases
-            writer.write_arch_size(len(type_data.get("aliases", [])))
-            for alias in type_data.get("aliases", []):
-                writer.write_arch_size(global_string_volume[alias])
+    full_data = writer.data
+
+    if header_file is not None:
+        write_generated_header(header_file, types)
 
     with open(output_file, "wb") as f:
-        f.write(head_writer.data[:head_writer.offset])
-        f.write(global_string_writer.data[:global_string_writer.offset])
-        f.write(writer.data[:writer.offset])
+        f.write(full_data)
 
     # For linking reflection.dat directly with binary
     with open(output_asm_file, "w") as f:
@@ -274,10 +625,9 @@ def write_reflection_dat(output_file, output_asm_file, output_c_file):
 
         f.write("    .global _reflection_dat_start\n")
         f.write("    .global _reflection_dat_end\n")
+        f.write("    .balign 8\n")
         f.write("_reflection_dat_start:\n")
 
-        full_data = head_writer.data[:head_writer.offset] + global_string_writer.data[:global_string_writer.offset] + writer.data[:writer.offset]
-
         for i, byte in enumerate(full_data):
             if i % 12 == 0:
                 f.write("\n    .byte ")
@@ -294,7 +644,7 @@ def write_reflection_dat(output_file, output_asm_file, output_c_file):
         f.write("#endif\n")
         
     with open(output_c_file, "w") as f:
-        f.write("const unsigned char _reflection_dat_start[] = {\n")
+        f.write("__attribute__((aligned(8))) const unsigned char _reflection_dat_start[] = {\n")
     
         for i, byte in enumerate(full_data):
             if i % 12 == 0:
@@ -309,20 +659,106 @@ def write_reflection_dat(output_file, output_asm_file, output_c_file):
         f.write("};\n\n")
 
 
+def write_layout_report(root_dir, output_file):
+    # Ranks the records of every TU layout report. A record seen by several TUs counts once (the newest
+    # report wins, like type definitions) and is weighted by how often the other records embed it by value.
+    files = sorted(glob.glob(os.path.join(root_dir, "**", "*.layout.json"), recursive=True), key=os.path.getmtime)
+    if not files:
+        print("No layout reports found, compile with the plugin argument layout-report.")
+        return
+
+    records = {}
+    for file in files:
+        with open(file, "r") as f:
+            report = json.load(f)
+        if report.get("version") != LAYOUT_REPORT_VERSION:
+            print(f"Skipping {file}: layout report version {report.get('version')}")
+            continue
+        for record in report["records"]:
+            if record["name"]:
+                records[record["name"]] = record
+
+    instances = {name: 0 for name in records}
+    for record in records.values():
+        for embed in record["embeds"]:
+            if embed["type"] in instances:
+                instances[embed["type"]] += embed["count"]
+
+    ranking = []
+    for name, record in records.items():
+        ranking.append({
+            "name": name,
+            "variant": record["variant"],
+            "file": record["file"],
+            "line": record["line"],
+            "size": record["size"],
+            "padding": record["padding"],
+            "minimized_size": record["minimized_size"],
+            "straddling": [field["field"] for field in record["straddling"]],
+            "embedded_instances": instances[name],
+            "weighted_waste": record["padding"] * (1 + instances[name]),
+            "suggested_order": record["suggested_order"],
+        })
+    ranking.sort(key=lambda r: (-r["weighted_waste"], -r["padding"], r["name"]))
+
+    summary = {
+        "version": LAYOUT_REPORT_VERSION,
+        "reports": len(files),
+        "records": len(ranking),
+        "padding": sum(r["padding"] for r in ranking),
+        "weighted_waste": sum(r["weighted_waste"] for r in ranking),
+        "reorder_savings": sum(r["size"] - r["minimized_size"] for r in ranking),
+        "ranking": ranking,
+    }
+    with open(output_file, "w") as f:
+        json.dump(summary, f, indent=4)
+
+    print(f"Layout: {summary['records']} records from {summary['reports']} reports, {summary['padding']} bytes of padding "
+          f"({summary['weighted_waste']} weighted by embedding), {summary['reorder_savings']} bytes saved by reordering")
+    for r in ranking[:LAYOUT_SUMMARY_RECORDS]:
+        if r["weighted_waste"] == 0:
+            break
+        line = f"  {r['name']} ({r['file']}:{r['line']}): {r['padding']} of {r['size']} bytes padding"
+        if r["embedded_instances"]:
+            line += f", embedded {r['embedded_instances']}x"
+        if r["suggested_order"]:
+            line += f", {r['minimized_size']} bytes as {{{', '.join(r['suggested_order'])}}}"
+        print(line)
+
+
 def main():
     global type_name_map, arch
 
-    if len(sys.argv) > 2:
-        root_dir = sys.argv[1]
-        out_dir = sys.argv[2]
-    else:
-        raise Exception("Missing object file path or output path")
-
-    parse_reflection_files(root_dir)
-    output_file = os.path.join(out_dir, "reflection.dat")
-    output_asm_file = os.path.join(out_dir, "reflection.dat.S")
-    output_c_file = os.path.join(out_dir, "reflection.dat.c")
-    write_reflection_dat(output_file, output_asm_file, output_c_file)
+    parser = argparse.ArgumentParser(description="Merge *.reflection.dat files into the runtime type table")
+    parser.add_argument("root_dir", help="Directory searched recursively for *.reflection.dat files")
+    parser.add_argument("out_dir", help="Directory receiving reflection.dat, reflection.dat.S and reflection.dat.c")
+    parser.add_argument("--no-index", action="store_true",
+                        help="Omit the prebuilt name and enum value indexes (smaller blob, reflect_load_bytes rebuilds them "
+                             "at load time and reflect_load_mapped is unavailable)")
+    parser.add_argument("--header", metavar="PATH",
+                        help="Also write a C header with type ids, sizes, field offsets and field indexes "
+                             "for REFLECT_TYPE and REFLECT_FIELD_PTR")
+    parser.add_argument("--error-on-conflict", action="store_true",
+                        help="Fail instead of warning when a type name has different definitions across TUs")
+    parser.add_argument("--nested", choices=("flattened", "hierarchical"), default="flattened",
+                        help="hierarchical keeps embedded structs as one field referencing their type instead of "
+                             "also listing their members as outer.inner fields, the runtime resolves dotted names through them")
+    parser.add_argument("--layout-report", metavar="PATH",
+                        help="Rank the records of the *.layout.json reports found in root_dir by wasted bytes "
+                             "and write the ranking to PATH")
+    args = parser.parse_args()
+
+    parse_reflection_files(args.root_dir)
+    if odr_conflicts and args.error_on_conflict:
+        raise SystemExit(1)
+    if args.nested == "hierarchical":
+        collapse_nested_fields()
+    output_file = os.path.join(args.out_dir, "reflection.dat")
+    output_asm_file = os.path.join(args.out_dir, "reflection.dat.S")
+    output_c_file = os.path.join(args.out_dir, "reflection.dat.c")
+    write_reflection_dat(output_file, output_asm_file, output_c_file, not args.no_index, args.header)
+    if args.layout_report:
+        write_layout_report(args.root_dir, args.layout_report)
 
 
 if __name__ == "__main__":
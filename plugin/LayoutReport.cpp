@@ -0,0 +1,308 @@
+#include "LayoutReport.hpp"
+
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/JSON.h"
+#include <algorithm>
+#include <set>
+#include <unordered_map>
+
+namespace {
+
+// Records printed by PrintSummary()
+constexpr size_t SUMMARY_RECORDS = 5;
+
+uint64_t alignTo(const uint64_t value, const uint64_t align) {
+    return align > 1 ? (value + align - 1) / align * align : value;
+}
+
+uint64_t bytesEnd(const LayoutField &field) {
+    return (field.OffsetBits + field.SizeBits + 7) / 8;
+}
+
+// Fields that move together in the suggested order, a run of bit-fields shares its storage
+struct LayoutBlock {
+    std::vector<size_t> Fields;
+    uint64_t Size = 0;
+    uint64_t Align = 1;
+    bool IsHot = false;
+};
+
+std::vector<LayoutBlock> collectBlocks(const LayoutRecord &record) {
+    std::vector<LayoutBlock> blocks;
+
+    for (size_t i = 0; i < record.Fields.size(); i++) {
+        const LayoutField &field = record.Fields[i];
+        const bool joins = field.IsBitField && i > 0 && record.Fields[i - 1].IsBitField;
+
+        if (!joins) {
+            blocks.emplace_back();
+        }
+
+        LayoutBlock &block = blocks.back();
+        const uint64_t start = record.Fields[block.Fields.empty() ? i : block.Fields.front()].OffsetBits / 8;
+        block.Fields.push_back(i);
+        block.Size = std::max(block.Size, bytesEnd(field) - start);
+        block.Align = std::max(block.Align, field.Align);
+        block.IsHot |= field.IsHot;
+    }
+    return blocks;
+}
+
+unsigned linesTouched(const std::vector<std::pair<uint64_t, uint64_t>> &ranges) {
+    std::set<uint64_t> lines;
+    for (const auto &[begin, end] : ranges) {
+        for (uint64_t line = begin / LAYOUT_CACHE_LINE; end > begin && line <= (end - 1) / LAYOUT_CACHE_LINE; line++) {
+            lines.insert(line);
+        }
+    }
+    return static_cast<unsigned>(lines.size());
+}
+
+void suggestOrder(const LayoutRecord &record, LayoutAnalysis &analysis) {
+    std::vector<LayoutBlock> blocks = collectBlocks(record);
+    std::vector<std::pair<uint64_t, uint64_t>> hotRanges;
+
+    for (const LayoutBlock &block : blocks) {
+        if (block.IsHot) {
+            const uint64_t start = record.Fields[block.Fields.front()].OffsetBits / 8;
+            hotRanges.emplace_back(start, start + block.Size);
+        }
+    }
+    analysis.HotLines = linesTouched(hotRanges);
+    analysis.SuggestedHotLines = analysis.HotLines;
+
+    // a flexible array member has to stay last
+    const bool flexible = !record.Fields.empty() && record.Fields.back().IsFlexibleArray;
+    const auto sortEnd = flexible ? blocks.end() - 1 : blocks.end();
+
+    // hot fields first, then by decreasing alignment and size, which leaves no holes between naturally aligned fields
+    std::stable_sort(blocks.begin(), sortEnd, [](const LayoutBlock &a, const LayoutBlock &b) {
+        if (a.IsHot != b.IsHot)
+            return a.IsHot;
+        if (a.Align != b.Align)
+            return a.Align > b.Align;
+        return a.Size > b.Size;
+    });
+
+    uint64_t offset = 0;
+    hotRanges.clear();
+    for (const LayoutBlock &block : blocks) {
+        offset = alignTo(offset, block.Align);
+        if (block.IsHot) {
+            hotRanges.emplace_back(offset, offset + block.Size);
+        }
+        offset += block.Size;
+    }
+
+    const uint64_t size = alignTo(offset, record.Align);
+    const unsigned hotLines = linesTouched(hotRanges);
+
+    if (size >= record.Size && hotLines >= analysis.HotLines)
+        return;
+
+    analysis.MinimizedSize = std::min(size, record.Size);
+    analysis.SuggestedHotLines = hotLines;
+    for (const LayoutBlock &block : blocks) {
+        for (const size_t i : block.Fields) {
+            analysis.SuggestedOrder.push_back(record.Fields[i].Name);
+        }
+    }
+}
+
+} // namespace
+
+LayoutAnalysis AnalyzeLayout(const LayoutRecord &record) {
+    LayoutAnalysis analysis;
+    analysis.MinimizedSize = record.Size;
+
+    if (record.IsUnion) {
+        uint64_t largest = 0;
+        for (const LayoutField &field : record.Fields) {
+            largest = std::max(largest, bytesEnd(field));
+        }
+        if (largest < record.Size) {
+            analysis.Holes.push_back({largest, record.Size - largest, ""});
+            analysis.TailPadding = record.Size - largest;
+        }
+    } else {
+        uint64_t end = 0;
+        const LayoutField *previous = nullptr;
+
+        for (const LayoutField &field : record.Fields) {
+            const uint64_t start = field.OffsetBits / 8;
+            if (start > end && previous != nullptr) {
+                analysis.Holes.push_back({end, start - end, previous->Name});
+            }
+            end = std::max(end, bytesEnd(field));
+            previous = &field;
+        }
+        if (end < record.Size && previous != nullptr) {
+            analysis.Holes.push_back({end, record.Size - end, previous->Name});
+            analysis.TailPadding = record.Size - end;
+        }
+    }
+
+    for (const LayoutHole &hole : analysis.Holes) {
+        analysis.Padding += hole.Size;
+    }
+
+    for (size_t i = 0; i < record.Fields.size(); i++) {
+        const LayoutField &field = record.Fields[i];
+        const uint64_t start = field.OffsetBits / 8;
+        const uint64_t size = bytesEnd(field) - start;
+
+        if (size > 0 && size <= LAYOUT_CACHE_LINE && start / LAYOUT_CACHE_LINE != (start + size - 1) / LAYOUT_CACHE_LINE) {
+            analysis.Straddling.push_back(i);
+        }
+    }
+
+    if (!record.IsUnion && !record.IsPacked) {
+        suggestOrder(record, analysis);
+    }
+    return analysis;
+}
+
+void LayoutReport::Add(LayoutRecord record) {
+    LayoutAnalysis analysis = AnalyzeLayout(record);
+    Entries.push_back({std::move(record), std::move(analysis)});
+}
+
+void LayoutReport::Finish() {
+    std::unordered_map<std::string, Entry*> byName;
+    for (Entry &entry : Entries) {
+        byName.emplace(entry.Record.Name, &entry);
+    }
+
+    for (const Entry &entry : Entries) {
+        for (const LayoutField &field : entry.Record.Fields) {
+            if (const auto it = byName.find(field.Embedded); !field.Embedded.empty() && it != byName.end()) {
+                it->second->EmbeddedInstances += field.EmbeddedCount;
+            }
+        }
+    }
+
+    for (Entry &entry : Entries) {
+        entry.WeightedWaste = entry.Analysis.Padding * (1 + entry.EmbeddedInstances);
+    }
+
+    std::stable_sort(Entries.begin(), Entries.end(), [](const Entry &a, const Entry &b) {
+        return a.WeightedWaste > b.WeightedWaste;
+    });
+}
+
+bool LayoutReport::WriteJson(const std::string &outputFile, const llvm::StringRef sourceFile) const {
+    std::error_code error;
+    llvm::raw_fd_ostream out(outputFile, error, llvm::sys::fs::OF_Text);
+    if (error)
+        return false;
+
+    uint64_t padding = 0, weighted = 0, savings = 0;
+    for (const Entry &entry : Entries) {
+        padding += entry.Analysis.Padding;
+        weighted += entry.WeightedWaste;
+        savings += entry.Record.Size - entry.Analysis.MinimizedSize;
+    }
+
+    llvm::json::OStream json(out, 2);
+    json.object([&] {
+        json.attribute("version", LAYOUT_REPORT_VERSION);
+        json.attribute("source", sourceFile);
+        json.attribute("cache_line", LAYOUT_CACHE_LINE);
+        json.attribute("padding", padding);
+        json.attribute("weighted_waste", weighted);
+        json.attribute("reorder_savings", savings);
+        json.attributeArray("records", [&] {
+            for (const Entry &entry : Entries) {
+                const LayoutRecord &record = entry.Record;
+                const LayoutAnalysis &analysis = entry.Analysis;
+
+                json.object([&] {
+                    json.attribute("name", record.Name);
+                    json.attribute("variant", record.IsUnion ? "union" : "struct");
+                    json.attribute("file", record.File);
+                    json.attribute("line", record.Line);
+                    json.attribute("size", record.Size);
+                    json.attribute("align", record.Align);
+                    json.attribute("padding", analysis.Padding);
+                    json.attribute("tail_padding", analysis.TailPadding);
+                    json.attribute("embedded_instances", entry.EmbeddedInstances);
+                    json.attribute("weighted_waste", entry.WeightedWaste);
+                    json.attribute("minimized_size", analysis.MinimizedSize);
+                    json.attribute("hot_lines", analysis.HotLines);
+                    json.attribute("suggested_hot_lines", analysis.SuggestedHotLines);
+                    json.attributeArray("holes", [&] {
+                        for (const LayoutHole &hole : analysis.Holes) {
+                            json.object([&] {
+                                json.attribute("offset", hole.Offset);
+                                json.attribute("size", hole.Size);
+                                json.attribute("after", hole.After);
+                            });
+                        }
+                    });
+                    json.attributeArray("straddling", [&] {
+                        for (const size_t i : analysis.Straddling) {
+                            const LayoutField &field = record.Fields[i];
+                            json.object([&] {
+                                json.attribute("field", field.Name);
+                                json.attribute("offset", field.OffsetBits / 8);
+                                json.attribute("size", bytesEnd(field) - field.OffsetBits / 8);
+                            });
+                        }
+                    });
+                    json.attributeArray("suggested_order", [&] {
+                        for (const std::string &name : analysis.SuggestedOrder) {
+                            json.value(name);
+                        }
+                    });
+                    json.attributeArray("embeds", [&] {
+                        for (const LayoutField &field : record.Fields) {
+                            if (!field.Embedded.empty()) {
+                                json.object([&] {
+                                    json.attribute("type", field.Embedded);
+                                    json.attribute("count", field.EmbeddedCount);
+                                });
+                            }
+                        }
+                    });
+                });
+            }
+        });
+    });
+    out << "\n";
+    return true;
+}
+
+void LayoutReport::PrintSummary(llvm::raw_ostream &os, const llvm::StringRef sourceFile) const {
+    uint64_t padding = 0, weighted = 0, savings = 0;
+    size_t padded = 0, straddling = 0;
+
+    for (const Entry &entry : Entries) {
+        padding += entry.Analysis.Padding;
+        weighted += entry.WeightedWaste;
+        savings += entry.Record.Size - entry.Analysis.MinimizedSize;
+        padded += entry.Analysis.Padding > 0;
+        straddling += entry.Analysis.Straddling.size();
+    }
+
+    os << "reflect-clang-plugin: " << sourceFile << ": " << Entries.size() << " records, " << padded << " padded, "
+       << padding << " bytes of padding (" << weighted << " weighted by embedding), " << savings
+       << " bytes saved by reordering, " << straddling << " fields straddling a cache line\n";
+
+    for (size_t i = 0; i < Entries.size() && i < SUMMARY_RECORDS && Entries[i].WeightedWaste > 0; i++) {
+        const Entry &entry = Entries[i];
+
+        os << "  " << entry.Record.Name << " (" << entry.Record.File << ":" << entry.Record.Line << "): "
+           << entry.Analysis.Padding << " of " << entry.Record.Size << " bytes padding";
+        if (entry.EmbeddedInstances > 0) {
+            os << ", embedded " << entry.EmbeddedInstances << "x";
+        }
+        if (!entry.Analysis.SuggestedOrder.empty()) {
+            os << ", " << entry.Analysis.MinimizedSize << " bytes as {";
+            for (size_t j = 0; j < entry.Analysis.SuggestedOrder.size(); j++) {
+                os << (j > 0 ? ", " : "") << entry.Analysis.SuggestedOrder[j];
+            }
+            os << "}";
+        }
+        os << "\n";
+    }
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/raw_ostream.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// "-plugin-arg-reflect-clang-plugin layout-report" writes <object>.layout.json next to the fragment and
+// prints a summary of the worst records to stderr. merge.py --layout-report ranks the records of all TUs.
+// Offsets are relative to the start of the record, cache lines assume the record starts on one.
+constexpr uint64_t LAYOUT_CACHE_LINE = 64;
+constexpr unsigned LAYOUT_REPORT_VERSION = 1;
+
+// A direct field of a record as laid out by the compiler, filled in from its ASTRecordLayout
+struct LayoutField {
+    std::string Name;
+    uint64_t OffsetBits = 0;
+    uint64_t SizeBits = 0;      // the bit width for bit-fields
+    uint64_t Align = 1;         // bytes
+    bool IsBitField = false;
+    bool IsFlexibleArray = false;
+    bool IsHot = false;         // __attribute__((annotate("reflect_hot"))), packed first by the suggested order
+    std::string Embedded;       // record type held by value (also as array elements), "" otherwise
+    uint64_t EmbeddedCount = 0; // how many of it
+};
+
+struct LayoutRecord {
+    std::string Name;
+    std::string File;
+    unsigned Line = 0;
+    bool IsUnion = false;
+    bool IsPacked = false;
+    uint64_t Size = 0;
+    uint64_t Align = 1;
+    std::vector<LayoutField> Fields;
+};
+
+struct LayoutHole {
+    uint64_t Offset;
+    uint64_t Size;
+    std::string After; // the field before the hole, "" at the start of a union
+};
+
+struct LayoutAnalysis {
+    std::vector<LayoutHole> Holes; // in offset order, tail padding last
+    uint64_t Padding = 0;          // holes and tail padding
+    uint64_t TailPadding = 0;
+    std::vector<size_t> Straddling; // fields of at most a line that cross a line boundary
+    uint64_t MinimizedSize = 0;    // size with the suggested order, the current size if there is none
+    std::vector<std::string> SuggestedOrder; // empty unless it is smaller or touches fewer lines with hot fields
+    unsigned HotLines = 0;         // cache lines touched by hot fields
+    unsigned SuggestedHotLines = 0;
+};
+
+// Unions and packed records get no suggested order. Runs of bit-fields move as one block, which makes the
+// suggested size an estimate for records that have them.
+LayoutAnalysis AnalyzeLayout(const LayoutRecord &record);
+
+class LayoutReport {
+public:
+    void Add(LayoutRecord record);
+    // Weighs every record by how often the others embed it, call after the last Add()
+    void Finish();
+
+    [[nodiscard]] bool WriteJson(const std::string &outputFile, llvm::StringRef sourceFile) const;
+    void PrintSummary(llvm::raw_ostream &os, llvm::StringRef sourceFile) const;
+
+private:
+    struct Entry {
+        LayoutRecord Record;
+        LayoutAnalysis Analysis;
+        uint64_t EmbeddedInstances = 0; // held by value in the other records of the TU
+        uint64_t WeightedWaste = 0;     // Padding * (1 + EmbeddedInstances)
+    };
+
+    std::vector<Entry> Entries;
+};
@@ -1,25 +1,117 @@
 #include "ReflectConsumer.hpp"
 #include <clang/Basic/TargetInfo.h>
 
+#include "LayoutReport.hpp"
 #include "ReflectionDataSerializer.hpp"
 #include "clang/AST/ASTContext.h"
+#include "clang/AST/Attr.h"
+#include "clang/AST/RecordLayout.h"
+#include "clang/Basic/SourceManager.h"
 #include "llvm/Support/raw_ostream.h"
 
-ReflectClangConsumer::ReflectClangConsumer(clang::ASTContext &context, std::string outputFile)
-    : Visitor(context), OutputFile(std::move(outputFile)) {}
+// The name the visitor registers a record under, "" for records with neither a name nor a typedef
+static std::string RecordName(const clang::RecordDecl *RD) {
+    if (!RD->getName().empty())
+        return RD->getNameAsString();
+    if (const clang::TypedefNameDecl *tnd = RD->getTypedefNameForAnonDecl())
+        return tnd->getNameAsString();
+    return "";
+}
+
+static LayoutRecord DescribeLayout(const clang::ASTContext &context, const clang::RecordDecl *RD, const std::string &name) {
+    const clang::ASTRecordLayout &layout = context.getASTRecordLayout(RD);
+    const clang::SourceManager &SM = context.getSourceManager();
+    const clang::PresumedLoc loc = SM.getPresumedLoc(SM.getExpansionLoc(RD->getLocation()));
+
+    LayoutRecord record;
+    record.Name = name;
+    record.File = loc.isValid() ? loc.getFilename() : "";
+    record.Line = loc.isValid() ? loc.getLine() : 0;
+    record.IsUnion = RD->isUnion();
+    record.IsPacked = RD->hasAttr<clang::PackedAttr>();
+    record.Size = layout.getSize().getQuantity();
+    record.Align = layout.getAlignment().getQuantity();
+
+    unsigned index = 0;
+    for (const clang::FieldDecl *field : RD->fields()) {
+        LayoutField fi;
+        fi.Name = field->getNameAsString();
+        fi.OffsetBits = layout.getFieldOffset(index++);
+        fi.IsBitField = field->isBitField();
+        fi.IsFlexibleArray = field->getType()->isIncompleteArrayType();
+        fi.Align = context.getDeclAlign(field).getQuantity();
+
+        if (fi.IsBitField)
+            fi.SizeBits = field->getBitWidth()->EvaluateKnownConstInt(context).getZExtValue();
+        else if (!fi.IsFlexibleArray)
+            fi.SizeBits = context.getTypeSize(field->getType());
+
+        for (const auto *attr : field->specific_attrs<clang::AnnotateAttr>())
+            fi.IsHot |= attr->getAnnotation() == "reflect_hot";
+
+        clang::QualType element = field->getType();
+        uint64_t count = 1;
+        while (const clang::ConstantArrayType *array = context.getAsConstantArrayType(element)) {
+            count *= array->getSize().getZExtValue();
+            element = array->getElementType();
+        }
+        if (const auto *RT = element->getAs<clang::RecordType>()) {
+            fi.Embedded = RecordName(RT->getDecl());
+            fi.EmbeddedCount = fi.Embedded.empty() ? 0 : count;
+        }
+
+        record.Fields.push_back(std::move(fi));
+    }
+    return record;
+}
+
+ReflectClangConsumer::ReflectClangConsumer(clang::ASTContext &context, std::string outputFile, ReflectOptions options)
+    : Options(std::move(options)), Visitor(context, Options), OutputFile(std::move(outputFile)) {}
 
 void ReflectClangConsumer::HandleTranslationUnit(clang::ASTContext &context) {
     Visitor.TraverseDecl(context.getTranslationUnitDecl());
     Visitor.MergePendingAliases();
 
+    const clang::SourceManager &SM = context.getSourceManager();
+    const auto mainFile = SM.getFileEntryRefForID(SM.getMainFileID());
+    const llvm::StringRef fileName = mainFile ? mainFile->getName() : llvm::StringRef("<stdin>");
+
+    if (Options.HasFilters()) {
+        const ReflectFilterStats stats = Visitor.ApplyFilters();
+
+        if (stats.Dropped() > 0) {
+            llvm::errs() << "reflect-clang-plugin: " << fileName << ": kept "
+                         << stats.Kept << " of " << stats.Total << " types (" << stats.Referenced << " by reference), dropped "
+                         << stats.NotAnnotated << " not annotated, " << stats.NotMainFile << " outside the main file, "
+                         << stats.SystemHeader << " from system headers, " << stats.PathFiltered << " by path\n";
+        }
+    }
+
     const auto &baseTypesMap = Visitor.GetBaseTypes();
     const auto &enumResults  = Visitor.GetEnumResults();
     const auto &recResults   = Visitor.GetResults();
 
+    // Only the records that end up reflected, so filters narrow the report down too
+    if (Options.WriteLayoutReport) {
+        LayoutReport report;
+        for (const RecordInfo &record : recResults) {
+            if (const auto *RD = static_cast<const clang::RecordDecl*>(record.RD)->getDefinition())
+                report.Add(DescribeLayout(context, RD, record.Name));
+        }
+        report.Finish();
+        report.PrintSummary(llvm::errs(), fileName);
+
+        llvm::StringRef base(OutputFile);
+        base.consume_back(".reflection.dat");
+        if (const std::string layoutFile = (base + ".layout.json").str(); !report.WriteJson(layoutFile, fileName)) {
+            llvm::errs() << "Error: could not write " << layoutFile << "\n";
+        }
+    }
+
     // TODO: move this to some function
     const size_t archSize = context.getTargetInfo().getPointerWidth(clang::LangAS::Default) / 8;
 
-    if (const ReflectionDataSerializer serializer(OutputFile); !serializer.serialize(baseTypesMap, recResults, enumResults, archSize)) {
+    if (const ReflectionDataSerializer serializer(OutputFile, Options.Format); !serializer.serialize(baseTypesMap, recResults, enumResults, archSize)) {
         llvm::errs() << "Error: reflection.dat serialization failed.\n";
     }
 }
@@ -3,14 +3,16 @@
 #include "clang/AST/ASTConsumer.h"
 #include "clang/AST/ASTContext.h"
 #include "ReflectVisitor.hpp"
+#include "ReflectOptions.hpp"
 #include <string>
 
 class ReflectClangConsumer final : public clang::ASTConsumer {
 public:
-    explicit ReflectClangConsumer(clang::ASTContext &context, std::string outputFile);
+    ReflectClangConsumer(clang::ASTContext &context, std::string outputFile, ReflectOptions options);
     void HandleTranslationUnit(clang::ASTContext &context) override;
 
 private:
+    ReflectOptions Options; // before Visitor, which keeps a reference
     ReflectClangVisitor Visitor;
     std::string OutputFile;
 };
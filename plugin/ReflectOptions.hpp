@@ -0,0 +1,24 @@
+#pragma once
+
+#include "ReflectionDataSerializer.hpp"
+#include "llvm/Support/GlobPattern.h"
+#include <vector>
+
+// Set through -plugin-arg-reflect-clang-plugin, see ReflectClangPluginAction::ParseArgs().
+// Without any filter every complete record and enum of the TU is reflected. With filters only the
+// types passing all of them are roots, and the records and enums their fields reference (directly
+// or through other referenced types) are kept along with them.
+struct ReflectOptions {
+    ReflectionDataFormat Format = ReflectionDataFormat::Binary;
+    bool AnnotatedOnly = false;     // annotated: roots need __attribute__((annotate("reflect")))
+    bool MainFileOnly = false;      // main-file-only: roots must be declared in the main file
+    bool SkipSystemHeaders = false; // skip-system: no roots from system headers
+    std::vector<llvm::GlobPattern> Allow; // allow=<glob>: roots must be declared in a file matching one
+    std::vector<llvm::GlobPattern> Deny;  // deny=<glob>: no roots from files matching any
+    bool HierarchicalNesting = false; // nested=hierarchical: embedded named records stay one field, not flattened
+    bool WriteLayoutReport = false; // layout-report: padding and cache line report per TU, see LayoutReport.hpp
+
+    [[nodiscard]] bool HasFilters() const {
+        return AnnotatedOnly || MainFileOnly || SkipSystemHeaders || !Allow.empty() || !Deny.empty();
+    }
+};
@@ -1,6 +1,7 @@
 #include "ReflectPluginAction.hpp"
 #include "ReflectConsumer.hpp"
 #include "clang/Frontend/CompilerInstance.h"
+#include "llvm/Support/raw_ostream.h"
 
 std::unique_ptr<clang::ASTConsumer> ReflectClangPluginAction::CreateASTConsumer(
     clang::CompilerInstance &CI, llvm::StringRef) {
@@ -8,11 +9,47 @@ std::unique_ptr<clang::ASTConsumer> ReflectClangPluginAction::CreateASTConsumer(
     std::string outputFile = CI.getFrontendOpts().OutputFile.substr(0,
                          CI.getFrontendOpts().OutputFile.find_last_of('.')) + ".reflection.dat";
 
-    return std::make_unique<ReflectClangConsumer>(CI.getASTContext(), outputFile);
+    return std::make_unique<ReflectClangConsumer>(CI.getASTContext(), outputFile, Options);
 }
 
+// -plugin-arg-reflect-clang-plugin <arg>, once per argument:
+//   format=text|binary, annotated, main-file-only, skip-system, allow=<glob>, deny=<glob>,
+//   nested=flattened|hierarchical, layout-report
+// Globs are matched against the file names as the compiler sees them (as passed or found on the include path).
 bool ReflectClangPluginAction::ParseArgs(const clang::CompilerInstance &CI,
                                            const std::vector<std::string> &args) {
+    for (const auto &arg : args) {
+        const llvm::StringRef value(arg);
+
+        if (arg == "format=text") {
+            Options.Format = ReflectionDataFormat::Text;
+        } else if (arg == "format=binary") {
+            Options.Format = ReflectionDataFormat::Binary;
+        } else if (arg == "annotated") {
+            Options.AnnotatedOnly = true;
+        } else if (arg == "main-file-only") {
+            Options.MainFileOnly = true;
+        } else if (arg == "skip-system") {
+            Options.SkipSystemHeaders = true;
+        } else if (arg == "nested=hierarchical") {
+            Options.HierarchicalNesting = true;
+        } else if (arg == "nested=flattened") {
+            Options.HierarchicalNesting = false;
+        } else if (arg == "layout-report") {
+            Options.WriteLayoutReport = true;
+        } else if (value.starts_with("allow=") || value.starts_with("deny=")) {
+            const bool allow = value.starts_with("allow=");
+            auto pattern = llvm::GlobPattern::create(value.drop_front(allow ? 6 : 5));
+            if (!pattern) {
+                llvm::errs() << "reflect-clang-plugin: invalid glob in '" << arg << "': " << llvm::toString(pattern.takeError()) << "\n";
+                return false;
+            }
+            (allow ? Options.Allow : Options.Deny).push_back(std::move(*pattern));
+        } else {
+            llvm::errs() << "reflect-clang-plugin: unknown argument '" << arg << "'\n";
+            return false;
+        }
+    }
     return true;
 }
 
@@ -3,6 +3,7 @@
 #include "clang/Frontend/FrontendPluginRegistry.h"
 #include "clang/Frontend/CompilerInstance.h"
 #include "clang/AST/ASTConsumer.h"
+#include "ReflectOptions.hpp"
 #include <memory>
 #include <string>
 
@@ -12,4 +13,7 @@ protected:
                                                           llvm::StringRef) override;
     bool ParseArgs(const clang::CompilerInstance &CI,
                    const std::vector<std::string> &args) override;
+
+private:
+    ReflectOptions Options;
 };
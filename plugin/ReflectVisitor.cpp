@@ -1,19 +1,24 @@
 #include "ReflectVisitor.hpp"
 
+#include "clang/AST/Attr.h"
 #include "clang/AST/Decl.h"
 #include "clang/AST/DeclCXX.h"
 #include "clang/AST/RecordLayout.h"
 #include "clang/AST/Type.h"
 #include "clang/AST/TypeLoc.h"
+#include "clang/Basic/SourceManager.h"
 #include "llvm/Support/raw_ostream.h"
 #include <clang/Basic/TargetInfo.h>
+#include <algorithm>
+#include <unordered_set>
 
 using namespace clang;
 
-ReflectClangVisitor::ReflectClangVisitor(ASTContext &context)
-    : Context(context), NextTypeID(1)
+ReflectClangVisitor::ReflectClangVisitor(ASTContext &context, const ReflectOptions &options)
+    : Context(context), Options(options), NextTypeID(1)
 {
     RegisterBaseTypes();
+    FirstFieldBaseTypeID = NextTypeID;
 }
 
 bool ReflectClangVisitor::VisitRecordDecl(RecordDecl *RD) {
@@ -36,6 +41,7 @@ bool ReflectClangVisitor::VisitRecordDecl(RecordDecl *RD) {
 
     RecordInfo record(variant, recName, layout.getSize().getQuantity(), NextTypeID++);
     record.RD = static_cast<const void*>(RD->getCanonicalDecl());
+    record.Filter = ClassifyDecl(RD);
 
     MergePendingAliasesFor(RD->getCanonicalDecl(), record);
 
@@ -66,7 +72,7 @@ bool ReflectClangVisitor::VisitRecordDecl(RecordDecl *RD) {
 
         if (const RecordType *RT = fieldType->getAs<RecordType>()) {
             // Nested field logic
-            if (RecordDecl *nestedRD = RT->getDecl(); nestedRD->isCompleteDefinition()) {
+            if (RecordDecl *nestedRD = RT->getDecl(); nestedRD->isCompleteDefinition() && ShouldFlatten(field, nestedRD)) {
                 // If we have an anonymous record, its nested fields are "flattened"
                 std::string prefix = field->getNameAsString().empty() ? "" : (field->getNameAsString() + ".");
                 ReflectNestedFields(nestedRD, prefix, record, layout.getFieldOffset(index) / 8);
@@ -100,6 +106,7 @@ bool ReflectClangVisitor::VisitEnumDecl(const EnumDecl *ED) {
     const size_t enumSize = Context.getTypeSizeInChars(enumType).getQuantity();
 
     EnumInfo en(ED->getCanonicalDecl(), enumName, enumSize, NextTypeID++);
+    en.Filter = ClassifyDecl(ED);
     MergePendingAliasesFor(ED->getCanonicalDecl(), en);
 
     for (const auto *e : ED->enumerators()) {
@@ -166,7 +173,7 @@ void ReflectClangVisitor::ReflectNestedFields(const RecordDecl *nestedRD, const
 
         if (const RecordType *nestedRT = nestedFieldType->getAs<RecordType>()) {
             if (const RecordDecl *nestedNestedRD = nestedRT->getDecl();
-                nestedNestedRD->isCompleteDefinition()) {
+                nestedNestedRD->isCompleteDefinition() && ShouldFlatten(nestedField, nestedNestedRD)) {
                 // anon struct handling again
                 std::string newPrefix = nestedField->getNameAsString().empty() ? prefix :
                                          (prefix + nestedField->getNameAsString() + ".");
@@ -178,6 +185,137 @@ void ReflectClangVisitor::ReflectNestedFields(const RecordDecl *nestedRD, const
     }
 }
 
+// With nested=hierarchical a field of a named record type only references that type and the runtime
+// resolves "field.member" through it. Anonymous members and records without a name have no type
+// to reference, so their members are still flattened into the enclosing record.
+bool ReflectClangVisitor::ShouldFlatten(const FieldDecl *field, const RecordDecl *nestedRD) const {
+    if (!Options.HierarchicalNesting || field->getName().empty())
+        return true;
+
+    return nestedRD->getName().empty() && nestedRD->getTypedefNameForAnonDecl() == nullptr;
+}
+
+// The first filter a declaration fails, Root if it passes all of them
+FilterResult ReflectClangVisitor::ClassifyDecl(const TagDecl *TD) const {
+    if (!Options.HasFilters())
+        return FilterResult::Root;
+
+    if (Options.AnnotatedOnly) {
+        bool annotated = false;
+        for (const TagDecl *redecl : TD->redecls()) {
+            for (const auto *attr : redecl->specific_attrs<AnnotateAttr>()) {
+                annotated |= attr->getAnnotation() == "reflect";
+            }
+        }
+        if (!annotated)
+            return FilterResult::NotAnnotated;
+    }
+
+    const SourceManager &SM = Context.getSourceManager();
+    const SourceLocation loc = SM.getExpansionLoc(TD->getLocation());
+
+    if (Options.MainFileOnly && !SM.isInMainFile(loc))
+        return FilterResult::NotMainFile;
+
+    if (Options.SkipSystemHeaders && SM.isInSystemHeader(loc))
+        return FilterResult::SystemHeader;
+
+    if (!Options.Allow.empty() || !Options.Deny.empty()) {
+        const StringRef file = SM.getFilename(loc);
+        const auto matches = [&](const std::vector<llvm::GlobPattern> &patterns) {
+            return std::any_of(patterns.begin(), patterns.end(), [&](const llvm::GlobPattern &p) { return p.match(file); });
+        };
+
+        if ((!Options.Allow.empty() && !matches(Options.Allow)) || matches(Options.Deny))
+            return FilterResult::PathFiltered;
+    }
+
+    return FilterResult::Root;
+}
+
+// Keeps the roots and every record and enum reachable from them through field types, drops the rest.
+// Names are resolved the way merge.py resolves them, so what is kept is exactly what the roots need.
+ReflectFilterStats ReflectClangVisitor::ApplyFilters() {
+    ReflectFilterStats stats;
+    std::unordered_map<std::string, const BaseType*> byName;
+    std::unordered_set<const BaseType*> kept;
+    std::unordered_set<std::string> fieldTypes;
+    std::vector<const RecordInfo*> pending;
+
+    for (const auto &record : Results)
+        byName.emplace(record.Name, &record);
+    for (const auto &en : EnumResults)
+        byName.emplace(en.Name, &en);
+
+    const auto keep = [&](const BaseType *type) {
+        if (kept.insert(type).second && type->Variant != TypeVariant::Enum)
+            pending.push_back(static_cast<const RecordInfo*>(type));
+    };
+
+    for (const auto &record : Results) {
+        if (record.Filter == FilterResult::Root)
+            keep(&record);
+    }
+    for (const auto &en : EnumResults) {
+        if (en.Filter == FilterResult::Root)
+            keep(&en);
+    }
+
+    while (!pending.empty()) {
+        const RecordInfo *record = pending.back();
+        pending.pop_back();
+
+        for (const auto &field : record->Fields) {
+            if (const auto it = byName.find(field.IsStructOrUnion ? field.StructOrUnionName : field.Type); it != byName.end())
+                keep(it->second);
+            fieldTypes.insert(field.Type);
+            fieldTypes.insert(field.Alias);
+        }
+    }
+
+    const auto count = [&](const BaseType &type) {
+        stats.Total++;
+        if (kept.count(&type)) {
+            stats.Kept++;
+            stats.Referenced += type.Filter != FilterResult::Root;
+            return;
+        }
+        switch (type.Filter) {
+            case FilterResult::NotAnnotated: stats.NotAnnotated++; break;
+            case FilterResult::NotMainFile: stats.NotMainFile++; break;
+            case FilterResult::SystemHeader: stats.SystemHeader++; break;
+            case FilterResult::PathFiltered: stats.PathFiltered++; break;
+            case FilterResult::Root: break;
+        }
+    };
+
+    std::vector<RecordInfo> records;
+    for (auto &record : Results) {
+        count(record);
+        if (kept.count(&record))
+            records.push_back(std::move(record));
+    }
+
+    std::vector<EnumInfo> enums;
+    for (auto &en : EnumResults) {
+        count(en);
+        if (kept.count(&en))
+            enums.push_back(std::move(en));
+    }
+
+    Results = std::move(records);
+    EnumResults = std::move(enums);
+
+    // base types first seen in fields (typedefs like __uint32_t) go with the records that used them
+    for (auto it = BaseTypes.begin(); it != BaseTypes.end();) {
+        const bool unused = it->second.Variant == TypeVariant::Base && it->second.TypeID >= FirstFieldBaseTypeID &&
+                            !fieldTypes.count(it->first);
+        it = unused ? BaseTypes.erase(it) : std::next(it);
+    }
+
+    return stats;
+}
+
 const std::vector<RecordInfo>& ReflectClangVisitor::GetResults() const {
     return Results;
 }
@@ -5,6 +5,7 @@
 #include "clang/AST/Decl.h"
 #include "clang/AST/Type.h"
 #include "ReflectionTypes.hpp"
+#include "ReflectOptions.hpp"
 
 #include <unordered_map>
 #include <vector>
@@ -18,15 +19,29 @@ namespace clang {
     class ConstantArrayType;
 }
 
+// Per TU counts of ReflectClangVisitor::ApplyFilters(), records and enums only
+struct ReflectFilterStats {
+    size_t Total = 0;
+    size_t Kept = 0;
+    size_t Referenced = 0; // kept only because a kept type's fields use them
+    size_t NotAnnotated = 0;
+    size_t NotMainFile = 0;
+    size_t SystemHeader = 0;
+    size_t PathFiltered = 0;
+
+    [[nodiscard]] size_t Dropped() const { return Total - Kept; }
+};
+
 class ReflectClangVisitor : public clang::RecursiveASTVisitor<ReflectClangVisitor> {
 public:
-    explicit ReflectClangVisitor(clang::ASTContext &context);
+    ReflectClangVisitor(clang::ASTContext &context, const ReflectOptions &options);
 
     bool VisitRecordDecl(clang::RecordDecl *RD);
     bool VisitEnumDecl(const clang::EnumDecl *ED);
     bool VisitTypedefDecl(const clang::TypedefDecl *TD);
 
     void MergePendingAliases();
+    ReflectFilterStats ApplyFilters();
     void ReflectNestedFields(const clang::RecordDecl *nestedRD, const std::string &prefix,
                               RecordInfo &record, size_t baseOffset);
 
@@ -36,6 +51,8 @@ public:
 
 private:
     FieldInfo CreateFieldInfo(const clang::FieldDecl *field, clang::QualType fieldType, size_t offset) const;
+    FilterResult ClassifyDecl(const clang::TagDecl *TD) const;
+    bool ShouldFlatten(const clang::FieldDecl *field, const clang::RecordDecl *nestedRD) const;
 
     template <typename T>
     void MergePendingAliasesFor(const clang::TagDecl *canonTD, T &target);
@@ -44,9 +61,11 @@ private:
     void RegisterBaseType(const std::string &name, size_t size);
 
     clang::ASTContext &Context;
+    const ReflectOptions &Options;
     std::vector<RecordInfo> Results;
     std::vector<EnumInfo> EnumResults;
     size_t NextTypeID;
+    size_t FirstFieldBaseTypeID; // base types registered from fields start here, the builtin ones come before
     std::unordered_map<std::string, BaseType> BaseTypes;
     std::unordered_map<const clang::TagDecl*, std::vector<std::string>> PendingAliases;
 };
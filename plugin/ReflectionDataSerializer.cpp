@@ -2,13 +2,147 @@
 #include <fstream>
 #include <iostream>
 
-ReflectionDataSerializer::ReflectionDataSerializer(std::string outputFile)
-    : OutputFile(std::move(outputFile)) {}
+namespace {
+
+// Offsets into the fragment string volume, each distinct string is stored once
+class StringTable {
+public:
+    StringTable() : Data(1, '\0') {}
+
+    uint32_t add(const std::string &s) {
+        if (s.empty()) {
+            return 0;
+        }
+        const auto [it, inserted] = Offsets.try_emplace(s, static_cast<uint32_t>(Data.size()));
+        if (inserted) {
+            Data.insert(Data.end(), s.begin(), s.end());
+            Data.push_back('\0');
+        }
+        return it->second;
+    }
+
+    std::vector<char> Data;
+
+private:
+    std::unordered_map<std::string, uint32_t> Offsets;
+};
+
+template <typename T>
+void append(std::vector<char> &out, const T &value) {
+    const char *bytes = reinterpret_cast<const char *>(&value);
+    out.insert(out.end(), bytes, bytes + sizeof(T));
+}
+
+void appendType(std::vector<char> &types, std::vector<uint32_t> &aliases, StringTable &strings, const BaseType &type,
+                const uint32_t variant, const size_t firstMember, const size_t memberCount) {
+    const size_t firstAlias = aliases.size();
+    for (const auto &alias : type.Aliases) {
+        if (alias != type.Name) {
+            aliases.push_back(strings.add(alias));
+        }
+    }
+
+    append(types, variant);
+    append(types, strings.add(type.Name));
+    append(types, static_cast<uint64_t>(type.Size));
+    append(types, StructuralFingerprint(type));
+    append(types, static_cast<uint32_t>(firstMember));
+    append(types, static_cast<uint32_t>(memberCount));
+    append(types, static_cast<uint32_t>(firstAlias));
+    append(types, static_cast<uint32_t>(aliases.size() - firstAlias));
+}
+
+} // namespace
+
+ReflectionDataSerializer::ReflectionDataSerializer(std::string outputFile, const ReflectionDataFormat format)
+    : OutputFile(std::move(outputFile)), Format(format) {}
 
 bool ReflectionDataSerializer::serialize(const std::unordered_map<std::string, BaseType> &baseTypes,
                                            const std::vector<RecordInfo> &records,
                                            const std::vector<EnumInfo> &enums,
                                            const size_t archSize) const {
+    if (Format == ReflectionDataFormat::Text) {
+        return serializeText(baseTypes, records, enums, archSize);
+    }
+    return serializeBinary(baseTypes, records, enums, archSize);
+}
+
+// The fragment is assembled in memory and written with a single call
+bool ReflectionDataSerializer::serializeBinary(const std::unordered_map<std::string, BaseType> &baseTypes,
+                                                 const std::vector<RecordInfo> &records,
+                                                 const std::vector<EnumInfo> &enums,
+                                                 const size_t archSize) const {
+    StringTable strings;
+    std::vector<char> types, fields, enumerators;
+    std::vector<uint32_t> aliases;
+    uint32_t typeCount = 0, fieldCount = 0, enumeratorCount = 0;
+
+    for (const auto &[fst, snd] : baseTypes) {
+        if (snd.Variant != TypeVariant::Base) {
+            continue;
+        }
+        appendType(types, aliases, strings, snd, 1, 0, 0);
+        typeCount++;
+    }
+
+    for (const auto &rec : records) {
+        appendType(types, aliases, strings, rec, rec.Variant == TypeVariant::Struct ? 2 : 3, fieldCount, rec.Fields.size());
+        typeCount++;
+
+        for (const auto &field : rec.Fields) {
+            append(fields, strings.add(field.Name));
+            append(fields, strings.add(field.IsStructOrUnion ? field.StructOrUnionName : field.Type));
+            append(fields, static_cast<uint32_t>(field.Offset));
+            append(fields, static_cast<uint32_t>(field.ArraySize));
+            append(fields, static_cast<uint32_t>(field.PointerDepth));
+            append(fields, static_cast<uint8_t>(field.IsConst));
+            append(fields, static_cast<uint8_t>(field.IsStructOrUnion));
+            append(fields, static_cast<uint16_t>(0));
+            fieldCount++;
+        }
+    }
+
+    for (const auto &en : enums) {
+        appendType(types, aliases, strings, en, 4, enumeratorCount, en.Enumerators.size());
+        typeCount++;
+
+        for (const auto &[ename, evalue] : en.Enumerators) {
+            append(enumerators, strings.add(ename));
+            append(enumerators, static_cast<uint32_t>(0));
+            append(enumerators, static_cast<int64_t>(evalue));
+            enumeratorCount++;
+        }
+    }
+
+    std::vector<char> out;
+    out.reserve(32 + types.size() + fields.size() + enumerators.size() + aliases.size() * 4 + strings.Data.size());
+    for (const uint32_t value : {REFLECTION_FRAGMENT_MAGIC, REFLECTION_FRAGMENT_VERSION, static_cast<uint32_t>(archSize),
+                                 typeCount, fieldCount, enumeratorCount, static_cast<uint32_t>(aliases.size()),
+                                 static_cast<uint32_t>(strings.Data.size())}) {
+        append(out, value);
+    }
+    out.insert(out.end(), types.begin(), types.end());
+    out.insert(out.end(), fields.begin(), fields.end());
+    out.insert(out.end(), enumerators.begin(), enumerators.end());
+    for (const uint32_t alias : aliases) {
+        append(out, alias);
+    }
+    out.insert(out.end(), strings.Data.begin(), strings.Data.end());
+
+    std::ofstream outFile(OutputFile, std::ios::out | std::ios::binary);
+    if (!outFile.is_open()) {
+        std::cerr << "Error: Could not open file " << OutputFile << " for writing\n";
+        return false;
+    }
+
+    outFile.write(out.data(), static_cast<std::streamsize>(out.size()));
+    return static_cast<bool>(outFile);
+}
+
+bool ReflectionDataSerializer::serializeText(const std::unordered_map<std::string, BaseType> &baseTypes,
+                                               const std::vector<RecordInfo> &records,
+                                               const std::vector<EnumInfo> &enums,
+                                               const size_t archSize) const {
     std::ofstream outFile(OutputFile, std::ios::out);
     if (!outFile.is_open()) {
         std::cerr << "Error: Could not open file " << OutputFile << " for writing\n";
@@ -30,6 +164,7 @@ bool ReflectionDataSerializer::serialize(const std::unordered_map<std::string, B
             }
         }
         outFile << "size " << bt.Size << "\n";
+        outFile << "fingerprint " << std::hex << StructuralFingerprint(bt) << std::dec << "\n";
     }
 
     for (const auto &rec : records) {
@@ -41,6 +176,7 @@ bool ReflectionDataSerializer::serialize(const std::unordered_map<std::string, B
             }
         }
         outFile << "size " << rec.Size << "\n";
+        outFile << "fingerprint " << std::hex << StructuralFingerprint(rec) << std::dec << "\n";
 
         for (const auto &field : rec.Fields) {
             outFile << "field\n"
@@ -63,6 +199,7 @@ bool ReflectionDataSerializer::serialize(const std::unordered_map<std::string, B
             }
         }
         outFile << "size " << en.Size << "\n";
+        outFile << "fingerprint " << std::hex << StructuralFingerprint(en) << std::dec << "\n";
         for (const auto &[ename, evalue] : en.Enumerators) {
             outFile << "enumerator\n";
             outFile << "ek " << ename << "\n";
@@ -5,14 +5,43 @@
 #include <unordered_map>
 #include <vector>
 
+// Binary fragments are the default, "-plugin-arg-reflect-clang-plugin format=text" writes the
+// line oriented format for debugging. merge/merge.py reads both.
+enum class ReflectionDataFormat {
+    Binary,
+    Text
+};
+
+// Binary fragment v2 in host byte order (merge.py reads it as little endian), sections back to back:
+//   header      uint32_t magic ("RFF1"), version, arch, type_count, field_count, enumerator_count, alias_count, strings_size
+//   types       type_count x { uint32_t variant, name; uint64_t size, fingerprint; uint32_t first_member, member_count, first_alias, alias_count }
+//   fields      field_count x { uint32_t name, type, offset, arr_size, ptr_depth; uint8_t is_const, is_struct, pad[2] }
+//   enumerators enumerator_count x { uint32_t name, pad; int64_t value }
+//   aliases     alias_count x uint32_t name
+//   strings     strings_size bytes of NUL terminated strings, names are byte offsets, offset 0 is ""
+// Members are fields for structs and unions and enumerators for enums, variant is 1 base, 2 struct, 3 union, 4 enum.
+// fingerprint is StructuralFingerprint(), v1 fragments had none.
+constexpr uint32_t REFLECTION_FRAGMENT_MAGIC = 0x31464652; // "RFF1"
+constexpr uint32_t REFLECTION_FRAGMENT_VERSION = 2;
+
 class ReflectionDataSerializer {
 public:
-    explicit ReflectionDataSerializer(std::string outputFile);
+    explicit ReflectionDataSerializer(std::string outputFile, ReflectionDataFormat format = ReflectionDataFormat::Binary);
     [[nodiscard]] bool serialize(const std::unordered_map<std::string, BaseType> &baseTypes,
                    const std::vector<RecordInfo> &records,
                    const std::vector<EnumInfo> &enums,
                    size_t archSize) const;
 
 private:
+    [[nodiscard]] bool serializeText(const std::unordered_map<std::string, BaseType> &baseTypes,
+                       const std::vector<RecordInfo> &records,
+                       const std::vector<EnumInfo> &enums,
+                       size_t archSize) const;
+    [[nodiscard]] bool serializeBinary(const std::unordered_map<std::string, BaseType> &baseTypes,
+                         const std::vector<RecordInfo> &records,
+                         const std::vector<EnumInfo> &enums,
+                         size_t archSize) const;
+
     std::string OutputFile;
+    ReflectionDataFormat Format;
 };
@@ -13,3 +13,57 @@ EnumInfo::EnumInfo(const void *ED, const std::string &name, const size_t size, c
 void EnumInfo::AddEnumerator(const std::string &name, int64_t value) {
     Enumerators.emplace_back(name, value);
 }
+
+namespace {
+
+class Fnv1a64 {
+public:
+    void token(const std::string &s) {
+        for (const char c : s) {
+            byte(static_cast<unsigned char>(c));
+        }
+        byte(0);
+    }
+
+    template <typename T>
+    void number(const T value) {
+        token(std::to_string(value));
+    }
+
+    uint64_t Value = 14695981039346656037ull;
+
+private:
+    void byte(const unsigned char c) {
+        Value = (Value ^ c) * 1099511628211ull;
+    }
+};
+
+} // namespace
+
+uint64_t StructuralFingerprint(const BaseType &type) {
+    static const char *variants[] = { "base", "struct", "union", "enum" };
+    Fnv1a64 hash;
+
+    hash.token(variants[static_cast<int>(type.Variant)]);
+    hash.token(type.Name);
+    hash.number(type.Size);
+
+    if (type.Variant == TypeVariant::Struct || type.Variant == TypeVariant::Union) {
+        for (const auto &field : static_cast<const RecordInfo &>(type).Fields) {
+            hash.token(field.Name);
+            hash.token(field.IsStructOrUnion ? field.StructOrUnionName : field.Type);
+            hash.number(field.Offset);
+            hash.number(field.ArraySize);
+            hash.number(field.PointerDepth);
+            hash.number(static_cast<int>(field.IsConst));
+            hash.number(static_cast<int>(field.IsStructOrUnion));
+        }
+    } else if (type.Variant == TypeVariant::Enum) {
+        for (const auto &[name, value] : static_cast<const EnumInfo &>(type).Enumerators) {
+            hash.token(name);
+            hash.number(value);
+        }
+    }
+
+    return hash.Value;
+}
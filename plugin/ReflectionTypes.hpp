@@ -12,6 +12,15 @@ enum class TypeVariant {
     Enum
 };
 
+// Why a record or enum is not a filter root, see ReflectClangVisitor::ApplyFilters()
+enum class FilterResult {
+    Root,
+    NotAnnotated,
+    NotMainFile,
+    SystemHeader,
+    PathFiltered
+};
+
 class BaseType {
 public:
     BaseType(const TypeVariant variant, std::string name, const size_t size, const size_t typeId)
@@ -24,6 +33,7 @@ public:
     size_t TypeID;
     // typedef aliases
     std::vector<std::string> Aliases; // this is technically only used for records and enums (typedef'd basetypes are added separately), should probably rework this
+    FilterResult Filter = FilterResult::Root;
 };
 
 class FieldInfo {
@@ -60,3 +70,9 @@ public:
     const void *ED; // pointer to EnumDecl
     std::vector<std::pair<std::string, int64_t>> Enumerators;
 };
+
+// Stable structural hash, equal for identical definitions of a type seen by different TUs.
+// FNV-1a 64 over NUL terminated tokens: variant ("base", "struct", "union", "enum"), name, size, then
+// name, type, offset, arrsize, pdepth, const and isstruct (0/1) per field or name and value per enumerator.
+// Numbers are decimal. Aliases are left out, merge.py unions them. merge.py hashes fragments without one the same way.
+uint64_t StructuralFingerprint(const BaseType &type);
@@ -0,0 +1,42 @@
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+// Fixed size bump allocator, sized up front by the caller and released as a whole. Memory starts zeroed,
+// large arenas come straight from fresh pages so that costs nothing until a page is touched.
+// Allocation is a single atomic add, so it may be used from lazily built per-type data.
+
+#define ARENA_ALIGNMENT 16
+
+typedef struct {
+    char* base;
+    size_t size;
+    size_t used;
+} arena_t;
+
+static size_t arena_align(const size_t size) {
+    return (size + ARENA_ALIGNMENT - 1) & ~(size_t)(ARENA_ALIGNMENT - 1);
+}
+
+static bool arena_create(arena_t* arena, const size_t size) {
+    arena->base = calloc(1, size ? size : 1);
+    arena->size = size;
+    arena->used = 0;
+
+    return arena->base != NULL;
+}
+
+static void arena_destroy(arena_t* arena) {
+    free(arena->base);
+    *arena = (arena_t){ 0 };
+}
+
+// size must have been accounted for with arena_align() when the arena was created
+static void* arena_alloc(arena_t* arena, const size_t size) {
+    const size_t offset = __atomic_fetch_add(&arena->used, arena_align(size), __ATOMIC_RELAXED);
+
+    if (offset + size > arena->size)
+        return NULL;
+
+    return arena->base + offset;
+}
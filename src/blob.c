@@ -0,0 +1,229 @@
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+// reflection.dat v2 layout, written by merge/merge.py.
+// All offsets are relative to the start of the blob and every section is 8 byte aligned,
+// so a blob can be used in place (mmap, linked symbol) without any parsing.
+
+#define REFLECT_BLOB_MAGIC 0x324C4652 // "RFL2"
+#define REFLECT_BLOB_VERSION 2
+#define REFLECT_BLOB_INDEX_MISS ((size_t)-1)
+
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t size;            // total blob size in bytes
+    uint32_t type_count;      // type ids are 1..type_count, record 0 is the unknown type
+    uint32_t types;           // reflect_mapped_type_t[type_count + 1]
+    uint32_t fields;          // reflect_mapped_field_t[field_count]
+    uint32_t field_count;
+    uint32_t enum_fields;     // reflect_mapped_enum_field_t[enum_field_count]
+    uint32_t enum_field_count;
+    uint32_t aliases;         // uint32_t string offsets [alias_count]
+    uint32_t alias_count;
+    uint32_t strings;         // string volume, offset 0 is always ""
+    uint32_t strings_size;
+    uint32_t type_index;      // name index over type names and aliases, 0 if absent
+} reflect_blob_header_t;
+
+// Name index, a perfect hash built by the merge script:
+// slot = base(hash) + seeds[bucket(hash)] * step(hash) over slot_count (~1% over the key count).
+// A lookup is a single probe and one verifying compare.
+typedef struct {
+    uint32_t bucket_count;
+    uint32_t slot_count;
+    // uint32_t seeds[bucket_count];
+    // reflect_blob_index_slot_t slots[slot_count];
+} reflect_blob_index_t;
+
+typedef struct {
+    uint32_t hash;  // low half of the fnv1a64 of the name
+    uint32_t name;  // string offset, 0 for unused slots
+    uint32_t value; // type id or field index
+} reflect_blob_index_slot_t;
+
+// Value index of an enum (reflect_mapped_type_t.value_index), also built by the merge script.
+// Enums whose values span at most about twice their count map value - min straight to an enumerator,
+// the others keep their distinct values sorted for a binary search. Duplicate values resolve to the
+// first declared enumerator.
+#define REFLECT_BLOB_VALUES_DENSE 1
+#define REFLECT_BLOB_VALUES_SORTED 2
+#define REFLECT_BLOB_VALUE_HOLE 0xFFFFFFFFu
+
+typedef struct {
+    uint32_t kind;  // REFLECT_BLOB_VALUES_DENSE or REFLECT_BLOB_VALUES_SORTED
+    uint32_t count; // dense slots or sorted entries
+    int64_t min;    // value of the first dense slot
+    // dense: uint32_t enumerators[count], REFLECT_BLOB_VALUE_HOLE where no enumerator has the value
+    // sorted: reflect_blob_enum_value_t entries[count]
+} reflect_blob_value_index_t;
+
+typedef struct {
+    int64_t value;
+    uint32_t enumerator; // index into the enum's fields
+    uint32_t reserved;
+} reflect_blob_enum_value_t;
+
+static const char* blob_strings(const reflect_blob_header_t* header) {
+    return (const char*)header + header->strings;
+}
+
+static const reflect_mapped_type_t* blob_types(const reflect_blob_header_t* header) {
+    return (const reflect_mapped_type_t*)((const char*)header + header->types);
+}
+
+static const reflect_mapped_field_t* blob_fields(const reflect_blob_header_t* header) {
+    return (const reflect_mapped_field_t*)((const char*)header + header->fields);
+}
+
+static const reflect_mapped_enum_field_t* blob_enum_fields(const reflect_blob_header_t* header) {
+    return (const reflect_mapped_enum_field_t*)((const char*)header + header->enum_fields);
+}
+
+static const uint32_t* blob_aliases(const reflect_blob_header_t* header) {
+    return (const uint32_t*)((const char*)header + header->aliases);
+}
+
+static bool blob_section_valid(const uint32_t offset, const size_t count, const size_t element_size, const size_t blob_size) {
+    return offset <= blob_size && count <= (blob_size - offset) / (element_size ? element_size : 1);
+}
+
+// Constant time sanity check of the header, records themselves are trusted
+static bool blob_validate(const void* data, const size_t size) {
+    if (data == NULL || size < sizeof(reflect_blob_header_t) || ((uintptr_t)data & 7) != 0)
+        return false;
+
+    const reflect_blob_header_t* header = data;
+
+    if (header->magic != REFLECT_BLOB_MAGIC || header->version != REFLECT_BLOB_VERSION || header->size > size)
+        return false;
+
+    return blob_section_valid(header->types, (size_t)header->type_count + 1, sizeof(reflect_mapped_type_t), header->size) &&
+           blob_section_valid(header->fields, header->field_count, sizeof(reflect_mapped_field_t), header->size) &&
+           blob_section_valid(header->enum_fields, header->enum_field_count, sizeof(reflect_mapped_enum_field_t), header->size) &&
+           blob_section_valid(header->aliases, header->alias_count, sizeof(uint32_t), header->size) &&
+           blob_section_valid(header->strings, header->strings_size, 1, header->size) &&
+           header->strings_size > 0 && blob_strings(header)[header->strings_size - 1] == 0 &&
+           header->type_index < header->size;
+}
+
+// maps a 32 bit value onto [0, range) without a division
+static uint32_t blob_fast_range(const uint32_t value, const uint32_t range) {
+    return (uint32_t)(((uint64_t)value * range) >> 32);
+}
+
+static size_t blob_index_get(const reflect_blob_header_t* header, const uint32_t index, const reflect_name_t* key) {
+    const uint64_t hash = key->hash;
+    const reflect_blob_index_t* table = (const reflect_blob_index_t*)((const char*)header + index);
+
+    if (table->slot_count == 0)
+        return REFLECT_BLOB_INDEX_MISS;
+
+    const uint32_t* seeds = (const uint32_t*)(table + 1);
+    const reflect_blob_index_slot_t* slots = (const reflect_blob_index_slot_t*)(seeds + table->bucket_count);
+
+    // bucket selector, base position and displacement step, see phf_split() in merge.py
+    const uint64_t x = hash_mix64(hash);
+    const uint32_t base = (uint32_t)x;
+    const uint32_t step = (uint32_t)((x * 0x9E3779B97F4A7C15ull) >> 32) | 1;
+
+    const uint32_t seed = seeds[blob_fast_range((uint32_t)(x >> 32), table->bucket_count)];
+    const reflect_blob_index_slot_t* slot = slots + blob_fast_range(base + seed * step, table->slot_count);
+
+    // the terminator is part of the compare, so a longer stored name can't match a prefix. strncmp stops at
+    // the end of a shorter stored name, which may be the last string of a mapped blob
+    if (slot->hash == (uint32_t)hash && strncmp(blob_strings(header) + slot->name, key->name, key->length + 1) == 0)
+        return slot->value;
+
+    return REFLECT_BLOB_INDEX_MISS;
+}
+
+// Keys resolved per round of blob_index_get_batch, enough to keep several misses in flight
+#define REFLECT_BLOB_BATCH 16
+
+// blob_index_get for many keys. Each dependent step (seed, slot, stored name) is done for a whole
+// round of keys before the next one, after prefetching, so the cache misses of independent keys overlap.
+static void blob_index_get_batch(const reflect_blob_header_t* header, const uint32_t index, const reflect_name_t* keys,
+                                 const size_t count, size_t* out) {
+    const reflect_blob_index_t* table = (const reflect_blob_index_t*)((const char*)header + index);
+    const uint32_t* seeds = (const uint32_t*)(table + 1);
+    const reflect_blob_index_slot_t* slots = (const reflect_blob_index_slot_t*)(seeds + table->bucket_count);
+    const char* strings = blob_strings(header);
+
+    for (size_t start = 0; start < count; start += REFLECT_BLOB_BATCH) {
+        const size_t n = count - start < REFLECT_BLOB_BATCH ? count - start : REFLECT_BLOB_BATCH;
+        const reflect_name_t* batch = keys + start;
+        const uint32_t* seed[REFLECT_BLOB_BATCH];
+        const reflect_blob_index_slot_t* slot[REFLECT_BLOB_BATCH];
+        uint32_t base[REFLECT_BLOB_BATCH];
+        uint32_t step[REFLECT_BLOB_BATCH];
+
+        if (table->slot_count == 0) {
+            for (size_t i = 0; i < n; i++)
+                out[start + i] = REFLECT_BLOB_INDEX_MISS;
+            continue;
+        }
+
+        for (size_t i = 0; i < n; i++) {
+            const uint64_t x = hash_mix64(batch[i].hash);
+            base[i] = (uint32_t)x;
+            step[i] = (uint32_t)((x * 0x9E3779B97F4A7C15ull) >> 32) | 1;
+            seed[i] = seeds + blob_fast_range((uint32_t)(x >> 32), table->bucket_count);
+            __builtin_prefetch(seed[i]);
+        }
+
+        for (size_t i = 0; i < n; i++) {
+            slot[i] = slots + blob_fast_range(base[i] + *seed[i] * step[i], table->slot_count);
+            __builtin_prefetch(slot[i]);
+        }
+
+        for (size_t i = 0; i < n; i++) {
+            if (slot[i]->hash == (uint32_t)batch[i].hash)
+                __builtin_prefetch(strings + slot[i]->name);
+        }
+
+        for (size_t i = 0; i < n; i++) {
+            const bool hit = batch[i].name != NULL && slot[i]->hash == (uint32_t)batch[i].hash &&
+                             strncmp(strings + slot[i]->name, batch[i].name, batch[i].length + 1) == 0;
+            out[start + i] = hit ? slot[i]->value : REFLECT_BLOB_INDEX_MISS;
+        }
+    }
+}
+
+// Index of the enumerator with value, REFLECT_BLOB_INDEX_MISS if there is none
+static size_t blob_value_index_get(const reflect_blob_value_index_t* index, const int64_t value) {
+    if (index->kind == REFLECT_BLOB_VALUES_DENSE) {
+        const uint32_t* enumerators = (const uint32_t*)(index + 1);
+        const uint64_t slot = (uint64_t)value - (uint64_t)index->min;
+
+        if (slot >= index->count || enumerators[slot] == REFLECT_BLOB_VALUE_HOLE)
+            return REFLECT_BLOB_INDEX_MISS;
+
+        return enumerators[slot];
+    }
+
+    const reflect_blob_enum_value_t* entries = (const reflect_blob_enum_value_t*)(index + 1);
+    size_t low = 0, high = index->count;
+
+    while (low < high) {
+        const size_t mid = low + (high - low) / 2;
+
+        if (entries[mid].value < value)
+            low = mid + 1;
+        else
+            high = mid;
+    }
+
+    return low < index->count && entries[low].value == value ? entries[low].enumerator : REFLECT_BLOB_INDEX_MISS;
+}
+
+// The enumerator at position rank of the index in ascending value order, REFLECT_BLOB_INDEX_MISS for dense holes
+static size_t blob_value_index_at(const reflect_blob_value_index_t* index, const size_t rank) {
+    if (index->kind == REFLECT_BLOB_VALUES_DENSE) {
+        const uint32_t enumerator = ((const uint32_t*)(index + 1))[rank];
+        return enumerator == REFLECT_BLOB_VALUE_HOLE ? REFLECT_BLOB_INDEX_MISS : enumerator;
+    }
+
+    return ((const reflect_blob_enum_value_t*)(index + 1))[rank].enumerator;
+}
@@ -0,0 +1,380 @@
+#include "reflect.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+// Field deltas between two values of a type. The bytes of both values are compared in wide blocks
+// into a bitmap with one bit per changed byte, each field then tests the bits of its own range,
+// so padding never counts as a change.
+// Patch layout: per changed field a LEB128 varint of the distance to the previous changed field
+// index (the first counts from -1) and the field bytes, terminated by a 0 varint.
+
+#define DELTA_BITMAP_BYTES 4096 // larger types compare field by field with memcmp
+
+typedef struct {
+    uint32_t index;      // in reflect_field_info_iter order
+    uint32_t first_word; // words of the changed byte bitmap the field spans
+    uint32_t last_word;
+    uint64_t first_mask;
+    uint64_t last_mask;
+    size_t offset;
+    size_t size;
+} delta_field_t;
+
+struct reflect_delta_plan {
+    const type_info_t* type;
+    size_t field_count;    // of type, mask bits
+    size_t delta_count;
+    delta_field_t* fields; // fields not covered by another field, by index
+    uint32_t* slots;       // field index -> position in fields + 1, 0 if covered
+};
+
+static size_t field_size(const field_info_t* field) {
+    const size_t element = field->ptr_depth > 0 ? sizeof(void*) : field->type_ptr->size;
+    return element * (field->arr_size > 0 ? field->arr_size : 1);
+}
+
+// by offset, wider fields first so they cover the ones starting at the same byte
+static int compare_fields(const void* a, const void* b) {
+    const delta_field_t* left = a;
+    const delta_field_t* right = b;
+
+    if (left->offset != right->offset)
+        return left->offset < right->offset ? -1 : 1;
+    if (left->size != right->size)
+        return left->size > right->size ? -1 : 1;
+    return left->index < right->index ? -1 : left->index > right->index;
+}
+
+static int compare_indices(const void* a, const void* b) {
+    const delta_field_t* left = a;
+    const delta_field_t* right = b;
+    return left->index < right->index ? -1 : left->index > right->index;
+}
+
+// Flattened members of embedded structs ("nest.x") and smaller union members lie inside the range of
+// another field, which carries their bytes. The fields are numbered like the field list.
+reflect_delta_plan_t* reflect_delta_plan_compile(const type_info_t* type) {
+    if (type == NULL || (type->variant != Struct && type->variant != Union))
+        return NULL;
+
+    reflect_delta_plan_t* plan = calloc(1, sizeof(reflect_delta_plan_t));
+
+    if (plan == NULL)
+        return NULL;
+
+    plan->type = type;
+    plan->field_count = type->field_count;
+    plan->fields = malloc((type->field_count > 0 ? type->field_count : 1) * sizeof(delta_field_t));
+    plan->slots = calloc(type->field_count > 0 ? type->field_count : 1, sizeof(uint32_t));
+
+    if (plan->fields == NULL || plan->slots == NULL) {
+        reflect_delta_plan_free(plan);
+        return NULL;
+    }
+
+    uint32_t index = 0;
+
+    for (const field_info_t* it = reflect_field_info_iter_begin(type); it != reflect_field_info_iter_end(type); ++it, index++) {
+        if (it->type_ptr == NULL)
+            continue;
+
+        const size_t size = field_size(it);
+
+        // synthetic layouts can have fields of unknown size or outside of their type
+        if (size == 0 || it->offset + size > type->size)
+            continue;
+
+        plan->fields[plan->delta_count++] = (delta_field_t){ .index = index, .offset = it->offset, .size = size };
+    }
+
+    // a field ending within the furthest reaching field before it is covered by that one
+    qsort(plan->fields, plan->delta_count, sizeof(delta_field_t), compare_fields);
+
+    size_t kept = 0, reach = 0;
+
+    for (size_t i = 0; i < plan->delta_count; i++) {
+        delta_field_t field = plan->fields[i];
+        const size_t end = field.offset + field.size;
+
+        if (end <= reach)
+            continue;
+
+        reach = end;
+
+        field.first_word = (uint32_t)(field.offset / 64);
+        field.last_word = (uint32_t)((end - 1) / 64);
+        field.first_mask = ~0ull << (field.offset % 64);
+        field.last_mask = ~0ull >> (63 - (end - 1) % 64);
+
+        if (field.first_word == field.last_word)
+            field.first_mask &= field.last_mask;
+
+        plan->fields[kept++] = field;
+    }
+
+    plan->delta_count = kept;
+    qsort(plan->fields, plan->delta_count, sizeof(delta_field_t), compare_indices);
+
+    for (size_t i = 0; i < plan->delta_count; i++)
+        plan->slots[plan->fields[i].index] = (uint32_t)(i + 1);
+
+    return plan;
+}
+
+void reflect_delta_plan_free(reflect_delta_plan_t* plan) {
+    if (plan == NULL)
+        return;
+
+    free(plan->fields);
+    free(plan->slots);
+    free(plan);
+}
+
+// 8 bit mask of the bytes of x that are not zero
+static uint64_t nonzero_bytes(uint64_t x) {
+    x = (((x & 0x7f7f7f7f7f7f7f7full) + 0x7f7f7f7f7f7f7f7full) | x) & 0x8080808080808080ull;
+    return ((x >> 7) * 0x0102040810204080ull) >> 56;
+}
+
+// bits gets one bit per byte of size, set where a and b differ
+static void changed_bytes(const char* a, const char* b, const size_t size, uint64_t* bits) {
+    size_t i = 0;
+
+    memset(bits, 0, (size + 63) / 64 * sizeof(uint64_t));
+
+#if defined(__AVX2__)
+    for (; i + 32 <= size; i += 32) {
+        const __m256i equal = _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i*)(a + i)), _mm256_loadu_si256((const __m256i*)(b + i)));
+        bits[i / 64] |= (uint64_t)(uint32_t)~_mm256_movemask_epi8(equal) << (i % 64);
+    }
+#elif defined(__SSE2__)
+    for (; i + 16 <= size; i += 16) {
+        const __m128i equal = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)(a + i)), _mm_loadu_si128((const __m128i*)(b + i)));
+        bits[i / 64] |= (uint64_t)(uint16_t)~_mm_movemask_epi8(equal) << (i % 64);
+    }
+#endif
+
+    for (; i < size; i += 8) {
+        uint64_t left = 0, right = 0;
+        const size_t length = size - i < 8 ? size - i : 8;
+        memcpy(&left, a + i, length);
+        memcpy(&right, b + i, length);
+        bits[i / 64] |= nonzero_bytes(left ^ right) << (i % 64);
+    }
+}
+
+static bool field_changed(const delta_field_t* field, const uint64_t* bits) {
+    uint64_t changed = bits[field->first_word] & field->first_mask;
+
+    if (field->last_word != field->first_word) {
+        for (uint32_t word = field->first_word + 1; word < field->last_word; word++)
+            changed |= bits[word];
+        changed |= bits[field->last_word] & field->last_mask;
+    }
+
+    return changed != 0;
+}
+
+// Calls visit for every field that differs between old and new, in field order. Returns the count.
+static size_t visit_changed(const reflect_delta_plan_t* plan, const char* old, const char* new,
+                            void (*visit)(const delta_field_t*, const char*, void*), void* user) {
+    const size_t size = plan->type->size;
+    size_t count = 0;
+
+    if (size > DELTA_BITMAP_BYTES) {
+        for (size_t i = 0; i < plan->delta_count; i++) {
+            const delta_field_t* field = &plan->fields[i];
+
+            if (memcmp(old + field->offset, new + field->offset, field->size) != 0) {
+                visit(field, new, user);
+                count++;
+            }
+        }
+
+        return count;
+    }
+
+    uint64_t bits[DELTA_BITMAP_BYTES / 64];
+    uint64_t any = 0;
+    changed_bytes(old, new, size, bits);
+
+    for (size_t word = 0; word < (size + 63) / 64; word++)
+        any |= bits[word];
+
+    if (any == 0)
+        return 0;
+
+    for (size_t i = 0; i < plan->delta_count; i++) {
+        if (field_changed(&plan->fields[i], bits)) {
+            visit(&plan->fields[i], new, user);
+            count++;
+        }
+    }
+
+    return count;
+}
+
+static void set_mask_bit(const delta_field_t* field, const char* new, void* user) {
+    (void)new;
+    uint64_t* mask = user;
+    mask[field->index / 64] |= 1ull << (field->index % 64);
+}
+
+// Sets the bit of every changed field in mask, which holds REFLECT_DELTA_MASK_WORDS(type->field_count)
+// words. Returns the number of changed fields.
+size_t reflect_delta_plan_diff(const reflect_delta_plan_t* plan, const void* old, const void* new, uint64_t* mask) {
+    if (plan == NULL || old == NULL || new == NULL || mask == NULL)
+        return 0;
+
+    memset(mask, 0, REFLECT_DELTA_MASK_WORDS(plan->field_count) * sizeof(uint64_t));
+    return visit_changed(plan, old, new, set_mask_bit, mask);
+}
+
+// Writes stop at the first byte that doesn't fit, size keeps counting so callers learn the full size
+typedef struct {
+    char* pos;
+    size_t left;
+    size_t size;
+    uint32_t previous; // index of the last written field + 1
+} delta_writer_t;
+
+static void put(delta_writer_t* writer, const void* data, const size_t size) {
+    writer->size += size;
+
+    if (size > writer->left) {
+        writer->left = 0;
+        return;
+    }
+
+    memcpy(writer->pos, data, size);
+    writer->pos += size;
+    writer->left -= size;
+}
+
+static void put_varint(delta_writer_t* writer, uint64_t value) {
+    uint8_t bytes[10];
+    size_t length = 0;
+
+    do {
+        bytes[length++] = (uint8_t)((value & 0x7f) | (value >= 0x80 ? 0x80 : 0));
+        value >>= 7;
+    } while (value != 0);
+
+    put(writer, bytes, length);
+}
+
+static void put_field(const delta_field_t* field, const char* new, void* user) {
+    delta_writer_t* writer = user;
+    put_varint(writer, field->index + 1 - writer->previous);
+    put(writer, new + field->offset, field->size);
+    writer->previous = field->index + 1;
+}
+
+// Writes a patch turning old into new into buf and returns its size. Like snprintf, a result larger
+// than buf_size means buf was too small, call again with a buffer of the returned size.
+size_t reflect_delta_plan_encode(const reflect_delta_plan_t* plan, const void* old, const void* new, void* buf, const size_t buf_size) {
+    if (plan == NULL || old == NULL || new == NULL)
+        return 0;
+
+    delta_writer_t writer = { .pos = buf, .left = buf == NULL ? 0 : buf_size };
+    const uint8_t end = 0;
+
+    visit_changed(plan, old, new, put_field, &writer);
+    put(&writer, &end, 1);
+    return writer.size;
+}
+
+static bool take_varint(const uint8_t** pos, const uint8_t* end, uint64_t* value) {
+    *value = 0;
+
+    for (uint32_t shift = 0; shift < 64; shift += 7) {
+        if (*pos == end)
+            return false;
+
+        const uint8_t byte = *(*pos)++;
+        *value |= (uint64_t)(byte & 0x7f) << shift;
+
+        if (!(byte & 0x80))
+            return true;
+    }
+
+    return false;
+}
+
+// Checks the patch and returns its size, calls copy for every field if ptr isn't NULL
+static size_t walk_patch(const reflect_delta_plan_t* plan, char* ptr, const uint8_t* pos, const uint8_t* end) {
+    const uint8_t* start = pos;
+    uint64_t previous = 0;
+
+    for (;;) {
+        uint64_t distance;
+
+        if (!take_varint(&pos, end, &distance))
+            return 0;
+
+        if (distance == 0)
+            return pos - start;
+
+        if (distance > plan->field_count - previous)
+            return 0;
+
+        previous += distance;
+        const uint32_t slot = plan->slots[previous - 1];
+
+        if (slot == 0)
+            return 0;
+
+        const delta_field_t* field = &plan->fields[slot - 1];
+
+        if (field->size > (size_t)(end - pos))
+            return 0;
+
+        if (ptr != NULL)
+            memcpy(ptr + field->offset, pos, field->size);
+
+        pos += field->size;
+    }
+}
+
+// Applies a patch from reflect_delta_plan_encode() to ptr and returns the bytes consumed. A truncated
+// or malformed patch returns 0 and leaves ptr untouched.
+size_t reflect_delta_plan_apply(const reflect_delta_plan_t* plan, void* ptr, const void* buf, const size_t buf_size) {
+    if (plan == NULL || ptr == NULL || buf == NULL)
+        return 0;
+
+    const uint8_t* end = (const uint8_t*)buf + buf_size;
+
+    if (walk_patch(plan, NULL, buf, end) == 0)
+        return 0;
+
+    return walk_patch(plan, ptr, buf, end);
+}
+
+// One shot versions, these compile a plan every call
+size_t reflect_diff(const type_info_t* type, const void* old, const void* new, uint64_t* out_mask) {
+    reflect_delta_plan_t* plan = reflect_delta_plan_compile(type);
+    const size_t count = reflect_delta_plan_diff(plan, old, new, out_mask);
+    reflect_delta_plan_free(plan);
+    return count;
+}
+
+size_t reflect_delta_encode(const type_info_t* type, const void* old, const void* new, void* buf, const size_t buf_size) {
+    reflect_delta_plan_t* plan = reflect_delta_plan_compile(type);
+    const size_t size = reflect_delta_plan_encode(plan, old, new, buf, buf_size);
+    reflect_delta_plan_free(plan);
+    return size;
+}
+
+size_t reflect_delta_apply(const type_info_t* type, void* ptr, const void* buf, const size_t buf_size) {
+    reflect_delta_plan_t* plan = reflect_delta_plan_compile(type);
+    const size_t size = reflect_delta_plan_apply(plan, ptr, buf, buf_size);
+    reflect_delta_plan_free(plan);
+    return size;
+}
@@ -0,0 +1,153 @@
+#include "reflect.h"
+
+#include <string.h>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+// Bulk copies of one field out of (gather) or into (scatter) an array of structs.
+// Kernels are picked by the field size, fixed sizes copy through integer loads so the
+// compiler can keep them in registers, anything else goes through memcpy.
+
+#define GATHER_UNROLL 4
+
+// Bytes one field occupies, including all array elements
+static size_t field_byte_size(const field_info_t* field) {
+    const size_t element = field->ptr_depth > 0 ? sizeof(void*) : field->type_ptr->size;
+    return element * (field->arr_size > 0 ? field->arr_size : 1);
+}
+
+#define DEFINE_GATHER_KERNEL(bits)                                                                   \
+    static void gather_##bits(const char* src, const size_t count, const size_t stride, void* out) { \
+        uint##bits##_t* dst = out;                                                                   \
+        size_t i = 0;                                                                                \
+        for (; i + GATHER_UNROLL <= count; i += GATHER_UNROLL, src += GATHER_UNROLL * stride) {      \
+            uint##bits##_t v0, v1, v2, v3;                                                           \
+            memcpy(&v0, src, sizeof(v0));                                                            \
+            memcpy(&v1, src + stride, sizeof(v1));                                                   \
+            memcpy(&v2, src + 2 * stride, sizeof(v2));                                               \
+            memcpy(&v3, src + 3 * stride, sizeof(v3));                                               \
+            dst[i] = v0;                                                                             \
+            dst[i + 1] = v1;                                                                         \
+            dst[i + 2] = v2;                                                                         \
+            dst[i + 3] = v3;                                                                         \
+        }                                                                                            \
+        for (; i < count; i++, src += stride)                                                        \
+            memcpy(&dst[i], src, sizeof(dst[i]));                                                    \
+    }
+
+#define DEFINE_SCATTER_KERNEL(bits)                                                                  \
+    static void scatter_##bits(char* dst, const size_t count, const size_t stride, const void* in) { \
+        const uint##bits##_t* src = in;                                                              \
+        size_t i = 0;                                                                                \
+        for (; i + GATHER_UNROLL <= count; i += GATHER_UNROLL, dst += GATHER_UNROLL * stride) {      \
+            memcpy(dst, &src[i], sizeof(src[i]));                                                    \
+            memcpy(dst + stride, &src[i + 1], sizeof(src[i]));                                       \
+            memcpy(dst + 2 * stride, &src[i + 2], sizeof(src[i]));                                   \
+            memcpy(dst + 3 * stride, &src[i + 3], sizeof(src[i]));                                   \
+        }                                                                                            \
+        for (; i < count; i++, dst += stride)                                                        \
+            memcpy(dst, &src[i], sizeof(src[i]));                                                    \
+    }
+
+DEFINE_GATHER_KERNEL(8)
+DEFINE_GATHER_KERNEL(16)
+DEFINE_GATHER_KERNEL(32)
+DEFINE_GATHER_KERNEL(64)
+DEFINE_SCATTER_KERNEL(8)
+DEFINE_SCATTER_KERNEL(16)
+DEFINE_SCATTER_KERNEL(32)
+DEFINE_SCATTER_KERNEL(64)
+
+#if defined(__AVX2__)
+// Hardware gathers take 32 bit byte offsets, strides that could overflow them use the scalar kernels
+#define GATHER_AVX2_MAX_STRIDE (INT32_MAX / 8)
+
+static void gather_32_avx2(const char* src, const size_t count, const size_t stride, void* out) {
+    const __m256i offsets = _mm256_mullo_epi32(_mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7), _mm256_set1_epi32((int)stride));
+    int32_t* dst = out;
+    size_t i = 0;
+
+    for (; i + 8 <= count; i += 8, src += 8 * stride)
+        _mm256_storeu_si256((__m256i*)(dst + i), _mm256_i32gather_epi32((const int*)src, offsets, 1));
+
+    gather_32(src, count - i, stride, dst + i);
+}
+
+static void gather_64_avx2(const char* src, const size_t count, const size_t stride, void* out) {
+    const __m128i offsets = _mm_mullo_epi32(_mm_setr_epi32(0, 1, 2, 3), _mm_set1_epi32((int)stride));
+    int64_t* dst = out;
+    size_t i = 0;
+
+    for (; i + 4 <= count; i += 4, src += 4 * stride)
+        _mm256_storeu_si256((__m256i*)(dst + i), _mm256_i32gather_epi64((const long long*)src, offsets, 1));
+
+    gather_64(src, count - i, stride, dst + i);
+}
+#endif
+
+static void gather_128(const char* src, const size_t count, const size_t stride, void* out) {
+    char* dst = out;
+
+    for (size_t i = 0; i < count; i++, src += stride, dst += 16)
+        memcpy(dst, src, 16);
+}
+
+static void scatter_128(char* dst, const size_t count, const size_t stride, const void* in) {
+    const char* src = in;
+
+    for (size_t i = 0; i < count; i++, dst += stride, src += 16)
+        memcpy(dst, src, 16);
+}
+
+// Copies field of count structs starting at base into out, packed. stride 0 uses type->size.
+void reflect_gather(const type_info_t* type, const field_info_t* field, const void* base, const size_t count, size_t stride, void* out) {
+    if (type == NULL || field == NULL || base == NULL || out == NULL || field->type_ptr == NULL)
+        return;
+
+    if (stride == 0)
+        stride = type->size;
+
+    const char* src = (const char*)base + field->offset;
+    const size_t size = field_byte_size(field);
+
+    switch (size) {
+    case 1: gather_8(src, count, stride, out); return;
+    case 2: gather_16(src, count, stride, out); return;
+#if defined(__AVX2__)
+    case 4: (stride <= GATHER_AVX2_MAX_STRIDE ? gather_32_avx2 : gather_32)(src, count, stride, out); return;
+    case 8: (stride <= GATHER_AVX2_MAX_STRIDE ? gather_64_avx2 : gather_64)(src, count, stride, out); return;
+#else
+    case 4: gather_32(src, count, stride, out); return;
+    case 8: gather_64(src, count, stride, out); return;
+#endif
+    case 16: gather_128(src, count, stride, out); return;
+    default:
+        for (size_t i = 0; i < count; i++, src += stride)
+            memcpy((char*)out + i * size, src, size);
+    }
+}
+
+// Copies count packed values from in into field of the structs starting at base. stride 0 uses type->size.
+void reflect_scatter(const type_info_t* type, const field_info_t* field, void* base, const size_t count, size_t stride, const void* in) {
+    if (type == NULL || field == NULL || base == NULL || in == NULL || field->type_ptr == NULL)
+        return;
+
+    if (stride == 0)
+        stride = type->size;
+
+    char* dst = (char*)base + field->offset;
+    const size_t size = field_byte_size(field);
+
+    switch (size) {
+    case 1: scatter_8(dst, count, stride, in); return;
+    case 2: scatter_16(dst, count, stride, in); return;
+    case 4: scatter_32(dst, count, stride, in); return;
+    case 8: scatter_64(dst, count, stride, in); return;
+    case 16: scatter_128(dst, count, stride, in); return;
+    default:
+        for (size_t i = 0; i < count; i++, dst += stride)
+            memcpy(dst, (const char*)in + i * size, size);
+    }
+}
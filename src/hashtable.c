@@ -1,89 +1,233 @@
 #include <stddef.h>
 #include <string.h>
 #include <stdlib.h>
+#include <stdint.h>
 
-// TODO: should probably think about this more
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+// Open addressing table (swiss table layout): one control byte per slot holding a 7 bit
+// tag of the hash, or HASHTABLE_CTRL_EMPTY. Control bytes are probed a group of 16 at a time
+// and only slots whose tag matches are compared. Capacity is a power of two (a multiple of
+// the group size), entries are never removed.
+// The fnv1a hash is spread with a fibonacci multiply, the first group comes from the top
+// bits of the product and the tag from the middle.
+
+#define HASHTABLE_GROUP_SIZE 16
+#define HASHTABLE_CTRL_EMPTY 0x80
+#define HASHTABLE_MAX_LOAD(capacity) ((capacity) - (capacity) / 8)
 
 typedef struct {
     const char* name;
     size_t id; // ID of typeinfo or field info
 } hash_t;
 
-typedef struct HashBucket {
+typedef struct {
     hash_t data;
-    struct HashBucket* next;
-} hash_bucket_t;
+    uint32_t hash;
+} hash_slot_t;
 
 typedef struct {
-    hash_bucket_t* data;
+    uint8_t* ctrl;
+    hash_slot_t* slots;
     size_t capacity;
+    size_t count;
+    uint32_t group_shift; // 64 - log2(group count)
 } hashtable_t;
 
 static uint32_t hash_fnv1a(const char *key) {
     uint32_t hash = 2166136261u;
     size_t i = 0;
     while (key[i]) {
-        hash ^= (uint8_t)key[i];;
+        hash ^= (uint8_t)key[i];
         hash *= 16777619u;
         i++;
     }
     return hash;
 }
 
-static hashtable_t hashtable_create(const size_t capacity) {
-    const hashtable_t ht = {
-        .capacity = capacity,
-        .data = calloc(capacity, sizeof(hash_bucket_t)),
+// length is optional, it receives strlen(key) from the same pass
+static uint64_t hash_fnv1a64(const char *key, size_t *length) {
+    uint64_t hash = 14695981039346656037ull;
+    size_t i = 0;
+    while (key[i]) {
+        hash ^= (uint8_t)key[i];
+        hash *= 1099511628211ull;
+        i++;
+    }
+    if (length != NULL)
+        *length = i;
+    return hash;
+}
+
+// murmur3 fmix64, fnv alone leaves the high bits of similar names clustered
+static uint64_t hash_mix64(uint64_t x) {
+    x ^= x >> 33;
+    x *= 0xFF51AFD7ED558CCDull;
+    x ^= x >> 33;
+    x *= 0xC4CEB9FE1A85EC53ull;
+    x ^= x >> 33;
+    return x;
+}
+
+// bit i is set if ctrl[i] == value
+static uint32_t hashtable_group_match(const uint8_t* ctrl, const uint8_t value) {
+#if defined(__SSE2__)
+    const __m128i group = _mm_loadu_si128((const __m128i*)ctrl);
+    return (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(group, _mm_set1_epi8((char)value)));
+#elif defined(__ARM_NEON)
+    // narrow the byte mask to one nibble per control byte, then keep a bit per nibble
+    const uint8x16_t equal = vceqq_u8(vld1q_u8(ctrl), vdupq_n_u8(value));
+    uint64_t nibbles = vget_lane_u64(vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(equal), 4)), 0);
+    nibbles &= 0x1111111111111111ull;
+
+    uint32_t mask = 0;
+    while (nibbles != 0) {
+        mask |= 1u << (__builtin_ctzll(nibbles) / 4);
+        nibbles &= nibbles - 1;
+    }
+    return mask;
+#else
+    uint32_t mask = 0;
+    for (uint32_t i = 0; i < HASHTABLE_GROUP_SIZE; i++)
+        mask |= (uint32_t)(ctrl[i] == value) << i;
+    return mask;
+#endif
+}
+
+static uint64_t hashtable_spread(const uint32_t hash) {
+    return hash * 0x9E3779B97F4A7C15ull;
+}
+
+// taken below the group bits, which only ever use the top of the product
+static uint8_t hashtable_tag(const uint64_t spread) {
+    return (spread >> 32) & 0x7F;
+}
+
+static size_t hashtable_round_capacity(const size_t capacity) {
+    size_t rounded = HASHTABLE_GROUP_SIZE;
+    while (rounded < capacity)
+        rounded <<= 1;
+    return rounded;
+}
+
+// Bytes needed by hashtable_create_in() for a table created with this capacity
+static size_t hashtable_memory_size(const size_t capacity) {
+    const size_t rounded = hashtable_round_capacity(capacity);
+    return rounded * sizeof(hash_slot_t) + rounded;
+}
+
+// Places the table in caller owned memory of hashtable_memory_size(capacity) bytes.
+// Such a table must not grow: insert at most HASHTABLE_MAX_LOAD(capacity) entries and never destroy it.
+static hashtable_t hashtable_create_in(const size_t capacity, void* memory) {
+    const size_t rounded = hashtable_round_capacity(capacity);
+    uint32_t group_shift = 64;
+    for (size_t groups = rounded / HASHTABLE_GROUP_SIZE; groups > 1; groups >>= 1)
+        group_shift--;
+
+    hashtable_t ht = {
+        .capacity = rounded,
+        .count = 0,
+        .group_shift = group_shift,
+        .slots = memory,
+        .ctrl = (uint8_t*)memory + rounded * sizeof(hash_slot_t),
     };
 
+    memset(ht.ctrl, HASHTABLE_CTRL_EMPTY, rounded);
+
     return ht;
 }
 
-static size_t hashtable_get(const hashtable_t *ht, const char *key) {
-    const uint32_t hash_key = hash_fnv1a(key) % ht->capacity;
+static hashtable_t hashtable_create(const size_t capacity) {
+    return hashtable_create_in(capacity, malloc(hashtable_memory_size(capacity)));
+}
 
-    hash_bucket_t* bucket = ht->data + hash_key;
+static void hashtable_destroy(hashtable_t* ht) {
+    free(ht->slots);
+    *ht = (hashtable_t){ 0 };
+}
 
-    while (bucket != NULL) {
-        if (bucket->data.name == NULL)
-            return -1;
+// Groups are visited with triangular probing, which covers every group of a power of two table
+static const hash_slot_t* hashtable_find(const hashtable_t* ht, const char* key, const uint32_t hash) {
+    const size_t group_mask = ht->capacity / HASHTABLE_GROUP_SIZE - 1;
+    const uint64_t spread = hashtable_spread(hash);
+    const uint8_t tag = hashtable_tag(spread);
+    // a shift by 64 is undefined, single group tables always start at group 0
+    size_t group = (spread >> 1) >> (ht->group_shift - 1);
 
-        if (strcmp(bucket->data.name, key) == 0)
-            return bucket->data.id;
+    for (size_t step = 1;; step++) {
+        const uint8_t* ctrl = ht->ctrl + group * HASHTABLE_GROUP_SIZE;
 
-        bucket = bucket->next;
-    }
+        for (uint32_t match = hashtable_group_match(ctrl, tag); match != 0; match &= match - 1) {
+            const hash_slot_t* slot = ht->slots + group * HASHTABLE_GROUP_SIZE + __builtin_ctz(match);
+
+            if (slot->hash == hash && strcmp(slot->data.name, key) == 0)
+                return slot;
+        }
+
+        if (hashtable_group_match(ctrl, HASHTABLE_CTRL_EMPTY) != 0 || step > group_mask)
+            return NULL;
 
-    return -1;
+        group = (group + step) & group_mask;
+    }
 }
 
-static void hashtable_insert(const hashtable_t* ht, const hash_t* value) {
-    const uint32_t hash_key = hash_fnv1a(value->name) % ht->capacity;
+static size_t hashtable_get(const hashtable_t *ht, const char *key) {
+    if (ht->capacity == 0)
+        return -1;
+
+    const hash_slot_t* slot = hashtable_find(ht, key, hash_fnv1a(key));
 
-    if (ht->data[hash_key].data.name == NULL) {
-        // new entry
-        ht->data[hash_key].data = *value;
-        ht->data[hash_key].next = NULL;
-    } else {
-        hash_bucket_t* entry = &ht->data[hash_key];
+    return slot == NULL ? (size_t)-1 : slot->data.id;
+}
 
-        while (entry != NULL) {
-            // entry already exists
-            if (strcmp(entry->data.name, value->name) == 0) {
-                entry->data = *value;
-                return;
-            }
+static void hashtable_place(hashtable_t* ht, const hash_t* value, const uint32_t hash) {
+    const size_t group_mask = ht->capacity / HASHTABLE_GROUP_SIZE - 1;
+    const uint64_t spread = hashtable_spread(hash);
+    size_t group = (spread >> 1) >> (ht->group_shift - 1);
 
-            // chain new entry
-            if (entry->next == NULL) {
-                entry->next = malloc(sizeof(hash_bucket_t));
-                entry->next->data = *value;
-                entry->next->next = NULL;
-                return;
-            }
+    for (size_t step = 1;; step++) {
+        const uint32_t empty = hashtable_group_match(ht->ctrl + group * HASHTABLE_GROUP_SIZE, HASHTABLE_CTRL_EMPTY);
 
-            entry = entry->next;
+        if (empty != 0) {
+            const size_t index = group * HASHTABLE_GROUP_SIZE + __builtin_ctz(empty);
+            ht->ctrl[index] = hashtable_tag(spread);
+            ht->slots[index] = (hash_slot_t){ .data = *value, .hash = hash };
+            ht->count++;
+            return;
         }
 
+        group = (group + step) & group_mask;
     }
-}
\ No newline at end of file
+}
+
+static void hashtable_grow(hashtable_t* ht) {
+    hashtable_t grown = hashtable_create(ht->capacity * 2);
+
+    for (size_t i = 0; i < ht->capacity; i++) {
+        if (ht->ctrl[i] != HASHTABLE_CTRL_EMPTY)
+            hashtable_place(&grown, &ht->slots[i].data, ht->slots[i].hash);
+    }
+
+    hashtable_destroy(ht);
+    *ht = grown;
+}
+
+static void hashtable_insert(hashtable_t* ht, const hash_t* value) {
+    const uint32_t hash = hash_fnv1a(value->name);
+    hash_slot_t* existing = (hash_slot_t*)hashtable_find(ht, value->name, hash);
+
+    // entry already exists
+    if (existing != NULL) {
+        existing->data = *value;
+        return;
+    }
+
+    if (ht->count + 1 > HASHTABLE_MAX_LOAD(ht->capacity))
+        hashtable_grow(ht);
+
+    hashtable_place(ht, value, hash);
+}
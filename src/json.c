@@ -0,0 +1,1371 @@
+#include "reflect.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// JSON through plans compiled once per type, written and parsed in a single pass without a DOM.
+// Like serialization plans, a plan has one program per struct, union or enum type reachable from
+// the root. Struct programs hold their fields with the key already quoted ("\"name\":") and a name
+// hash table for parsing, enum programs their enumerators sorted by value with quoted names.
+
+#define JSON_NONE UINT32_MAX
+#define JSON_MAX_DEPTH 256 // nesting bound for values skipped by the parser
+
+typedef enum {
+    JSON_INT,
+    JSON_UINT,
+    JSON_FLOAT,
+    JSON_BOOL,
+    JSON_ENUM,   // program holds the enumerators
+    JSON_OBJECT, // struct or union, program holds the fields
+    JSON_STRING, // char*, NULL is null
+    JSON_CHARS,  // char array, written up to the first NUL
+} json_kind_t;
+
+typedef struct {
+    json_kind_t kind;
+    uint32_t program;
+    uint32_t ptr_depth; // pointers followed before the value, a JSON_STRING's own pointer excluded
+    size_t size;        // of one value
+} json_value_t;
+
+typedef struct {
+    const char* name;
+    size_t length;
+} json_name_t;
+
+typedef struct {
+    json_name_t name;
+    char* key; // "\"name\":"
+    size_t key_length;
+    size_t offset;
+    size_t count; // array elements, 0 if not an array
+    json_value_t value;
+} json_field_t;
+
+typedef struct {
+    json_name_t name;
+    char* literal; // "\"NAME\""
+    size_t literal_length;
+    int64_t value;
+} json_enumerator_t;
+
+typedef struct {
+    const type_info_t* type;
+    json_field_t* fields;
+    size_t field_count;
+    json_enumerator_t* enumerators; // sorted by value
+    size_t enumerator_count;
+    uint32_t* names; // index + 1 of the field or enumerator, by name hash, 0 if empty
+    size_t name_mask;
+    bool has_pointers; // reading has to clear and release pointers
+} json_program_t;
+
+struct reflect_json_plan {
+    json_value_t root;
+    json_program_t* programs;
+    size_t program_count;
+};
+
+typedef struct {
+    json_program_t* programs;
+    size_t program_count;
+    size_t program_capacity;
+} json_builder_t;
+
+static uint64_t json_hash(const char* data, const size_t length) {
+    uint64_t hash = 14695981039346656037ULL;
+
+    for (size_t i = 0; i < length; i++) {
+        hash ^= (unsigned char)data[i];
+        hash *= 1099511628211ULL;
+    }
+
+    return hash;
+}
+
+// Appends "\"text\"" to out (if not NULL) with JSON escapes, returns the length
+static size_t escape_string(const char* text, const size_t length, char* out) {
+    static const char hex[] = "0123456789abcdef";
+    size_t size = 0;
+
+#define EMIT(c) do { if (out != NULL) out[size] = (c); size++; } while (0)
+    EMIT('"');
+
+    for (size_t i = 0; i < length; i++) {
+        const unsigned char c = text[i];
+
+        if (c == '"' || c == '\\') {
+            EMIT('\\');
+            EMIT(c);
+        } else if (c < 0x20) {
+            EMIT('\\');
+            switch (c) {
+            case '\n': EMIT('n'); break;
+            case '\r': EMIT('r'); break;
+            case '\t': EMIT('t'); break;
+            case '\b': EMIT('b'); break;
+            case '\f': EMIT('f'); break;
+            default:
+                EMIT('u');
+                EMIT('0');
+                EMIT('0');
+                EMIT(hex[c >> 4]);
+                EMIT(hex[c & 15]);
+            }
+        } else {
+            EMIT(c);
+        }
+    }
+
+    EMIT('"');
+#undef EMIT
+
+    return size;
+}
+
+// Quoted and escaped name plus suffix, NULL if out of memory
+static char* quote(const char* text, const char* suffix, size_t* length) {
+    const size_t suffix_length = strlen(suffix);
+    const size_t quoted_length = escape_string(text, strlen(text), NULL);
+    char* literal = malloc(quoted_length + suffix_length + 1);
+
+    if (literal == NULL)
+        return NULL;
+
+    escape_string(text, strlen(text), literal);
+    memcpy(literal + quoted_length, suffix, suffix_length + 1);
+    *length = quoted_length + suffix_length;
+
+    return literal;
+}
+
+static bool build_names(json_program_t* program, const json_name_t* first, const size_t count, const size_t stride) {
+    size_t capacity = 4;
+    while (capacity < count * 2)
+        capacity *= 2;
+
+    program->names = calloc(capacity, sizeof(uint32_t));
+    program->name_mask = capacity - 1;
+
+    if (program->names == NULL)
+        return false;
+
+    for (size_t i = 0; i < count; i++) {
+        const json_name_t* name = (const json_name_t*)((const char*)first + i * stride);
+        size_t slot = json_hash(name->name, name->length) & program->name_mask;
+
+        while (program->names[slot] != 0)
+            slot = (slot + 1) & program->name_mask;
+
+        program->names[slot] = i + 1;
+    }
+
+    return true;
+}
+
+// Returns index + 1 of the field or enumerator called name, 0 if there is none
+static size_t find_name(const json_program_t* program, const json_name_t* first, const size_t stride, const char* name, const size_t length) {
+    size_t slot = json_hash(name, length) & program->name_mask;
+
+    for (; program->names[slot] != 0; slot = (slot + 1) & program->name_mask) {
+        const json_name_t* candidate = (const json_name_t*)((const char*)first + (program->names[slot] - 1) * stride);
+
+        if (candidate->length == length && memcmp(candidate->name, name, length) == 0)
+            return program->names[slot];
+    }
+
+    return 0;
+}
+
+static int compare_enumerators(const void* a, const void* b) {
+    const json_enumerator_t* left = a;
+    const json_enumerator_t* right = b;
+    return left->value < right->value ? -1 : left->value > right->value;
+}
+
+static bool is_char(const type_info_t* type) {
+    return type->variant == Base && type->size == 1 && strcmp(type->name, "char") == 0;
+}
+
+// Base types are told apart by name, false for ones JSON has no value for (functions, void, ...)
+static bool classify_base(const type_info_t* type, json_kind_t* kind) {
+    const char* name = type->name;
+
+    if (strcmp(name, "bool") == 0 || strcmp(name, "_Bool") == 0)
+        *kind = JSON_BOOL;
+    else if (strstr(name, "float") != NULL || strstr(name, "double") != NULL)
+        *kind = JSON_FLOAT;
+    else if (strstr(name, "unsigned") != NULL || name[0] == 'u' || strcmp(name, "size_t") == 0)
+        *kind = JSON_UINT;
+    else
+        *kind = JSON_INT;
+
+    if (*kind == JSON_FLOAT)
+        return type->size == sizeof(float) || type->size == sizeof(double);
+
+    return type->size == 1 || type->size == 2 || type->size == 4 || type->size == 8;
+}
+
+static uint32_t compile_program(json_builder_t* builder, const type_info_t* type);
+
+// false if the value can't be written as JSON, such fields are left out
+static bool compile_value(json_builder_t* builder, const type_info_t* type, const uint32_t ptr_depth, json_value_t* value, bool* failed) {
+    *value = (json_value_t){ .program = JSON_NONE, .ptr_depth = ptr_depth, .size = type->size };
+
+    if (type->id == 0 || type->size == 0)
+        return false;
+
+    if (ptr_depth > 0 && is_char(type)) {
+        value->kind = JSON_STRING;
+        value->ptr_depth = ptr_depth - 1;
+        value->size = sizeof(char*);
+        return true;
+    }
+
+    switch (type->variant) {
+    case Base:
+        return classify_base(type, &value->kind);
+    case Enum:
+        if (type->size != 1 && type->size != 2 && type->size != 4 && type->size != 8)
+            return false;
+        value->kind = JSON_ENUM;
+        break;
+    case Struct:
+    case Union:
+        value->kind = JSON_OBJECT;
+        break;
+    default:
+        return false;
+    }
+
+    value->program = compile_program(builder, type);
+    *failed = value->program == JSON_NONE;
+    return !*failed;
+}
+
+// Fields covered by an embedded struct of a known type are written inside its object instead
+static bool is_covered(const type_info_t* type, const field_info_t* field) {
+    for (const field_info_t* it = reflect_field_info_iter_begin(type); it != reflect_field_info_iter_end(type); ++it) {
+        const size_t length = strlen(it->name);
+
+        if (it == field || length == 0 || it->ptr_depth != 0 || it->arr_size != 0 || it->type_ptr == NULL ||
+            it->type_ptr->id == 0 || (it->type_ptr->variant != Struct && it->type_ptr->variant != Union))
+            continue;
+
+        if (strncmp(field->name, it->name, length) == 0 && field->name[length] == '.')
+            return true;
+    }
+
+    return false;
+}
+
+static size_t field_bytes(const field_info_t* field) {
+    return (field->ptr_depth > 0 ? sizeof(void*) : field->type_ptr->size) * (field->arr_size > 0 ? field->arr_size : 1);
+}
+
+// Members of anonymous unions are flattened into the struct, they are the only fields sharing bytes
+// with another one that isn't their parent or child
+static bool shares_bytes(const type_info_t* type, const field_info_t* field) {
+    const size_t length = strlen(field->name);
+
+    for (const field_info_t* it = reflect_field_info_iter_begin(type); it != reflect_field_info_iter_end(type); ++it) {
+        if (it == field || it->name[0] == '\0' || it->type_ptr == NULL || is_covered(type, it))
+            continue;
+
+        const size_t it_length = strlen(it->name);
+        const bool related = (strncmp(field->name, it->name, it_length) == 0 && field->name[it_length] == '.') ||
+                             (strncmp(it->name, field->name, length) == 0 && it->name[length] == '.');
+
+        if (!related && it->offset < field->offset + field_bytes(field) && field->offset < it->offset + field_bytes(it))
+            return true;
+    }
+
+    return false;
+}
+
+static bool compile_fields(json_builder_t* builder, const uint32_t index, const type_info_t* type) {
+    const size_t capacity = type->field_count;
+    json_field_t* fields = calloc(capacity > 0 ? capacity : 1, sizeof(json_field_t));
+    size_t count = 0;
+    bool has_pointers = false, failed = false;
+
+    if (fields == NULL)
+        return false;
+
+    for (const field_info_t* it = reflect_field_info_iter_begin(type); it != reflect_field_info_iter_end(type); ++it) {
+        json_field_t field = { .name = { it->name, strlen(it->name) }, .offset = it->offset, .count = it->arr_size };
+
+        if (field.name.length == 0 || it->type_ptr == NULL || is_covered(type, it))
+            continue;
+
+        if (!compile_value(builder, it->type_ptr, it->ptr_depth, &field.value, &failed)) {
+            if (failed)
+                break;
+            continue;
+        }
+
+        const size_t element = field.value.ptr_depth > 0 ? sizeof(void*) : field.value.size;
+        if (it->offset + element * (it->arr_size > 0 ? it->arr_size : 1) > type->size) {
+            failed = true;
+            break;
+        }
+
+        // only one member of a union is valid and JSON can't tell which, a pointer read from the bytes
+        // of another member would be followed, overwritten while reading or freed by a release
+        const bool pointers = field.value.ptr_depth > 0 || field.value.kind == JSON_STRING ||
+                              (field.value.kind == JSON_OBJECT && builder->programs[field.value.program].has_pointers);
+        if (pointers && (type->variant == Union || shares_bytes(type, it)))
+            continue;
+
+        if (field.count > 0 && field.value.kind == JSON_INT && field.value.ptr_depth == 0 && is_char(it->type_ptr))
+            field.value.kind = JSON_CHARS;
+
+        field.key = quote(it->name, ":", &field.key_length);
+        if (field.key == NULL) {
+            failed = true;
+            break;
+        }
+
+        has_pointers |= pointers;
+        fields[count++] = field;
+    }
+
+    json_program_t* program = &builder->programs[index];
+    program->fields = fields;
+    program->field_count = count;
+    program->has_pointers = has_pointers;
+
+    return !failed && build_names(program, &fields->name, count, sizeof(json_field_t));
+}
+
+static bool compile_enumerators(json_builder_t* builder, const uint32_t index, const type_info_t* type) {
+    json_program_t* program = &builder->programs[index];
+    json_enumerator_t* enumerators = calloc(type->field_count > 0 ? type->field_count : 1, sizeof(json_enumerator_t));
+    size_t count = 0;
+
+    program->enumerators = enumerators;
+
+    if (enumerators == NULL)
+        return false;
+
+    for (const enum_field_info_t* it = reflect_enum_info_iter_begin(type); it != reflect_enum_info_iter_end(type); ++it, count++) {
+        enumerators[count] = (json_enumerator_t){ .name = { it->name, strlen(it->name) }, .value = it->value };
+        enumerators[count].literal = quote(it->name, "", &enumerators[count].literal_length);
+        program->enumerator_count = count + 1;
+
+        if (enumerators[count].literal == NULL)
+            return false;
+    }
+
+    qsort(enumerators, count, sizeof(json_enumerator_t), compare_enumerators);
+    return build_names(program, &enumerators->name, count, sizeof(json_enumerator_t));
+}
+
+// Returns the program index of type, compiling it first if it is new. JSON_NONE on failure.
+static uint32_t compile_program(json_builder_t* builder, const type_info_t* type) {
+    for (size_t i = 0; i < builder->program_count; i++) {
+        if (builder->programs[i].type == type)
+            return i;
+    }
+
+    if (builder->program_count == builder->program_capacity) {
+        const size_t capacity = builder->program_capacity > 0 ? builder->program_capacity * 2 : 8;
+        json_program_t* grown = realloc(builder->programs, capacity * sizeof(json_program_t));
+
+        if (grown == NULL)
+            return JSON_NONE;
+
+        builder->programs = grown;
+        builder->program_capacity = capacity;
+    }
+
+    // registered before the fields are compiled, so pointers back to this type find it. Types reached
+    // again while compiling lie on a cycle, which has to go through a pointer, so they have pointers.
+    const uint32_t index = builder->program_count++;
+    builder->programs[index] = (json_program_t){ .type = type, .has_pointers = type->variant != Enum };
+
+    const bool ok = type->variant == Enum ? compile_enumerators(builder, index, type) : compile_fields(builder, index, type);
+    return ok ? index : JSON_NONE;
+}
+
+void reflect_json_plan_free(reflect_json_plan_t* plan) {
+    if (plan == NULL)
+        return;
+
+    for (size_t i = 0; i < plan->program_count; i++) {
+        json_program_t* program = &plan->programs[i];
+
+        for (size_t j = 0; j < program->field_count; j++)
+            free(program->fields[j].key);
+        for (size_t j = 0; j < program->enumerator_count; j++)
+            free(program->enumerators[j].literal);
+
+        free(program->fields);
+        free(program->enumerators);
+        free(program->names);
+    }
+
+    free(plan->programs);
+    free(plan);
+}
+
+// NULL if type has no JSON representation, or fields lie outside of it
+reflect_json_plan_t* reflect_json_plan_compile(const type_info_t* type) {
+    if (type == NULL)
+        return NULL;
+
+    reflect_json_plan_t* plan = calloc(1, sizeof(reflect_json_plan_t));
+
+    if (plan == NULL)
+        return NULL;
+
+    json_builder_t builder = { 0 };
+    bool failed = false;
+    const bool ok = compile_value(&builder, type, 0, &plan->root, &failed);
+
+    plan->programs = builder.programs;
+    plan->program_count = builder.program_count;
+
+    if (!ok) {
+        reflect_json_plan_free(plan);
+        return NULL;
+    }
+
+    return plan;
+}
+
+// Writing
+
+// Full buffer, kept out of put() so the common case stays small enough to inline
+static void put_flushing(reflect_json_writer_t* writer, const void* data, const size_t size) {
+    if (writer->flush == NULL || writer->failed || !reflect_json_flush(writer)) {
+        writer->failed = true;
+        return;
+    }
+
+    if (size > writer->size) {
+        writer->failed = !writer->flush(writer->user, data, size);
+        return;
+    }
+
+    memcpy(writer->buf, data, size);
+    writer->pos = size;
+}
+
+static void put(reflect_json_writer_t* writer, const void* data, const size_t size) {
+    if (writer->size - writer->pos >= size) {
+        memcpy(writer->buf + writer->pos, data, size);
+        writer->pos += size;
+    } else {
+        put_flushing(writer, data, size);
+    }
+}
+
+static void put_char(reflect_json_writer_t* writer, const char c) {
+    if (writer->pos < writer->size)
+        writer->buf[writer->pos++] = c;
+    else
+        put(writer, &c, 1);
+}
+
+static void put_uint(reflect_json_writer_t* writer, uint64_t value) {
+    // two digits per division
+    static const char pairs[] = "00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+                                "40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+                                "8081828384858687888990919293949596979899";
+    char digits[20];
+    size_t i = sizeof(digits);
+
+    while (value >= 100) {
+        const size_t pair = (value % 100) * 2;
+        value /= 100;
+        digits[--i] = pairs[pair + 1];
+        digits[--i] = pairs[pair];
+    }
+
+    if (value >= 10) {
+        digits[--i] = pairs[value * 2 + 1];
+        digits[--i] = pairs[value * 2];
+    } else {
+        digits[--i] = (char)('0' + value);
+    }
+
+    put(writer, digits + i, sizeof(digits) - i);
+}
+
+static void put_int(reflect_json_writer_t* writer, const int64_t value) {
+    if (value < 0) {
+        put_char(writer, '-');
+        put_uint(writer, (uint64_t)0 - (uint64_t)value);
+    } else {
+        put_uint(writer, (uint64_t)value);
+    }
+}
+
+static void put_string(reflect_json_writer_t* writer, const char* text, const size_t length) {
+    // strings without anything to escape (the usual case) are copied in one piece
+    size_t plain = 0;
+    while (plain < length && (unsigned char)text[plain] >= 0x20 && text[plain] != '"' && text[plain] != '\\')
+        plain++;
+
+    if (plain == length) {
+        put_char(writer, '"');
+        put(writer, text, length);
+        put_char(writer, '"');
+        return;
+    }
+
+    const size_t escaped_length = escape_string(text, length, NULL);
+    char stack[256];
+    char* escaped = escaped_length <= sizeof(stack) ? stack : malloc(escaped_length);
+
+    if (escaped == NULL) {
+        writer->failed = true;
+        return;
+    }
+
+    escape_string(text, length, escaped);
+    put(writer, escaped, escaped_length);
+
+    if (escaped != stack)
+        free(escaped);
+}
+
+// Exact powers of ten, a decimal with a mantissa below 2^53 divided by one of them rounds correctly
+static const double powers_of_ten[] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+                                        1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+#define JSON_EXACT_MANTISSA 9007199254740992.0 // 2^53
+
+// Shortest fixed point form that reads back as the same value through parse_number(), this covers
+// most numbers people store and is much cheaper than printf. Returns 0 if there is none.
+static size_t format_fixed(const double number, const bool single, char* out) {
+    const double magnitude = fabs(number);
+
+    for (size_t decimals = 0; decimals <= 17; decimals++) {
+        const double scaled = magnitude * powers_of_ten[decimals];
+
+        if (scaled >= JSON_EXACT_MANTISSA)
+            return 0;
+
+        uint64_t mantissa = (uint64_t)(scaled + 0.5);
+        const double back = (double)mantissa / powers_of_ten[decimals];
+
+        if (single ? (float)back != (float)magnitude : back != magnitude)
+            continue;
+
+        char digits[24];
+        size_t count = 0;
+        do {
+            digits[count++] = (char)('0' + mantissa % 10);
+            mantissa /= 10;
+        } while (mantissa != 0 || count <= decimals);
+
+        size_t length = 0;
+        if (signbit(number))
+            out[length++] = '-';
+
+        while (count > 0) {
+            if (count == decimals)
+                out[length++] = '.';
+            out[length++] = digits[--count];
+        }
+
+        return length;
+    }
+
+    return 0;
+}
+
+static int64_t load_int(const char* src, const size_t size) {
+    switch (size) {
+    case 1: { int8_t v; memcpy(&v, src, 1); return v; }
+    case 2: { int16_t v; memcpy(&v, src, 2); return v; }
+    case 4: { int32_t v; memcpy(&v, src, 4); return v; }
+    default: { int64_t v; memcpy(&v, src, 8); return v; }
+    }
+}
+
+static uint64_t load_uint(const char* src, const size_t size) {
+    switch (size) {
+    case 1: { uint8_t v; memcpy(&v, src, 1); return v; }
+    case 2: { uint16_t v; memcpy(&v, src, 2); return v; }
+    case 4: { uint32_t v; memcpy(&v, src, 4); return v; }
+    default: { uint64_t v; memcpy(&v, src, 8); return v; }
+    }
+}
+
+static void store_int(char* dst, const uint64_t value, const size_t size) {
+    switch (size) {
+    case 1: { uint8_t v = (uint8_t)value; memcpy(dst, &v, 1); break; }
+    case 2: { uint16_t v = (uint16_t)value; memcpy(dst, &v, 2); break; }
+    case 4: { uint32_t v = (uint32_t)value; memcpy(dst, &v, 4); break; }
+    default: memcpy(dst, &value, 8);
+    }
+}
+
+static const json_enumerator_t* enumerator_by_value(const json_program_t* program, const int64_t value) {
+    size_t low = 0, high = program->enumerator_count;
+
+    while (low < high) {
+        const size_t mid = low + (high - low) / 2;
+
+        if (program->enumerators[mid].value < value)
+            low = mid + 1;
+        else
+            high = mid;
+    }
+
+    return low < program->enumerator_count && program->enumerators[low].value == value ? &program->enumerators[low] : NULL;
+}
+
+static void write_object(const reflect_json_plan_t* plan, const json_program_t* program, const char* src, reflect_json_writer_t* writer);
+
+static void write_value(const reflect_json_plan_t* plan, const json_value_t* value, const char* src, const uint32_t ptr_depth, reflect_json_writer_t* writer) {
+    if (ptr_depth > 0) {
+        const char* pointee = *(const char* const*)src;
+
+        if (pointee == NULL)
+            put(writer, "null", 4);
+        else
+            write_value(plan, value, pointee, ptr_depth - 1, writer);
+        return;
+    }
+
+    switch (value->kind) {
+    case JSON_INT:
+        put_int(writer, load_int(src, value->size));
+        break;
+    case JSON_UINT:
+        put_uint(writer, load_uint(src, value->size));
+        break;
+    case JSON_BOOL:
+        if (load_uint(src, value->size) != 0)
+            put(writer, "true", 4);
+        else
+            put(writer, "false", 5);
+        break;
+    case JSON_FLOAT: {
+        double number;
+        if (value->size == sizeof(float)) {
+            float f;
+            memcpy(&f, src, sizeof(f));
+            number = f;
+        } else {
+            memcpy(&number, src, sizeof(number));
+        }
+
+        if (!isfinite(number)) {
+            put(writer, "null", 4);
+            break;
+        }
+
+        char text[32];
+        size_t length = format_fixed(number, value->size == sizeof(float), text);
+        if (length == 0)
+            length = snprintf(text, sizeof(text), value->size == sizeof(float) ? "%.9g" : "%.17g", number);
+        put(writer, text, length);
+        break;
+    }
+    case JSON_ENUM: {
+        // values without an enumerator are written as numbers
+        const int64_t number = load_int(src, value->size);
+        const json_enumerator_t* enumerator = enumerator_by_value(&plan->programs[value->program], number);
+
+        if (enumerator != NULL)
+            put(writer, enumerator->literal, enumerator->literal_length);
+        else
+            put_int(writer, number);
+        break;
+    }
+    case JSON_STRING: {
+        const char* text = *(const char* const*)src;
+
+        if (text == NULL)
+            put(writer, "null", 4);
+        else
+            put_string(writer, text, strlen(text));
+        break;
+    }
+    case JSON_OBJECT:
+        write_object(plan, &plan->programs[value->program], src, writer);
+        break;
+    case JSON_CHARS:
+        break; // arrays only, see write_field()
+    }
+}
+
+static void write_field(const reflect_json_plan_t* plan, const json_field_t* field, const char* src, reflect_json_writer_t* writer) {
+    if (field->value.kind == JSON_CHARS) {
+        const char* end = memchr(src, 0, field->count);
+        put_string(writer, src, end != NULL ? (size_t)(end - src) : field->count);
+        return;
+    }
+
+    if (field->count == 0) {
+        write_value(plan, &field->value, src, field->value.ptr_depth, writer);
+        return;
+    }
+
+    const size_t stride = field->value.ptr_depth > 0 ? sizeof(void*) : field->value.size;
+
+    put_char(writer, '[');
+    for (size_t i = 0; i < field->count; i++) {
+        if (i > 0)
+            put_char(writer, ',');
+        write_value(plan, &field->value, src + i * stride, field->value.ptr_depth, writer);
+    }
+    put_char(writer, ']');
+}
+
+static void write_object(const reflect_json_plan_t* plan, const json_program_t* program, const char* src, reflect_json_writer_t* writer) {
+    put_char(writer, '{');
+
+    for (size_t i = 0; i < program->field_count; i++) {
+        const json_field_t* field = &program->fields[i];
+
+        if (i > 0)
+            put_char(writer, ',');
+
+        put(writer, field->key, field->key_length);
+        write_field(plan, field, src + field->offset, writer);
+    }
+
+    put_char(writer, '}');
+}
+
+// Hands everything buffered to writer->flush, false if it fails or there is no flush callback
+bool reflect_json_flush(reflect_json_writer_t* writer) {
+    if (writer == NULL || writer->flush == NULL || writer->failed)
+        return false;
+
+    if (writer->pos > 0 && !writer->flush(writer->user, writer->buf, writer->pos)) {
+        writer->failed = true;
+        return false;
+    }
+
+    writer->pos = 0;
+    return true;
+}
+
+// Appends the JSON of the value at ptr, false if it didn't fit and writer has no flush callback.
+// What is left in the buffer isn't flushed, see reflect_json_flush().
+bool reflect_json_plan_write(const reflect_json_plan_t* plan, const void* ptr, reflect_json_writer_t* writer) {
+    if (plan == NULL || ptr == NULL || writer == NULL || writer->failed)
+        return false;
+
+    write_value(plan, &plan->root, ptr, 0, writer);
+    return !writer->failed;
+}
+
+// Reading
+
+typedef struct {
+    const char* pos;
+    const char* end;
+} json_parser_t;
+
+static void skip_space(json_parser_t* parser) {
+    while (parser->pos != parser->end && (*parser->pos == ' ' || *parser->pos == '\n' || *parser->pos == '\r' || *parser->pos == '\t'))
+        parser->pos++;
+}
+
+// Skips whitespace and consumes c if it comes next
+static bool accept(json_parser_t* parser, const char c) {
+    skip_space(parser);
+
+    if (parser->pos == parser->end || *parser->pos != c)
+        return false;
+
+    parser->pos++;
+    return true;
+}
+
+static bool accept_literal(json_parser_t* parser, const char* literal, const size_t length) {
+    skip_space(parser);
+
+    if ((size_t)(parser->end - parser->pos) < length || memcmp(parser->pos, literal, length) != 0)
+        return false;
+
+    parser->pos += length;
+    return true;
+}
+
+// Finds the end of the string starting at the opening quote, the content is [*begin, *begin + *length)
+static bool scan_string(json_parser_t* parser, const char** begin, size_t* length, bool* escaped) {
+    if (!accept(parser, '"'))
+        return false;
+
+    const char* it = parser->pos;
+    *escaped = false;
+
+    while (it != parser->end && *it != '"') {
+        if ((unsigned char)*it < 0x20)
+            return false;
+
+        if (*it == '\\') {
+            *escaped = true;
+            if (++it == parser->end)
+                return false;
+        }
+        it++;
+    }
+
+    if (it == parser->end)
+        return false;
+
+    *begin = parser->pos;
+    *length = it - parser->pos;
+    parser->pos = it + 1;
+    return true;
+}
+
+static bool parse_hex4(const char* text, uint32_t* out) {
+    *out = 0;
+
+    for (int i = 0; i < 4; i++) {
+        const char c = text[i];
+        *out <<= 4;
+
+        if (c >= '0' && c <= '9')
+            *out |= c - '0';
+        else if (c >= 'a' && c <= 'f')
+            *out |= c - 'a' + 10;
+        else if (c >= 'A' && c <= 'F')
+            *out |= c - 'A' + 10;
+        else
+            return false;
+    }
+
+    return true;
+}
+
+// Decodes the escapes of a scanned string into out, which needs length bytes at most. Returns the
+// decoded length or SIZE_MAX for invalid escapes.
+static size_t unescape(const char* text, const size_t length, char* out) {
+    const char* end = text + length;
+    size_t size = 0;
+
+    while (text != end) {
+        if (*text != '\\') {
+            out[size++] = *text++;
+            continue;
+        }
+
+        text++;
+        switch (*text++) {
+        case '"': out[size++] = '"'; break;
+        case '\\': out[size++] = '\\'; break;
+        case '/': out[size++] = '/'; break;
+        case 'b': out[size++] = '\b'; break;
+        case 'f': out[size++] = '\f'; break;
+        case 'n': out[size++] = '\n'; break;
+        case 'r': out[size++] = '\r'; break;
+        case 't': out[size++] = '\t'; break;
+        case 'u': {
+            uint32_t code = 0, low = 0;
+
+            if (end - text < 4 || !parse_hex4(text, &code))
+                return SIZE_MAX;
+            text += 4;
+
+            // surrogate pairs combine into one code point
+            if (code >= 0xD800 && code <= 0xDBFF) {
+                if (end - text < 6 || text[0] != '\\' || text[1] != 'u' || !parse_hex4(text + 2, &low) || low < 0xDC00 || low > 0xDFFF)
+                    return SIZE_MAX;
+                text += 6;
+                code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+            } else if (code >= 0xDC00 && code <= 0xDFFF) {
+                return SIZE_MAX;
+            }
+
+            if (code < 0x80) {
+                out[size++] = (char)code;
+            } else if (code < 0x800) {
+                out[size++] = (char)(0xC0 | (code >> 6));
+                out[size++] = (char)(0x80 | (code & 0x3F));
+            } else if (code < 0x10000) {
+                out[size++] = (char)(0xE0 | (code >> 12));
+                out[size++] = (char)(0x80 | ((code >> 6) & 0x3F));
+                out[size++] = (char)(0x80 | (code & 0x3F));
+            } else {
+                out[size++] = (char)(0xF0 | (code >> 18));
+                out[size++] = (char)(0x80 | ((code >> 12) & 0x3F));
+                out[size++] = (char)(0x80 | ((code >> 6) & 0x3F));
+                out[size++] = (char)(0x80 | (code & 0x3F));
+            }
+            break;
+        }
+        default:
+            return SIZE_MAX;
+        }
+    }
+
+    return size;
+}
+
+static bool is_number_char(const char c) {
+    return (c >= '0' && c <= '9') || c == '-' || c == '+' || c == '.' || c == 'e' || c == 'E';
+}
+
+static bool parse_uint(json_parser_t* parser, uint64_t* out) {
+    const char* it = parser->pos;
+    uint64_t value = 0;
+
+    if (it == parser->end || *it < '0' || *it > '9')
+        return false;
+
+    for (; it != parser->end && *it >= '0' && *it <= '9'; it++) {
+        const uint64_t digit = *it - '0';
+
+        if (value > (UINT64_MAX - digit) / 10)
+            return false;
+
+        value = value * 10 + digit;
+    }
+
+    // fractions and exponents don't fit integer fields
+    if (it != parser->end && is_number_char(*it))
+        return false;
+
+    parser->pos = it;
+    *out = value;
+    return true;
+}
+
+static bool parse_int(json_parser_t* parser, const size_t size, const bool is_signed, uint64_t* out) {
+    skip_space(parser);
+
+    const bool negative = parser->pos != parser->end && *parser->pos == '-';
+    const char* start = parser->pos;
+    uint64_t magnitude = 0;
+
+    parser->pos += negative;
+    if ((negative && !is_signed) || !parse_uint(parser, &magnitude)) {
+        parser->pos = start;
+        return false;
+    }
+
+    const uint64_t max = size == 8 ? UINT64_MAX : ((uint64_t)1 << (size * 8)) - 1;
+    const uint64_t limit = is_signed ? max / 2 + negative : max;
+
+    if (magnitude > limit) {
+        parser->pos = start;
+        return false;
+    }
+
+    *out = negative ? (uint64_t)0 - magnitude : magnitude;
+    return true;
+}
+
+static bool parse_number(json_parser_t* parser, double* out) {
+    skip_space(parser);
+
+    char text[64];
+    size_t length = 0;
+
+    while (parser->pos + length != parser->end && is_number_char(parser->pos[length]) && length < sizeof(text) - 1) {
+        text[length] = parser->pos[length];
+        length++;
+    }
+
+    if (length == 0)
+        return false;
+
+    text[length] = 0;
+    parser->pos += length;
+
+    // plain decimals with up to 15 digits are exact as an integer over a power of ten
+    const char* it = text + (text[0] == '-');
+    uint64_t mantissa = 0;
+    size_t digits = 0, decimals = 0;
+    bool point = false;
+
+    for (; *it != 0; it++) {
+        if (*it == '.' && !point) {
+            point = true;
+        } else if (*it >= '0' && *it <= '9') {
+            mantissa = mantissa * 10 + (*it - '0');
+            digits++;
+            decimals += point;
+        } else {
+            break;
+        }
+    }
+
+    if (*it == 0 && digits > 0 && digits <= 15 && it[-1] != '.') {
+        const double magnitude = (double)mantissa / powers_of_ten[decimals];
+        *out = text[0] == '-' ? -magnitude : magnitude;
+        return true;
+    }
+
+    char* end = NULL;
+    *out = strtod(text, &end);
+
+    if (end != text + length) {
+        parser->pos -= length;
+        return false;
+    }
+
+    return true;
+}
+
+// Skips one value of any shape, for keys no field is known for
+static bool skip_value(json_parser_t* parser, const int depth) {
+    const char* begin;
+    size_t length;
+    bool escaped;
+    double number;
+
+    skip_space(parser);
+
+    if (parser->pos == parser->end || depth > JSON_MAX_DEPTH)
+        return false;
+
+    switch (*parser->pos) {
+    case '"':
+        return scan_string(parser, &begin, &length, &escaped);
+    case '{':
+    case '[': {
+        const char close = *parser->pos == '{' ? '}' : ']';
+        parser->pos++;
+
+        if (accept(parser, close))
+            return true;
+
+        do {
+            if (close == '}' && (!scan_string(parser, &begin, &length, &escaped) || !accept(parser, ':')))
+                return false;
+            if (!skip_value(parser, depth + 1))
+                return false;
+        } while (accept(parser, ','));
+
+        return accept(parser, close);
+    }
+    case 't':
+        return accept_literal(parser, "true", 4);
+    case 'f':
+        return accept_literal(parser, "false", 5);
+    case 'n':
+        return accept_literal(parser, "null", 4);
+    default:
+        return parse_number(parser, &number);
+    }
+}
+
+// Parses a string into a malloc'd NUL terminated copy
+static char* parse_string(json_parser_t* parser) {
+    const char* begin;
+    size_t length;
+    bool escaped;
+
+    if (!scan_string(parser, &begin, &length, &escaped))
+        return NULL;
+
+    char* text = malloc(length + 1);
+
+    if (text == NULL)
+        return NULL;
+
+    if (escaped) {
+        length = unescape(begin, length, text);
+
+        if (length == SIZE_MAX) {
+            free(text);
+            return NULL;
+        }
+    } else {
+        memcpy(text, begin, length);
+    }
+
+    text[length] = 0;
+    return text;
+}
+
+// Sets every pointer the program follows to NULL, so reading can tell its allocations from the rest
+static void clear_object(const reflect_json_plan_t* plan, const json_program_t* program, char* dst) {
+    if (!program->has_pointers)
+        return;
+
+    for (size_t i = 0; i < program->field_count; i++) {
+        const json_field_t* field = &program->fields[i];
+        const size_t count = field->count > 0 ? field->count : 1;
+
+        if (field->value.ptr_depth > 0 || field->value.kind == JSON_STRING) {
+            memset(dst + field->offset, 0, count * sizeof(void*));
+        } else if (field->value.kind == JSON_OBJECT) {
+            for (size_t j = 0; j < count; j++)
+                clear_object(plan, &plan->programs[field->value.program], dst + field->offset + j * field->value.size);
+        }
+    }
+}
+
+static void release_object(const reflect_json_plan_t* plan, const json_program_t* program, char* ptr);
+
+static void release_value(const reflect_json_plan_t* plan, const json_value_t* value, char* ptr, const uint32_t ptr_depth) {
+    if (ptr_depth > 0) {
+        char* pointee = *(char**)ptr;
+
+        if (pointee != NULL) {
+            release_value(plan, value, pointee, ptr_depth - 1);
+            free(pointee);
+            *(char**)ptr = NULL;
+        }
+    } else if (value->kind == JSON_STRING) {
+        free(*(char**)ptr);
+        *(char**)ptr = NULL;
+    } else if (value->kind == JSON_OBJECT) {
+        release_object(plan, &plan->programs[value->program], ptr);
+    }
+}
+
+static void release_object(const reflect_json_plan_t* plan, const json_program_t* program, char* ptr) {
+    if (!program->has_pointers)
+        return;
+
+    for (size_t i = 0; i < program->field_count; i++) {
+        const json_field_t* field = &program->fields[i];
+        const size_t stride = field->value.ptr_depth > 0 ? sizeof(void*) : field->value.size;
+
+        for (size_t j = 0; j < (field->count > 0 ? field->count : 1); j++)
+            release_value(plan, &field->value, ptr + field->offset + j * stride, field->value.ptr_depth);
+    }
+}
+
+static bool read_object(const reflect_json_plan_t* plan, const json_program_t* program, char* dst, json_parser_t* parser, int depth);
+
+static bool read_value(const reflect_json_plan_t* plan, const json_value_t* value, char* dst, const uint32_t ptr_depth, json_parser_t* parser, const int depth) {
+    uint64_t integer = 0;
+
+    if (depth > JSON_MAX_DEPTH)
+        return false;
+
+    if (ptr_depth > 0 || value->kind == JSON_STRING) {
+        // a key given twice replaces the earlier allocation
+        release_value(plan, value, dst, ptr_depth);
+
+        if (accept_literal(parser, "null", 4))
+            return true;
+
+        if (ptr_depth == 0)
+            return (*(char**)dst = parse_string(parser)) != NULL;
+
+        const size_t size = ptr_depth > 1 || value->kind == JSON_STRING ? sizeof(void*) : value->size;
+        char* pointee = calloc(1, size);
+
+        if (pointee == NULL)
+            return false;
+
+        if (ptr_depth == 1 && value->kind == JSON_OBJECT)
+            clear_object(plan, &plan->programs[value->program], pointee);
+
+        *(char**)dst = pointee;
+        return read_value(plan, value, pointee, ptr_depth - 1, parser, depth + 1);
+    }
+
+    switch (value->kind) {
+    case JSON_INT:
+    case JSON_UINT:
+        if (!parse_int(parser, value->size, value->kind == JSON_INT, &integer))
+            return false;
+        store_int(dst, integer, value->size);
+        return true;
+    case JSON_BOOL:
+        if (accept_literal(parser, "true", 4))
+            integer = 1;
+        else if (!accept_literal(parser, "false", 5))
+            return false;
+        store_int(dst, integer, value->size);
+        return true;
+    case JSON_FLOAT: {
+        double number = NAN;
+
+        if (!accept_literal(parser, "null", 4) && !parse_number(parser, &number))
+            return false;
+
+        if (value->size == sizeof(float)) {
+            const float f = (float)number;
+            memcpy(dst, &f, sizeof(f));
+        } else {
+            memcpy(dst, &number, sizeof(number));
+        }
+        return true;
+    }
+    case JSON_ENUM: {
+        // enumerator names, or numbers for values without one
+        const json_program_t* program = &plan->programs[value->program];
+        const char* begin;
+        size_t length;
+        bool escaped;
+
+        skip_space(parser);
+        if (parser->pos != parser->end && *parser->pos != '"') {
+            if (!parse_int(parser, value->size, true, &integer))
+                return false;
+        } else {
+            if (!scan_string(parser, &begin, &length, &escaped) || escaped)
+                return false;
+
+            const size_t found = find_name(program, &program->enumerators->name, sizeof(json_enumerator_t), begin, length);
+            if (found == 0)
+                return false;
+
+            integer = (uint64_t)program->enumerators[found - 1].value;
+        }
+
+        store_int(dst, integer, value->size);
+        return true;
+    }
+    case JSON_OBJECT:
+        return read_object(plan, &plan->programs[value->program], dst, parser, depth + 1);
+    default:
+        return false;
+    }
+}
+
+static bool read_field(const reflect_json_plan_t* plan, const json_field_t* field, char* dst, json_parser_t* parser, const int depth) {
+    if (field->value.kind == JSON_CHARS) {
+        const char* begin;
+        size_t length;
+        bool escaped;
+
+        if (!scan_string(parser, &begin, &length, &escaped))
+            return false;
+
+        // the decoded string can't be longer than the escaped one
+        char stack[256];
+        char* text = length <= sizeof(stack) ? stack : malloc(length);
+
+        if (text == NULL)
+            return false;
+
+        const size_t decoded = escaped ? unescape(begin, length, text) : length;
+        if (!escaped)
+            memcpy(text, begin, length);
+
+        const bool fits = decoded != SIZE_MAX && decoded <= field->count;
+        if (fits) {
+            memcpy(dst, text, decoded);
+            memset(dst + decoded, 0, field->count - decoded);
+        }
+
+        if (text != stack)
+            free(text);
+        return fits;
+    }
+
+    if (field->count == 0)
+        return read_value(plan, &field->value, dst, field->value.ptr_depth, parser, depth);
+
+    // shorter arrays leave the remaining elements as they are
+    const size_t stride = field->value.ptr_depth > 0 ? sizeof(void*) : field->value.size;
+
+    if (!accept(parser, '['))
+        return false;
+
+    if (accept(parser, ']'))
+        return true;
+
+    size_t i = 0;
+    do {
+        if (i == field->count || !read_value(plan, &field->value, dst + i * stride, field->value.ptr_depth, parser, depth + 1))
+            return false;
+        i++;
+    } while (accept(parser, ','));
+
+    return accept(parser, ']');
+}
+
+static bool read_object(const reflect_json_plan_t* plan, const json_program_t* program, char* dst, json_parser_t* parser, const int depth) {
+    if (depth > JSON_MAX_DEPTH || !accept(parser, '{'))
+        return false;
+
+    if (accept(parser, '}'))
+        return true;
+
+    // keys usually come in the order they were written, the next field is tried before the hash table
+    size_t next = 0;
+
+    do {
+        const char* key;
+        size_t length;
+        bool escaped;
+        char unescaped[256];
+
+        if (!scan_string(parser, &key, &length, &escaped) || !accept(parser, ':'))
+            return false;
+
+        if (escaped) {
+            if (length > sizeof(unescaped) || (length = unescape(key, length, unescaped)) == SIZE_MAX)
+                return false;
+            key = unescaped;
+        }
+
+        size_t found = 0;
+        if (next < program->field_count && program->fields[next].name.length == length &&
+            memcmp(program->fields[next].name.name, key, length) == 0)
+            found = next + 1;
+        else
+            found = find_name(program, &program->fields->name, sizeof(json_field_t), key, length);
+
+        if (found == 0) {
+            if (!skip_value(parser, depth))
+                return false;
+            continue;
+        }
+
+        const json_field_t* field = &program->fields[found - 1];
+        if (!read_field(plan, field, dst + field->offset, parser, depth))
+            return false;
+
+        next = found;
+    } while (accept(parser, ','));
+
+    return accept(parser, '}');
+}
+
+// Reads one value at reader->pos into ptr and moves reader->pos past it. Keys without a field are
+// skipped and fields without a key keep their value, except pointers, which start out NULL.
+// Pointees are allocated with malloc, reflect_json_plan_release() frees them again.
+bool reflect_json_plan_read(const reflect_json_plan_t* plan, reflect_json_reader_t* reader, void* ptr) {
+    if (plan == NULL || reader == NULL || ptr == NULL || reader->pos > reader->size)
+        return false;
+
+    json_parser_t parser = { reader->data + reader->pos, reader->data + reader->size };
+
+    if (plan->root.kind == JSON_OBJECT)
+        clear_object(plan, &plan->programs[plan->root.program], ptr);
+
+    if (!read_value(plan, &plan->root, ptr, 0, &parser, 0)) {
+        reflect_json_plan_release(plan, ptr);
+        return false;
+    }
+
+    reader->pos = parser.pos - reader->data;
+    return true;
+}
+
+// Frees the pointees reflect_json_plan_read() allocated for ptr, not ptr itself
+void reflect_json_plan_release(const reflect_json_plan_t* plan, void* ptr) {
+    if (plan == NULL || ptr == NULL)
+        return;
+
+    release_value(plan, &plan->root, ptr, 0);
+}
+
+// One shot versions, these compile a plan every call
+bool reflect_json_write(const void* ptr, const type_info_t* type, reflect_json_writer_t* writer) {
+    reflect_json_plan_t* plan = reflect_json_plan_compile(type);
+    const bool ok = reflect_json_plan_write(plan, ptr, writer);
+    reflect_json_plan_free(plan);
+    return ok;
+}
+
+bool reflect_json_read(reflect_json_reader_t* reader, void* ptr, const type_info_t* type) {
+    reflect_json_plan_t* plan = reflect_json_plan_compile(type);
+    const bool ok = reflect_json_plan_read(plan, reader, ptr);
+    reflect_json_plan_free(plan);
+    return ok;
+}
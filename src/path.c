@@ -0,0 +1,199 @@
+#include "reflect.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+// A compiled path is a list of offsets with a pointer dereference between each two of them:
+// offsets[0] is added to the base pointer, then for every following offset the pointer is
+// loaded and the offset added. Runs of fields, array indexes and embedded structs fold into one add.
+struct reflect_path {
+    const type_info_t* type;   // type of the value the path ends at
+    const field_info_t* field; // last field on the path
+    uint32_t ptr_depth;        // of the value the path ends at
+    size_t arr_size;           // elements left if the path ends at an array, 0 once indexed
+    size_t step_count;
+    size_t offsets[];
+};
+
+static bool is_identifier_char(const char c) {
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_';
+}
+
+// Size of one element of the value described by type/ptr_depth
+static size_t element_size(const type_info_t* type, const uint32_t ptr_depth) {
+    return ptr_depth > 0 ? sizeof(void*) : type->size;
+}
+
+// Decimal digits only, no sign or whitespace. Returns the end of the digits, NULL if there are none or index overflows.
+static const char* parse_index(const char* begin, size_t* index) {
+    const char* end = begin;
+
+    for (*index = 0; *end >= '0' && *end <= '9'; end++) {
+        const size_t digit = (size_t)(*end - '0');
+
+        if (*index > (SIZE_MAX - digit) / 10)
+            return NULL;
+
+        *index = *index * 10 + digit;
+    }
+
+    return end == begin ? NULL : end;
+}
+
+// Field names of embedded structs are flattened ("nest.x"), so the longest dotted run that names a
+// field of the current type wins. Returns the end of the consumed text or NULL.
+static const char* resolve_field(const type_info_t* type, const char* begin, char* scratch, const field_info_t** out) {
+    const char* end = begin;
+
+    while (is_identifier_char(*end) || (*end == '.' && is_identifier_char(end[1]) && end > begin))
+        end++;
+
+    while (end > begin) {
+        const size_t length = end - begin;
+        memcpy(scratch, begin, length);
+        scratch[length] = 0;
+
+        *out = reflect_get_field_type(type, scratch);
+        if (*out != NULL)
+            return end;
+
+        // drop the last dotted component and retry
+        do {
+            end--;
+        } while (end > begin && *end != '.');
+    }
+
+    return NULL;
+}
+
+// Grammar: field ( '.' field | '->' field | '[' index ']' )*
+// '[' indexes arrays in place, or a pointer after loading it. Returns NULL if the path doesn't resolve.
+reflect_path_t* reflect_path_compile(const type_info_t* type, const char* path) {
+    if (type == NULL || path == NULL || (type->variant != Struct && type->variant != Union))
+        return NULL;
+
+    const size_t path_length = strlen(path);
+
+    // every '[' or '-' may start a dereference, that bounds the step count
+    size_t max_steps = 1;
+    for (size_t i = 0; i < path_length; i++)
+        max_steps += path[i] == '[' || path[i] == '-';
+
+    reflect_path_t* result = malloc(sizeof(reflect_path_t) + max_steps * sizeof(size_t));
+    char* scratch = malloc(path_length + 1);
+
+    if (result == NULL || scratch == NULL)
+        goto fail;
+
+    *result = (reflect_path_t){ .type = type, .step_count = 1 };
+    result->offsets[0] = 0;
+
+    const char* it = path;
+    bool expect_field = true;
+
+    while (*it != 0) {
+        size_t* offset = &result->offsets[result->step_count - 1];
+
+        if (expect_field || *it == '.' || (it[0] == '-' && it[1] == '>')) {
+            if (!expect_field && *it == '.') {
+                it++;
+            } else if (!expect_field) {
+                if (result->arr_size != 0 || result->ptr_depth != 1)
+                    goto fail;
+
+                result->offsets[result->step_count++] = 0;
+                offset = &result->offsets[result->step_count - 1];
+                result->ptr_depth = 0;
+                it += 2;
+            }
+
+            if (result->arr_size != 0 || result->ptr_depth != 0 ||
+                (result->type->variant != Struct && result->type->variant != Union))
+                goto fail;
+
+            const field_info_t* field = NULL;
+            it = resolve_field(result->type, it, scratch, &field);
+
+            if (it == NULL)
+                goto fail;
+
+            *offset += field->offset;
+            result->field = field;
+            result->type = field->type_ptr;
+            result->ptr_depth = field->ptr_depth;
+            result->arr_size = field->arr_size;
+            expect_field = false;
+        } else if (*it == '[') {
+            size_t index = 0;
+            const char* index_end = parse_index(it + 1, &index);
+
+            if (index_end == NULL || *index_end != ']')
+                goto fail;
+
+            if (result->arr_size != 0) {
+                if (index >= result->arr_size)
+                    goto fail;
+
+                result->arr_size = 0;
+            } else if (result->ptr_depth != 0) {
+                result->offsets[result->step_count++] = 0;
+                offset = &result->offsets[result->step_count - 1];
+                result->ptr_depth--;
+            } else {
+                goto fail;
+            }
+
+            const size_t size = element_size(result->type, result->ptr_depth);
+            if (size != 0 && index > (SIZE_MAX - *offset) / size)
+                goto fail;
+
+            *offset += index * size;
+            it = index_end + 1;
+        } else {
+            goto fail;
+        }
+    }
+
+    if (expect_field)
+        goto fail;
+
+    free(scratch);
+    return result;
+
+fail:
+    free(scratch);
+    free(result);
+    return NULL;
+}
+
+void reflect_path_free(reflect_path_t* path) {
+    free(path);
+}
+
+// NULL if a pointer on the way is NULL
+void* reflect_path_get(const reflect_path_t* path, void* struct_ptr) {
+    if (path == NULL || struct_ptr == NULL)
+        return NULL;
+
+    char* ptr = (char*)struct_ptr + path->offsets[0];
+
+    for (size_t i = 1; i < path->step_count; i++) {
+        ptr = *(char**)ptr;
+
+        if (ptr == NULL)
+            return NULL;
+
+        ptr += path->offsets[i];
+    }
+
+    return ptr;
+}
+
+const type_info_t* reflect_path_type(const reflect_path_t* path) {
+    return path == NULL ? NULL : path->type;
+}
+
+const field_info_t* reflect_path_field(const reflect_path_t* path) {
+    return path == NULL ? NULL : path->field;
+}
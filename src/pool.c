@@ -0,0 +1,627 @@
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(_WIN32)
+#include <malloc.h>
+#else
+#include <pthread.h>
+#endif
+
+// Per-type slab pools and arenas. Memory comes in page aligned spans, a span starts with a pool_span_t
+// and holds elements of a single type. A page map resolves any address to its span without touching the address,
+// which gives the type of pooled objects with no per-object header.
+// Pools keep a shared free list behind a spin lock, every thread caches a few slots per pool so most
+// allocations and frees don't touch it. A thread's cache is set associative by pool, misses and thread exit
+// hand the slots back to their pools.
+
+#define POOL_PAGE_SHIFT 12
+#define POOL_PAGE_SIZE ((size_t)1 << POOL_PAGE_SHIFT)
+#define POOL_MAP_BITS 12 // three levels of 4096 entries cover 48 bit addresses
+#define POOL_MAP_SIZE ((size_t)1 << POOL_MAP_BITS)
+#define POOL_SLAB_SIZE ((size_t)64 << 10)
+#define POOL_MAX_OBJECT (POOL_SLAB_SIZE / 8) // larger types don't pool
+#define POOL_CACHE_SETS 16 // a pool always lands in set id % POOL_CACHE_SETS of a thread cache
+#define POOL_CACHE_WAYS 4  // pools sharing a set that are cached at once
+#define POOL_CACHE_LIMIT 64 // a thread cache growing past this goes back to its pool whole
+#define POOL_BATCH 32 // slots a thread cache takes from its pool at once
+
+typedef enum {
+    POOL_SPAN_SLAB,  // slots of a pool
+    POOL_SPAN_ARRAY, // one reflect_alloc_array()
+    POOL_SPAN_ARENA, // a chunk of an arena, freed with it
+} pool_span_kind_t;
+
+typedef struct pool_span {
+    const type_info_t* type;
+    reflect_pool_t* pool;   // owner of a slab
+    pool_span_kind_t kind;
+    char* objects;          // first element
+    size_t stride;
+    size_t count;           // elements, for arena chunks the ones handed out so far
+    size_t size;            // bytes of the span, this header included
+    struct pool_span* next; // slabs of the same pool, chunks of the same arena
+} pool_span_t;
+
+#define POOL_SPAN_HEADER ((sizeof(pool_span_t) + 15) & ~(size_t)15)
+
+struct reflect_pool {
+    const type_info_t* type;
+    uint64_t id;
+    size_t stride;
+    uint32_t lock;
+    void* free_list;      // linked through the first word of each free slot
+    pool_span_t* slabs;
+    char* bump;           // slots of the newest slab never handed out
+    char* bump_end;
+    char* name;           // of the type a detached pool had, see pool_detach()
+    size_t size;
+    reflect_pool_t* next; // detached pools
+};
+
+typedef struct {
+    reflect_pool_t* pool; // NULL for an unused way, only written under the lock of its thread cache
+    void* head;
+    void* tail; // so the whole list goes back to its pool at once
+    size_t count;
+} pool_cache_t;
+
+// The owner uses its ways without locking on hits. Misses, thread exit and reflect_pool_destroy() (dropping
+// the ways of its pool from every thread) take lock, so a way's pool is alive as long as the way holds it.
+typedef struct pool_thread_cache {
+    pool_cache_t ways[POOL_CACHE_SETS][POOL_CACHE_WAYS];
+    uint8_t victim[POOL_CACHE_SETS]; // way replaced next when a set is full, round robin
+    uint32_t lock;
+    struct pool_thread_cache* next; // all thread caches, under pool_threads_lock
+    struct pool_thread_cache** prev;
+} pool_thread_cache_t;
+
+typedef struct {
+    pool_span_t* spans[POOL_MAP_SIZE];
+} pool_map_leaf_t;
+
+typedef struct {
+    pool_map_leaf_t* leaves[POOL_MAP_SIZE];
+} pool_map_node_t;
+
+// Nodes are created on first use and live until the process exits
+static pool_map_node_t* pool_map[POOL_MAP_SIZE];
+
+static __thread pool_thread_cache_t* pool_thread_cache = NULL;
+static pool_thread_cache_t* pool_threads = NULL;
+static uint32_t pool_threads_lock = 0;
+
+// pool_thread_key state, the key's destructor flushes the cache of an exiting thread
+#define POOL_KEY_PENDING 0
+#define POOL_KEY_CREATING 1
+#define POOL_KEY_READY 2
+static uint32_t pool_key_state = POOL_KEY_PENDING;
+#if defined(_WIN32)
+static DWORD pool_thread_key;
+#else
+static pthread_key_t pool_thread_key;
+#endif
+
+static uint64_t pool_next_id = 1;
+static reflect_pool_t* pool_detached = NULL;
+static uint32_t pool_detached_lock = 0;
+
+static void pool_lock(uint32_t* lock) {
+    while (__atomic_exchange_n(lock, 1, __ATOMIC_ACQUIRE))
+        wait_yield();
+}
+
+static void pool_unlock(uint32_t* lock) {
+    __atomic_store_n(lock, 0, __ATOMIC_RELEASE);
+}
+
+static void* pool_pages_alloc(const size_t size) {
+#if defined(_WIN32)
+    return _aligned_malloc(size, POOL_PAGE_SIZE);
+#else
+    void* pages = NULL;
+    return posix_memalign(&pages, POOL_PAGE_SIZE, size) == 0 ? pages : NULL;
+#endif
+}
+
+static void pool_pages_free(void* pages) {
+#if defined(_WIN32)
+    _aligned_free(pages);
+#else
+    free(pages);
+#endif
+}
+
+// The span owning address, NULL for memory that didn't come from a span. Never reads address itself.
+static pool_span_t* pool_map_find(const void* address) {
+    const uintptr_t page = (uintptr_t)address >> POOL_PAGE_SHIFT;
+
+    if (page >> (3 * POOL_MAP_BITS))
+        return NULL;
+
+    const pool_map_node_t* node = __atomic_load_n(&pool_map[page >> (2 * POOL_MAP_BITS)], __ATOMIC_ACQUIRE);
+
+    if (node == NULL)
+        return NULL;
+
+    const pool_map_leaf_t* leaf = __atomic_load_n(&node->leaves[(page >> POOL_MAP_BITS) & (POOL_MAP_SIZE - 1)], __ATOMIC_ACQUIRE);
+
+    if (leaf == NULL)
+        return NULL;
+
+    return __atomic_load_n(&leaf->spans[page & (POOL_MAP_SIZE - 1)], __ATOMIC_ACQUIRE);
+}
+
+// Creates the node behind slot if it is missing, racing threads agree on the first one published
+static void* pool_map_node(void** slot, const size_t size) {
+    void* node = __atomic_load_n(slot, __ATOMIC_ACQUIRE);
+
+    if (node != NULL)
+        return node;
+
+    void* created = calloc(1, size);
+
+    if (created == NULL)
+        return NULL;
+
+    if (!__atomic_compare_exchange_n(slot, &node, created, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+        free(created);
+        return node;
+    }
+
+    return created;
+}
+
+// Points every page of span at value (the span itself or NULL)
+static bool pool_map_set(pool_span_t* span, pool_span_t* value) {
+    const uintptr_t first = (uintptr_t)span >> POOL_PAGE_SHIFT;
+    const uintptr_t last = ((uintptr_t)span + span->size - 1) >> POOL_PAGE_SHIFT;
+
+    if (last >> (3 * POOL_MAP_BITS))
+        return false;
+
+    for (uintptr_t page = first; page <= last; page++) {
+        pool_map_node_t* node = pool_map_node((void**)&pool_map[page >> (2 * POOL_MAP_BITS)], sizeof(pool_map_node_t));
+        pool_map_leaf_t* leaf = node == NULL ? NULL : pool_map_node((void**)&node->leaves[(page >> POOL_MAP_BITS) & (POOL_MAP_SIZE - 1)], sizeof(pool_map_leaf_t));
+
+        if (leaf == NULL)
+            return false;
+
+        __atomic_store_n(&leaf->spans[page & (POOL_MAP_SIZE - 1)], value, __ATOMIC_RELEASE);
+    }
+
+    return true;
+}
+
+static pool_span_t* pool_span_create(const type_info_t* type, const pool_span_kind_t kind, const size_t stride, const size_t count) {
+    const size_t size = (POOL_SPAN_HEADER + stride * count + POOL_PAGE_SIZE - 1) & ~(POOL_PAGE_SIZE - 1);
+    pool_span_t* span = pool_pages_alloc(size);
+
+    if (span == NULL)
+        return NULL;
+
+    *span = (pool_span_t){
+        .type = type,
+        .kind = kind,
+        .objects = (char*)span + POOL_SPAN_HEADER,
+        .stride = stride,
+        .count = count,
+        .size = size,
+    };
+
+    if (!pool_map_set(span, span)) {
+        pool_map_set(span, NULL);
+        pool_pages_free(span);
+        return NULL;
+    }
+
+    return span;
+}
+
+static void pool_span_destroy(pool_span_t* span) {
+    pool_map_set(span, NULL);
+    pool_pages_free(span);
+}
+
+// Type of the element at address, NULL if address is inside the span but not at an element
+// Whether address is the start of an element of span
+static bool pool_span_holds(const pool_span_t* span, const void* address) {
+    const size_t offset = (size_t)((const char*)address - span->objects);
+    return (const char*)address >= span->objects && offset < span->count * span->stride && offset % span->stride == 0;
+}
+
+static const type_info_t* pool_span_type(const pool_span_t* span, const void* address) {
+    return pool_span_holds(span, address) ? span->type : NULL;
+}
+
+static void pool_cache_push(pool_cache_t* cache, void* slot) {
+    *(void**)slot = cache->head;
+    cache->head = slot;
+
+    if (cache->count++ == 0)
+        cache->tail = slot;
+}
+
+// Moves every slot of cache to the shared free list of pool
+static void pool_cache_return(reflect_pool_t* pool, pool_cache_t* cache) {
+    pool_lock(&pool->lock);
+    *(void**)cache->tail = pool->free_list;
+    pool->free_list = cache->head;
+    pool_unlock(&pool->lock);
+
+    cache->head = cache->tail = NULL;
+    cache->count = 0;
+}
+
+// Thread exit, every cached slot goes back to its pool
+#if defined(_WIN32)
+static void WINAPI pool_thread_exit(void* value) {
+#else
+static void pool_thread_exit(void* value) {
+#endif
+    pool_thread_cache_t* cache = value;
+
+    if (cache == NULL)
+        return;
+
+    // still linked and under the cache lock, so reflect_pool_destroy() can't free a pool in between
+    pool_lock(&cache->lock);
+    for (size_t set = 0; set < POOL_CACHE_SETS; set++) {
+        for (size_t way = 0; way < POOL_CACHE_WAYS; way++) {
+            if (cache->ways[set][way].head != NULL)
+                pool_cache_return(cache->ways[set][way].pool, &cache->ways[set][way]);
+            __atomic_store_n(&cache->ways[set][way].pool, NULL, __ATOMIC_RELAXED);
+        }
+    }
+    pool_unlock(&cache->lock);
+
+    pool_lock(&pool_threads_lock);
+    *cache->prev = cache->next;
+    if (cache->next != NULL)
+        cache->next->prev = cache->prev;
+    pool_unlock(&pool_threads_lock);
+
+    // destructors running after this one may still use pools, they get a new cache
+    pool_thread_cache = NULL;
+    free(cache);
+}
+
+static bool pool_key_create(void) {
+    uint32_t state = __atomic_load_n(&pool_key_state, __ATOMIC_ACQUIRE);
+
+    if (state == POOL_KEY_PENDING &&
+        __atomic_compare_exchange_n(&pool_key_state, &state, POOL_KEY_CREATING, false, __ATOMIC_ACQUIRE, __ATOMIC_ACQUIRE)) {
+#if defined(_WIN32)
+        // fiber local storage callbacks also run at thread exit, thread local storage has none
+        pool_thread_key = FlsAlloc(pool_thread_exit);
+        const bool created = pool_thread_key != FLS_OUT_OF_INDEXES;
+#else
+        const bool created = pthread_key_create(&pool_thread_key, pool_thread_exit) == 0;
+#endif
+        __atomic_store_n(&pool_key_state, created ? POOL_KEY_READY : POOL_KEY_PENDING, __ATOMIC_RELEASE);
+        return created;
+    }
+
+    while ((state = __atomic_load_n(&pool_key_state, __ATOMIC_ACQUIRE)) == POOL_KEY_CREATING)
+        wait_yield();
+
+    return state == POOL_KEY_READY;
+}
+
+// The cache of the calling thread, created on its first pool use. NULL if that fails, pools then
+// go to their shared free lists directly.
+static pool_thread_cache_t* pool_thread_cache_get(void) {
+    pool_thread_cache_t* cache = pool_thread_cache;
+
+    if (cache != NULL)
+        return cache;
+
+    if (!pool_key_create() || (cache = calloc(1, sizeof(pool_thread_cache_t))) == NULL)
+        return NULL;
+
+#if defined(_WIN32)
+    const bool registered = FlsSetValue(pool_thread_key, cache);
+#else
+    const bool registered = pthread_setspecific(pool_thread_key, cache) == 0;
+#endif
+
+    if (!registered) {
+        free(cache);
+        return NULL;
+    }
+
+    pool_lock(&pool_threads_lock);
+    cache->next = pool_threads;
+    cache->prev = &pool_threads;
+    if (pool_threads != NULL)
+        pool_threads->prev = &cache->next;
+    pool_threads = cache;
+    pool_unlock(&pool_threads_lock);
+
+    pool_thread_cache = cache;
+    return cache;
+}
+
+// The way of the calling thread caching pool. A full set hands the slots of its next victim back first.
+static pool_cache_t* pool_cache(reflect_pool_t* pool) {
+    pool_thread_cache_t* thread = pool_thread_cache_get();
+
+    if (thread == NULL)
+        return NULL;
+
+    const size_t set = pool->id % POOL_CACHE_SETS;
+    pool_cache_t* ways = thread->ways[set];
+
+    for (size_t way = 0; way < POOL_CACHE_WAYS; way++) {
+        if (__atomic_load_n(&ways[way].pool, __ATOMIC_RELAXED) == pool)
+            return &ways[way];
+    }
+
+    pool_lock(&thread->lock);
+
+    pool_cache_t* cache = NULL;
+    for (size_t way = 0; way < POOL_CACHE_WAYS && cache == NULL; way++) {
+        if (ways[way].pool == NULL)
+            cache = &ways[way];
+    }
+
+    if (cache == NULL) {
+        cache = &ways[thread->victim[set]];
+        thread->victim[set] = (thread->victim[set] + 1) % POOL_CACHE_WAYS;
+
+        if (cache->head != NULL)
+            pool_cache_return(cache->pool, cache);
+    }
+
+    *cache = (pool_cache_t){ 0 };
+    __atomic_store_n(&cache->pool, pool, __ATOMIC_RELAXED);
+
+    pool_unlock(&thread->lock);
+    return cache;
+}
+
+// Moves up to POOL_BATCH slots into cache, from the shared free list or else from the newest slab
+static bool pool_refill(reflect_pool_t* pool, pool_cache_t* cache) {
+    pool_lock(&pool->lock);
+
+    while (cache->count < POOL_BATCH && pool->free_list != NULL) {
+        void* slot = pool->free_list;
+        pool->free_list = *(void**)slot;
+        pool_cache_push(cache, slot);
+    }
+
+    if (cache->count == 0 && pool->bump == pool->bump_end) {
+        pool_span_t* slab = pool_span_create(pool->type, POOL_SPAN_SLAB, pool->stride, (POOL_SLAB_SIZE - POOL_SPAN_HEADER) / pool->stride);
+
+        if (slab != NULL) {
+            slab->pool = pool;
+            slab->next = pool->slabs;
+            pool->slabs = slab;
+            pool->bump = slab->objects;
+            pool->bump_end = slab->objects + slab->count * slab->stride;
+        }
+    }
+
+    for (; cache->count < POOL_BATCH && pool->bump != pool->bump_end; pool->bump += pool->stride)
+        pool_cache_push(cache, pool->bump);
+
+    pool_unlock(&pool->lock);
+    return cache->count > 0;
+}
+
+// Pools types up to 8 KB, slots are the type size rounded up to pointer size
+reflect_pool_t* reflect_pool_create(const type_info_t* type) {
+    if (type == NULL || type->size > POOL_MAX_OBJECT)
+        return NULL;
+
+    reflect_pool_t* pool = calloc(1, sizeof(reflect_pool_t));
+
+    if (pool == NULL)
+        return NULL;
+
+    const size_t size = type->size > sizeof(void*) ? type->size : sizeof(void*);
+
+    pool->type = type;
+    pool->id = __atomic_fetch_add(&pool_next_id, 1, __ATOMIC_RELAXED);
+    pool->stride = (size + sizeof(void*) - 1) & ~(sizeof(void*) - 1);
+
+    return pool;
+}
+
+// Frees every object of pool at once, no other thread may use it anymore
+void reflect_pool_destroy(reflect_pool_t* pool) {
+    if (pool == NULL)
+        return;
+
+    // slots cached by any thread belong to the slabs freed below
+    pool_lock(&pool_threads_lock);
+    for (pool_thread_cache_t* thread = pool_threads; thread != NULL; thread = thread->next) {
+        pool_cache_t* ways = thread->ways[pool->id % POOL_CACHE_SETS];
+
+        pool_lock(&thread->lock);
+        for (size_t way = 0; way < POOL_CACHE_WAYS; way++) {
+            if (ways[way].pool == pool) {
+                ways[way] = (pool_cache_t){ 0 };
+                __atomic_store_n(&ways[way].pool, NULL, __ATOMIC_RELAXED);
+            }
+        }
+        pool_unlock(&thread->lock);
+    }
+    pool_unlock(&pool_threads_lock);
+
+    for (pool_span_t* slab = pool->slabs; slab != NULL;) {
+        pool_span_t* next = slab->next;
+        pool_span_destroy(slab);
+        slab = next;
+    }
+
+    free(pool);
+}
+
+static void pool_set_type(reflect_pool_t* pool, const type_info_t* type) {
+    pool_lock(&pool->lock);
+    pool->type = type;
+    for (pool_span_t* slab = pool->slabs; slab != NULL; slab = slab->next)
+        slab->type = type;
+    pool_unlock(&pool->lock);
+}
+
+// Keeps the objects of pool alive after its type is gone, they have no type until pool_adopt() hands the
+// pool to a type of the same name and size. A pool that never allocated is destroyed.
+static void pool_detach(reflect_pool_t* pool) {
+    if (pool == NULL)
+        return;
+
+    if (pool->slabs == NULL) {
+        reflect_pool_destroy(pool);
+        return;
+    }
+
+    // anonymous types can't be told apart, their pools are never adopted
+    const size_t length = strlen(pool->type->name) + 1;
+    pool->name = length > 1 ? malloc(length) : NULL;
+    if (pool->name != NULL)
+        memcpy(pool->name, pool->type->name, length);
+
+    pool->size = pool->type->size;
+    pool_set_type(pool, NULL);
+
+    pool_lock(&pool_detached_lock);
+    pool->next = pool_detached;
+    pool_detached = pool;
+    pool_unlock(&pool_detached_lock);
+}
+
+// The detached pool of an earlier type with the name and size of type, now pooling type. NULL if there is none.
+static reflect_pool_t* pool_adopt(const type_info_t* type) {
+    reflect_pool_t* pool = NULL;
+
+    pool_lock(&pool_detached_lock);
+    for (reflect_pool_t** it = &pool_detached; *it != NULL; it = &(*it)->next) {
+        if ((*it)->name != NULL && (*it)->size == type->size && strcmp((*it)->name, type->name) == 0) {
+            pool = *it;
+            *it = pool->next;
+            break;
+        }
+    }
+    pool_unlock(&pool_detached_lock);
+
+    if (pool == NULL)
+        return NULL;
+
+    free(pool->name);
+    pool->name = NULL;
+    pool->next = NULL;
+    pool_set_type(pool, type);
+    return pool;
+}
+
+// Uninitialized like malloc
+void* reflect_pool_alloc(reflect_pool_t* pool) {
+    if (pool == NULL)
+        return NULL;
+
+    pool_cache_t local = { 0 };
+    pool_cache_t* cache = pool_cache(pool);
+
+    if (cache == NULL)
+        cache = &local;
+
+    if (cache->head == NULL && !pool_refill(pool, cache))
+        return NULL;
+
+    void* object = cache->head;
+    cache->head = *(void**)object;
+
+    if (--cache->count == 0)
+        cache->tail = NULL;
+    else if (cache == &local)
+        pool_cache_return(pool, cache);
+
+    return object;
+}
+
+void reflect_pool_free(reflect_pool_t* pool, void* ptr) {
+    if (pool == NULL || ptr == NULL)
+        return;
+
+    pool_cache_t local = { 0 };
+    pool_cache_t* cache = pool_cache(pool);
+
+    if (cache == NULL)
+        cache = &local;
+
+    pool_cache_push(cache, ptr);
+
+    if (cache == &local || cache->count > POOL_CACHE_LIMIT)
+        pool_cache_return(pool, cache);
+}
+
+// N contiguous elements behind a single span header, every element resolves with reflect_get_type_info().
+// Spans are page granular, so this is meant for bulk allocations. Free with reflect_free().
+void* reflect_alloc_array(const type_info_t* type, const size_t count) {
+    if (type == NULL || type->size == 0 || count == 0 || count > (SIZE_MAX - POOL_SPAN_HEADER - POOL_PAGE_SIZE) / type->size)
+        return NULL;
+
+    pool_span_t* span = pool_span_create(type, POOL_SPAN_ARRAY, type->size, count);
+    return span == NULL ? NULL : span->objects;
+}
+
+struct reflect_arena {
+    const type_info_t* type;
+    pool_span_t* chunks; // newest first, allocations come from the newest
+};
+
+reflect_arena_t* reflect_arena_create(const type_info_t* type) {
+    if (type == NULL || type->size == 0)
+        return NULL;
+
+    reflect_arena_t* arena = calloc(1, sizeof(reflect_arena_t));
+
+    if (arena != NULL)
+        arena->type = type;
+
+    return arena;
+}
+
+// count contiguous uninitialized elements, they are only freed with the whole arena
+void* reflect_arena_alloc(reflect_arena_t* arena, const size_t count) {
+    if (arena == NULL || count == 0)
+        return NULL;
+
+    const size_t stride = arena->type->size;
+    pool_span_t* chunk = arena->chunks;
+
+    if (chunk == NULL || count > (chunk->size - POOL_SPAN_HEADER) / stride - chunk->count) {
+        if (count > (SIZE_MAX - POOL_SPAN_HEADER - POOL_PAGE_SIZE) / stride)
+            return NULL;
+
+        const size_t slab_count = (POOL_SLAB_SIZE - POOL_SPAN_HEADER) / stride;
+        chunk = pool_span_create(arena->type, POOL_SPAN_ARENA, stride, count > slab_count ? count : slab_count);
+
+        if (chunk == NULL)
+            return NULL;
+
+        chunk->count = 0;
+        chunk->next = arena->chunks;
+        arena->chunks = chunk;
+    }
+
+    void* elements = chunk->objects + chunk->count * stride;
+    chunk->count += count;
+    return elements;
+}
+
+void reflect_arena_destroy(reflect_arena_t* arena) {
+    if (arena == NULL)
+        return;
+
+    for (pool_span_t* chunk = arena->chunks; chunk != NULL;) {
+        pool_span_t* next = chunk->next;
+        pool_span_destroy(chunk);
+        chunk = next;
+    }
+
+    free(arena);
+}
@@ -3,231 +3,751 @@
 #include <stddef.h>
 #include <stdint.h>
 
+#if defined(_WIN32)
+#include <windows.h>
+#elif defined(__unix__) || defined(__APPLE__)
+#include <sched.h>
+#endif
+
+// Gives up the time slice while another thread finishes building, it may be preempted
+static void wait_yield() {
+#if defined(_WIN32)
+    SwitchToThread();
+#elif defined(__unix__) || defined(__APPLE__)
+    sched_yield();
+#endif
+}
+
 #include "hashtable.c"
-#include "reader.c"
+#include "blob.c"
+#include "arena.c"
+#include "pool.c"
 
 #define REFLECT_DYNAMIC_ALLOC_MAGIC 0x75757575
 #define REFLECT_TYPE_INFO_INTERNAL_SIZE (sizeof(type_info_internal) - sizeof(type_info_t))
 
-// A type header is added if reflect_alloc(), this is to prevent breakages if
-// reflect_get_type_info is called on data not initialized this way
+// type_info_internal.fields_state
+#define REFLECT_FIELDS_PENDING 0
+#define REFLECT_FIELDS_BUILDING 1
+#define REFLECT_FIELDS_READY 2
+
+// Longest dotted name find_nested_field() resolves
+#define REFLECT_NESTED_NAME_MAX 256
+
+// reflect_context_t.load_state
+#define REFLECT_LOAD_NONE 0
+#define REFLECT_LOAD_LOADING 1
+#define REFLECT_LOAD_READY 2
+
+// A type header is added if reflect_alloc() gets an allocator, this is to prevent breakages if
+// reflect_get_type_info is called on data not initialized this way. Pooled objects have none.
 typedef struct {
     uint32_t magic;
     const type_info_t* type_info_ptr;
-    size_t size;
-    bool is_ptr;
 } reflect_type_header_t;
 
+// Fields of a struct with its embedded structs expanded, for blobs that reference them by type
+// instead of flattening (plugin nested=hierarchical). Expanded views are one malloc starting at fields,
+// see build_flat_fields(), the others point at the fields of the type.
+typedef struct {
+    field_info_t* fields;
+    size_t count;
+    hashtable_t table; // empty if nothing was expanded, the type's own index answers then
+} reflect_flat_fields_t;
+
 typedef struct {
     union {
         field_info_t* struct_fields;
         enum_field_info_t* enum_fields;
     };
+    reflect_context_t* context; // the context that loaded this type
+    uint32_t field_index; // blob offset of the prebuilt field index, 0 if field_table is used
+    uint32_t fields_state; // fields and field_table are built on first use, see load_fields()
+    uint32_t flat_state; // same for flat_fields, see load_flat_fields()
     hashtable_t field_table;
+    reflect_flat_fields_t flat_fields;
+    const reflect_blob_value_index_t* value_index; // enums, from the blob or built when it has none
+    reflect_pool_t* pool; // backs reflect_alloc() without an allocator, created on first use
     type_info_t type;
 } type_info_internal;
 
-static type_info_internal* type_table = NULL;
-static hashtable_t type_hash_table = {
-    .data = NULL,
-    .capacity = 0
+// Threading: loading happens once per context, guarded by load_state. The loaded and mapped blob
+// pointers are stored last with release ordering and read with acquire ordering by every entry point
+// that doesn't already hold a type from them, so everything built before publication is visible to
+// any reader. After that the read API never blocks, except that the first use of a type's fields
+// waits for a thread already building them (see load_fields()). Unloading must not race with readers.
+struct reflect_context {
+    type_info_internal* type_table;
+    hashtable_t type_hash_table;
+    arena_t arena;                          // owns everything above and the blob copy
+    field_info_t* field_storage;            // indexed like the blob field records
+    enum_field_info_t* enum_field_storage;
+    const reflect_blob_header_t* loaded_blob;
+    uint32_t load_state;
+    reflect_context_t* parent;              // name lookups that miss continue here
 };
-static bool is_init = false;
+
+// Used by every function without a context parameter
+static reflect_context_t default_context = { 0 };
+static const reflect_blob_header_t* mapped_blob = NULL;
 
 static type_info_internal* get_internal_from_type_info(const type_info_t* type_info) {
     return (type_info_internal*)((char*)type_info - REFLECT_TYPE_INFO_INTERNAL_SIZE);
 }
 
-static type_info_t* add_base_type_info(const char* name, const size_t id, const size_t size) {
-    type_table[id].type.id = id;
-    type_table[id].type.name = name;
-    type_table[id].type.size = size;
-    type_table[id].type.variant = Base;
-    type_table[id].type.field_count = 0;
-    type_table[id].struct_fields = NULL;
-
-    hashtable_insert(&type_hash_table, &(hash_t){
-        .name = name,
-        .id = id
-    });
-
-    return &type_table[id].type;
-}
-
-static type_info_t* add_struct_type_info(const char* name, const size_t id, const size_t size, uint8_t variant, const size_t field_count) {
-    type_table[id].type.id = id;
-    type_table[id].type.name = name;
-    type_table[id].type.size = size;
-    type_table[id].type.variant = variant;
-    type_table[id].type.field_count = 0;
-    type_table[id].struct_fields = malloc(sizeof(field_info_t) * field_count);
-    type_table[id].field_table = hashtable_create(field_count * 2);
-
-    hashtable_insert(&type_hash_table, &(hash_t){
-        .name = name,
-        .id = id
-    });
-
-    return &type_table[id].type;
-}
-
-static type_info_t* add_enum_type_info(const char* name, const size_t id, const size_t size, const size_t field_count) {
-    type_table[id].type.id = id;
-    type_table[id].type.name = name;
-    type_table[id].type.size = size;
-    type_table[id].type.variant = Enum;
-    type_table[id].type.field_count = 0;
-    type_table[id].enum_fields = malloc(sizeof(enum_field_info_t) * field_count);
-    type_table[id].field_table = hashtable_create(field_count * 2);
-
-    hashtable_insert(&type_hash_table, &(hash_t){
-        .name = name,
-        .id = id
-    });
-
-    return &type_table[id].type;
-}
-
-static void add_struct_field_type(type_info_t* struct_type, const char* field_name, const size_t field_type, const size_t size, const size_t offset, const uint32_t ptr_depth, const bool is_const) {
-    const field_info_t field_info = {
-        .name = field_name,
-        .arr_size = size,
-        .offset = offset,
-        .type_ptr = (type_info_t*)((char*)(type_table + field_type) + REFLECT_TYPE_INFO_INTERNAL_SIZE),
-        .is_const = is_const,
-        .ptr_depth = ptr_depth,
-    };
+static void add_struct_fields(type_info_internal* internal, const reflect_mapped_type_t* record, field_info_t* fields) {
+    const reflect_context_t* ctx = internal->context;
+    const reflect_mapped_field_t* blob_field = blob_fields(ctx->loaded_blob) + record->fields;
+    const char* strings = blob_strings(ctx->loaded_blob);
+
+    internal->struct_fields = fields;
+
+    for (uint32_t i = 0; i < record->field_count; i++, blob_field++) {
+        fields[i] = (field_info_t){
+            .name = strings + blob_field->name,
+            .arr_size = blob_field->arr_size,
+            .offset = blob_field->offset,
+            .type_ptr = &ctx->type_table[blob_field->type_id].type,
+            .is_const = blob_field->is_const,
+            .ptr_depth = blob_field->ptr_depth,
+        };
+    }
+}
+
+static void add_enum_fields(type_info_internal* internal, const reflect_mapped_type_t* record, enum_field_info_t* fields) {
+    const reflect_mapped_enum_field_t* blob_field = blob_enum_fields(internal->context->loaded_blob) + record->fields;
+    const char* strings = blob_strings(internal->context->loaded_blob);
 
-    get_internal_from_type_info(struct_type)->struct_fields[struct_type->field_count] = field_info;
+    internal->enum_fields = fields;
 
-    hashtable_insert(&get_internal_from_type_info(struct_type)->field_table, &(hash_t){
-        .name = field_name,
-        .id = struct_type->field_count++
-    });
+    for (uint32_t i = 0; i < record->field_count; i++, blob_field++) {
+        fields[i] = (enum_field_info_t){
+            .name = strings + blob_field->name,
+            .value = blob_field->value
+        };
+    }
+
+    if (record->value_index != 0)
+        internal->value_index = (const reflect_blob_value_index_t*)((const char*)internal->context->loaded_blob + record->value_index);
 }
 
-static void add_enum_field_type(type_info_t* enum_type, const char* field_name, size_t value) {
-    const enum_field_info_t field_info = {
-        .name = field_name,
-        .value = value
+static int compare_enum_values(const void* a, const void* b) {
+    const reflect_blob_enum_value_t* x = a;
+    const reflect_blob_enum_value_t* y = b;
+
+    if (x->value != y->value)
+        return x->value < y->value ? -1 : 1;
+
+    return x->enumerator < y->enumerator ? -1 : x->enumerator > y->enumerator;
+}
+
+// For enums the blob has no value index for (--no-index), a sorted one like merge.py writes for sparse enums
+static void build_value_index(type_info_internal* internal) {
+    const size_t count = internal->type.field_count;
+    reflect_blob_value_index_t* index = arena_alloc(&internal->context->arena,
+                                                    sizeof(reflect_blob_value_index_t) + sizeof(reflect_blob_enum_value_t) * count);
+    reflect_blob_enum_value_t* entries = (reflect_blob_enum_value_t*)(index + 1);
+    size_t unique = 0;
+
+    for (size_t i = 0; i < count; i++)
+        entries[i] = (reflect_blob_enum_value_t){ .value = internal->enum_fields[i].value, .enumerator = i };
+
+    qsort(entries, count, sizeof(reflect_blob_enum_value_t), compare_enum_values);
+
+    // the first declared enumerator of each value sorts first
+    for (size_t i = 0; i < count; i++) {
+        if (unique == 0 || entries[unique - 1].value != entries[i].value)
+            entries[unique++] = entries[i];
+    }
+
+    *index = (reflect_blob_value_index_t){ .kind = REFLECT_BLOB_VALUES_SORTED, .count = unique };
+    internal->value_index = index;
+}
+
+// Only used for blobs merged with --no-index, the space was reserved by reflect_context_load_bytes()
+static void build_field_table(type_info_internal* internal) {
+    if (internal->type.field_count == 0)
+        return;
+
+    const size_t capacity = internal->type.field_count * 2;
+    internal->field_table = hashtable_create_in(capacity, arena_alloc(&internal->context->arena, hashtable_memory_size(capacity)));
+
+    for (size_t i = 0; i < internal->type.field_count; i++) {
+        hashtable_insert(&internal->field_table, &(hash_t){
+            .name = internal->type.variant == Enum ? internal->enum_fields[i].name : internal->struct_fields[i].name,
+            .id = i
+        });
+    }
+}
+
+static void build_fields(type_info_internal* internal) {
+    const reflect_context_t* ctx = internal->context;
+    const reflect_mapped_type_t* record = blob_types(ctx->loaded_blob) + internal->type.id;
+
+    if (record->variant == Struct || record->variant == Union)
+        add_struct_fields(internal, record, ctx->field_storage + record->fields);
+    else if (record->variant == Enum)
+        add_enum_fields(internal, record, ctx->enum_field_storage + record->fields);
+
+    if (internal->field_index == 0 && record->variant != Base)
+        build_field_table(internal);
+
+    if (record->variant == Enum && internal->value_index == NULL)
+        build_value_index(internal);
+}
+
+// Most processes only touch a few of the loaded types, so their fields are materialized on
+// first use instead of at load. The first caller builds them, concurrent callers wait for it.
+static type_info_internal* load_fields(const type_info_t* type_info) {
+    type_info_internal* internal = get_internal_from_type_info(type_info);
+    uint32_t state = __atomic_load_n(&internal->fields_state, __ATOMIC_ACQUIRE);
+
+    if (state == REFLECT_FIELDS_READY)
+        return internal;
+
+    if (state == REFLECT_FIELDS_PENDING &&
+        __atomic_compare_exchange_n(&internal->fields_state, &state, REFLECT_FIELDS_BUILDING, false, __ATOMIC_ACQUIRE, __ATOMIC_ACQUIRE)) {
+        build_fields(internal);
+        __atomic_store_n(&internal->fields_state, REFLECT_FIELDS_READY, __ATOMIC_RELEASE);
+        return internal;
+    }
+
+    while (__atomic_load_n(&internal->fields_state, __ATOMIC_ACQUIRE) != REFLECT_FIELDS_READY)
+        wait_yield();
+
+    return internal;
+}
+
+static void build_type_table(reflect_context_t* ctx, const reflect_blob_header_t* header) {
+    const size_t type_count = header->type_count;
+    const uint32_t* aliases = blob_aliases(header);
+    const char* strings = blob_strings(header);
+
+    const size_t capacity = (type_count + header->alias_count) * 2;
+    ctx->type_hash_table = hashtable_create_in(capacity, arena_alloc(&ctx->arena, hashtable_memory_size(capacity)));
+
+    for (size_t id = 1; id <= type_count; id++) {
+        const reflect_mapped_type_t* record = blob_types(header) + id;
+
+        hashtable_insert(&ctx->type_hash_table, &(hash_t){
+            .name = ctx->type_table[id].type.name,
+            .id = id
+        });
+
+        for (uint32_t j = 0; j < record->alias_count; j++) {
+            hashtable_insert(&ctx->type_hash_table, &(hash_t){
+                .name = strings + aliases[record->aliases + j],
+                .id = id
+            });
+        }
+    }
+}
+
+// The runtime tables of --no-index blobs hash on their own, only the blob indexes use name->hash
+static const type_info_t* find_type(const reflect_context_t* ctx, const reflect_name_t* name) {
+    const reflect_blob_header_t* blob = __atomic_load_n(&ctx->loaded_blob, __ATOMIC_ACQUIRE);
+
+    if (blob == NULL || name->name == NULL)
+        return NULL;
+
+    const size_t id = blob->type_index != 0 ? blob_index_get(blob, blob->type_index, name)
+                                            : hashtable_get(&ctx->type_hash_table, name->name);
+
+    return id == -1 ? NULL : &ctx->type_table[id].type;
+}
+
+static size_t find_field_id(const type_info_internal* internal, const reflect_name_t* field_name) {
+    if (field_name->name == NULL)
+        return -1;
+
+    if (internal->field_index != 0)
+        return blob_index_get(internal->context->loaded_blob, internal->field_index, field_name);
+
+    return hashtable_get(&internal->field_table, field_name->name);
+}
+
+// Plugins running with nested=hierarchical keep embedded structs as a single field referencing
+// their type, the flattened "outer.inner" fields only exist in blobs of the default mode
+static bool is_collapsed_field(const field_info_t* fields, const size_t i, const size_t count) {
+    const field_info_t* field = fields + i;
+    const type_info_t* type = field->type_ptr;
+
+    if (field->ptr_depth != 0 || field->arr_size != 0 || field->name[0] == '\0' || type == NULL || type->id == 0 ||
+        (type->variant != Struct && type->variant != Union) || type->field_count == 0)
+        return false;
+
+    const size_t length = strlen(field->name);
+
+    return i + 1 == count || strncmp(fields[i + 1].name, field->name, length) != 0 || fields[i + 1].name[length] != '.';
+}
+
+static void measure_flat_fields(const type_info_t* type, const size_t prefix_length, size_t* count, size_t* name_bytes) {
+    const field_info_t* fields = load_fields(type)->struct_fields;
+
+    for (size_t i = 0; i < type->field_count; i++) {
+        const size_t length = prefix_length + strlen(fields[i].name);
+
+        *count += 1;
+        *name_bytes += length + 1;
+
+        if (is_collapsed_field(fields, i, type->field_count))
+            measure_flat_fields(fields[i].type_ptr, length + 1, count, name_bytes);
+    }
+}
+
+// Parents come before their members, like the plugin orders flattened fields
+static void fill_flat_fields(const type_info_t* type, const char* prefix, const size_t prefix_length, const size_t base,
+                             reflect_flat_fields_t* flat, char** names) {
+    const field_info_t* fields = load_fields(type)->struct_fields;
+
+    for (size_t i = 0; i < type->field_count; i++) {
+        char* name = *names;
+        const size_t length = strlen(fields[i].name);
+
+        memcpy(name, prefix, prefix_length);
+        memcpy(name + prefix_length, fields[i].name, length + 1);
+        *names += prefix_length + length + 1;
+
+        field_info_t* field = flat->fields + flat->count++;
+        *field = fields[i];
+        field->name = name;
+        field->offset = base + fields[i].offset;
+
+        if (is_collapsed_field(fields, i, type->field_count)) {
+            name[prefix_length + length] = '.';
+            fill_flat_fields(fields[i].type_ptr, name, prefix_length + length + 1, field->offset, flat, names);
+            name[prefix_length + length] = '\0';
+        }
+    }
+}
+
+static void build_flat_fields(type_info_internal* internal) {
+    const type_info_t* type = &internal->type;
+    size_t count = 0, name_bytes = 0;
+
+    if (type->variant == Struct || type->variant == Union)
+        measure_flat_fields(type, 0, &count, &name_bytes);
+
+    // flattened blobs (and hierarchical ones without embedded structs) get a view of the fields they already have,
+    // so does a type whose expanded view can't be allocated
+    internal->flat_fields = (reflect_flat_fields_t){ .fields = internal->struct_fields, .count = type->field_count };
+
+    if (count <= type->field_count)
+        return;
+
+    const size_t capacity = count * 2;
+    const size_t fields_size = sizeof(field_info_t) * count;
+    char* memory = malloc(fields_size + hashtable_memory_size(capacity) + name_bytes);
+
+    if (memory == NULL)
+        return;
+
+    reflect_flat_fields_t flat = {
+        .fields = (field_info_t*)memory,
+        .table = hashtable_create_in(capacity, memory + fields_size),
     };
+    char* names = memory + fields_size + hashtable_memory_size(capacity);
+
+    fill_flat_fields(type, "", 0, 0, &flat, &names);
 
-    get_internal_from_type_info(enum_type)->enum_fields[enum_type->field_count] = field_info;
+    for (size_t i = 0; i < flat.count; i++)
+        hashtable_insert(&flat.table, &(hash_t){ .name = flat.fields[i].name, .id = i });
 
-    hashtable_insert(&get_internal_from_type_info(enum_type)->field_table, &(hash_t){
-        .name = field_name,
-        .id = enum_type->field_count++
-    });
+    internal->flat_fields = flat;
 }
 
-static void add_type_alias(const size_t type_id, const char* alias_name) {
-    hashtable_insert(&type_hash_table, &(hash_t){
-        .name = alias_name,
-        .id = type_id
-    });
+static const reflect_flat_fields_t* load_flat_fields(const type_info_t* type_info) {
+    type_info_internal* internal = load_fields(type_info);
+    uint32_t state = __atomic_load_n(&internal->flat_state, __ATOMIC_ACQUIRE);
+
+    if (state == REFLECT_FIELDS_READY)
+        return &internal->flat_fields;
+
+    if (state == REFLECT_FIELDS_PENDING &&
+        __atomic_compare_exchange_n(&internal->flat_state, &state, REFLECT_FIELDS_BUILDING, false, __ATOMIC_ACQUIRE, __ATOMIC_ACQUIRE)) {
+        build_flat_fields(internal);
+        __atomic_store_n(&internal->flat_state, REFLECT_FIELDS_READY, __ATOMIC_RELEASE);
+        return &internal->flat_fields;
+    }
+
+    while (__atomic_load_n(&internal->flat_state, __ATOMIC_ACQUIRE) != REFLECT_FIELDS_READY)
+        wait_yield();
+
+    return &internal->flat_fields;
 }
 
-// copy - will allocate new strings, recommended if reading yourself from a file so you can free buffer
-void reflect_load_bytes(char* reflection_metadata, bool copy) {
-    if (is_init)
+// Resolves "a.b.c" through referenced embedded structs without building the flat view, the longest
+// prefix naming a field is tried first. Adds the offset of the result from the start of type to *offset.
+static const field_info_t* find_nested_field(const type_info_t* type, const char* name, const size_t length, size_t* offset) {
+    char key[REFLECT_NESTED_NAME_MAX];
+
+    if (length >= sizeof(key))
+        return NULL;
+
+    const type_info_internal* internal = load_fields(type);
+
+    memcpy(key, name, length);
+    key[length] = '\0';
+
+    for (size_t split = length + 1; split-- > 0;) {
+        if (split != length && name[split] != '.')
+            continue;
+
+        key[split] = '\0';
+        const reflect_name_t prefix = reflect_name(key);
+        const size_t id = find_field_id(internal, &prefix);
+
+        if (id == -1)
+            continue;
+
+        const field_info_t* field = internal->struct_fields + id;
+
+        if (split == length) {
+            *offset += field->offset;
+            return field;
+        }
+
+        if (field->ptr_depth != 0 || field->arr_size != 0 || field->type_ptr == NULL ||
+            (field->type_ptr->variant != Struct && field->type_ptr->variant != Union))
+            continue;
+
+        size_t inner_offset = 0;
+        const field_info_t* inner = find_nested_field(field->type_ptr, name + split + 1, length - split - 1, &inner_offset);
+
+        if (inner != NULL) {
+            *offset += field->offset + inner_offset;
+            return inner;
+        }
+    }
+
+    return NULL;
+}
+
+// Everything the loader needs is sized here, then carved out of a single arena
+static size_t loader_memory_size(const reflect_blob_header_t* header, const bool copy) {
+    size_t size = arena_align(sizeof(type_info_internal) * (header->type_count + 1)) +
+                  arena_align(sizeof(field_info_t) * header->field_count) +
+                  arena_align(sizeof(enum_field_info_t) * header->enum_field_count);
+
+    if (copy)
+        size += arena_align(header->size);
+
+    if (header->type_index == 0)
+        size += arena_align(hashtable_memory_size((header->type_count + header->alias_count) * 2));
+
+    for (size_t id = 1; id <= header->type_count; id++) {
+        const reflect_mapped_type_t* record = blob_types(header) + id;
+
+        if (header->type_index == 0 && record->variant != Base && record->field_count != 0)
+            size += arena_align(hashtable_memory_size(record->field_count * 2));
+
+        if (record->variant == Enum && record->value_index == 0)
+            size += arena_align(sizeof(reflect_blob_value_index_t) + sizeof(reflect_blob_enum_value_t) * record->field_count);
+    }
+
+    return size;
+}
+
+reflect_context_t* reflect_context_default() {
+    return &default_context;
+}
+
+reflect_context_t* reflect_context_create() {
+    return calloc(1, sizeof(reflect_context_t));
+}
+
+// The default context can't be destroyed, only unloaded
+void reflect_context_destroy(reflect_context_t* ctx) {
+    if (ctx == NULL || ctx == &default_context)
         return;
 
-    is_init = true;
-    reader_t reader = { .data = reflection_metadata, .offset = 0, .copy = copy };
+    reflect_context_unload(ctx);
+    free(ctx);
+}
 
-    // unused
-    const size_t global_string_volume_offset = read_size_t(&reader);
+// copy - copies the blob, recommended if reading yourself from a file so you can free buffer
+// Safe to call from several threads, one loads and the others return once its tables are published
+void reflect_context_load_bytes(reflect_context_t* ctx, char* reflection_metadata, bool copy) {
+    uint32_t state = REFLECT_LOAD_NONE;
 
-    const size_t type_table_offset = read_size_t(&reader);
-    reader.offset = type_table_offset;
+    if (!__atomic_compare_exchange_n(&ctx->load_state, &state, REFLECT_LOAD_LOADING, false, __ATOMIC_ACQUIRE, __ATOMIC_ACQUIRE)) {
+        while (__atomic_load_n(&ctx->load_state, __ATOMIC_ACQUIRE) == REFLECT_LOAD_LOADING)
+            wait_yield();
+        return;
+    }
 
-    const size_t type_count = read_size_t(&reader);
+    const reflect_blob_header_t* header = (const reflect_blob_header_t*)reflection_metadata;
 
-    type_table = malloc((type_count+1) * sizeof(type_info_internal));
-    type_hash_table = hashtable_create(type_count * 2);
+    if (header == NULL || header->magic != REFLECT_BLOB_MAGIC || header->version != REFLECT_BLOB_VERSION ||
+        !arena_create(&ctx->arena, loader_memory_size(header, copy))) {
+        __atomic_store_n(&ctx->load_state, REFLECT_LOAD_NONE, __ATOMIC_RELEASE);
+        return;
+    }
 
-    for (size_t i = 0; i < type_count; i++) {
-        const size_t id = read_size_t(&reader);
-        const uint8_t variant = read_byte(&reader);
-        const char* name = read_string(&reader);
-        const size_t size = read_size_t(&reader);
+    if (copy) {
+        char* blob_copy = arena_alloc(&ctx->arena, header->size);
+        memcpy(blob_copy, reflection_metadata, header->size);
+        header = (const reflect_blob_header_t*)blob_copy;
+    }
 
-        if (variant == Base) {
-            add_base_type_info(name, id, size);
-        } else {
-            const size_t field_count = read_size_t(&reader);
-
-            if (variant == Struct || variant == Union) {
-                type_info_t* struct_type = add_struct_type_info(name, id, size, variant, field_count);
-
-                for (size_t j = 0; j < field_count; j++) {
-                    const char* field_name = read_string(&reader);
-                    const bool is_const = read_bool(&reader);
-                    const uint32_t ptr_depth = read_uint32_t(&reader);
-                    const size_t offset = read_size_t(&reader);
-                    const size_t field_size = read_size_t(&reader);
-                    const size_t field_type = read_size_t(&reader);
-
-                    add_struct_field_type(struct_type, field_name, field_type, field_size, offset, ptr_depth, is_const);
-                }
-            } else if (variant == Enum) {
-                type_info_t* enum_type = add_enum_type_info(name, id, size, field_count);
-
-                for (size_t j = 0; j < field_count; j++) {
-                    const char* field_name = read_string(&reader);
-                    const size_t value = read_size_t(&reader);
-
-                    add_enum_field_type(enum_type, field_name, value);
-                }
-            }
+    const size_t type_count = header->type_count;
+
+    ctx->type_table = arena_alloc(&ctx->arena, sizeof(type_info_internal) * (type_count + 1));
+
+    // field arrays are filled lazily, pages of unused types are never touched
+    ctx->field_storage = arena_alloc(&ctx->arena, sizeof(field_info_t) * header->field_count);
+    ctx->enum_field_storage = arena_alloc(&ctx->arena, sizeof(enum_field_info_t) * header->enum_field_count);
+
+    const char* strings = blob_strings(header);
+    ctx->type_table[0].type.name = strings;
+    ctx->type_table[0].context = ctx;
+
+    for (size_t id = 1; id <= type_count; id++) {
+        const reflect_mapped_type_t* record = blob_types(header) + id;
+        type_info_internal* internal = &ctx->type_table[id];
+
+        internal->type = (type_info_t){
+            .name = strings + record->name,
+            .id = id,
+            .size = record->size,
+            .field_count = record->field_count,
+            .variant = record->variant
+        };
+        internal->context = ctx;
+        internal->field_index = record->field_index;
+    }
+
+    if (header->type_index == 0)
+        build_type_table(ctx, header);
+
+    __atomic_store_n(&ctx->loaded_blob, header, __ATOMIC_RELEASE);
+    __atomic_store_n(&ctx->load_state, REFLECT_LOAD_READY, __ATOMIC_RELEASE);
+}
+
+// Type infos handed out before (including the ones referenced by reflect_alloc() headers) dangle afterwards.
+// Objects reflect_alloc() took from the pools of its types stay valid, see pool_detach().
+void reflect_context_unload(reflect_context_t* ctx) {
+    if (__atomic_load_n(&ctx->load_state, __ATOMIC_ACQUIRE) != REFLECT_LOAD_READY)
+        return;
+
+    const reflect_blob_header_t* blob = ctx->loaded_blob;
+    __atomic_store_n(&ctx->loaded_blob, NULL, __ATOMIC_RELAXED);
+
+    for (size_t id = 1; id <= blob->type_count; id++) {
+        pool_detach(ctx->type_table[id].pool);
+        if (ctx->type_table[id].flat_fields.table.capacity != 0)
+            free(ctx->type_table[id].flat_fields.fields);
+    }
+
+    arena_destroy(&ctx->arena);
+
+    ctx->type_table = NULL;
+    ctx->type_hash_table = (hashtable_t){ 0 };
+    ctx->field_storage = NULL;
+    ctx->enum_field_storage = NULL;
+    __atomic_store_n(&ctx->load_state, REFLECT_LOAD_NONE, __ATOMIC_RELEASE);
+}
+
+reflect_memory_usage_t reflect_context_memory_usage(const reflect_context_t* ctx) {
+    return (reflect_memory_usage_t){
+        .reserved = ctx->arena.size,
+        .used = ctx->arena.used < ctx->arena.size ? ctx->arena.used : ctx->arena.size
+    };
+}
+
+// Lookups by name in ctx fall back to parent (and its parents) on a miss, nothing is copied.
+// Returns false if parent would close a cycle.
+bool reflect_context_set_parent(reflect_context_t* ctx, reflect_context_t* parent) {
+    for (const reflect_context_t* it = parent; it != NULL; it = it->parent) {
+        if (it == ctx)
+            return false;
+    }
+
+    ctx->parent = parent;
+    return true;
+}
+
+const type_info_t* reflect_ctx_type_info_from_name(const reflect_context_t* ctx, const char* name) {
+    return reflect_ctx_type_info_from_name_h(ctx, reflect_name(name));
+}
+
+const type_info_t* reflect_ctx_type_info_from_name_h(const reflect_context_t* ctx, const reflect_name_t name) {
+    for (; ctx != NULL; ctx = ctx->parent) {
+        const type_info_t* type = find_type(ctx, &name);
+
+        if (type != NULL)
+            return type;
+    }
+
+    return NULL;
+}
+
+// Resolves up to REFLECT_BLOB_BATCH names in ctx alone, with the lookups interleaved
+static void find_types(const reflect_context_t* ctx, const reflect_name_t* names, const size_t count, const type_info_t** out) {
+    const reflect_blob_header_t* blob = __atomic_load_n(&ctx->loaded_blob, __ATOMIC_ACQUIRE);
+    size_t ids[REFLECT_BLOB_BATCH];
+
+    if (blob == NULL || blob->type_index == 0) {
+        for (size_t i = 0; i < count; i++)
+            out[i] = find_type(ctx, &names[i]);
+        return;
+    }
+
+    blob_index_get_batch(blob, blob->type_index, names, count, ids);
+
+    for (size_t i = 0; i < count; i++)
+        out[i] = ids[i] == REFLECT_BLOB_INDEX_MISS ? NULL : &ctx->type_table[ids[i]].type;
+}
+
+// Returns how many names were found, out[i] is NULL for the others
+size_t reflect_ctx_type_info_from_names(const reflect_context_t* ctx, const char** names, const size_t count, const type_info_t** out) {
+    size_t found = 0;
+
+    for (size_t start = 0; start < count; start += REFLECT_BLOB_BATCH) {
+        const size_t n = count - start < REFLECT_BLOB_BATCH ? count - start : REFLECT_BLOB_BATCH;
+        reflect_name_t keys[REFLECT_BLOB_BATCH];
+
+        for (size_t i = 0; i < n; i++)
+            keys[i] = reflect_name(names[start + i]);
 
-            const size_t alias_count = read_size_t(&reader);
+        find_types(ctx, keys, n, out + start);
 
-            for (size_t j = 0; j < alias_count; j++)
-                add_type_alias(id, read_string(&reader));
+        for (size_t i = 0; i < n; i++) {
+            // misses are rare enough to continue through the parents one at a time
+            if (out[start + i] == NULL && ctx->parent != NULL)
+                out[start + i] = reflect_ctx_type_info_from_name_h(ctx->parent, keys[i]);
+
+            found += out[start + i] != NULL;
         }
     }
+
+    return found;
+}
+
+const type_info_t* reflect_ctx_type_info_from_id(const reflect_context_t* ctx, const size_t id) {
+    const reflect_blob_header_t* blob = __atomic_load_n(&ctx->loaded_blob, __ATOMIC_ACQUIRE);
+
+    if (blob == NULL || id == 0 || id > blob->type_count)
+        return NULL;
+
+    return &ctx->type_table[id].type;
+}
+
+void reflect_load_bytes(char* reflection_metadata, bool copy) {
+    reflect_context_load_bytes(&default_context, reflection_metadata, copy);
+}
+
+void reflect_unload() {
+    reflect_context_unload(&default_context);
+}
+
+reflect_memory_usage_t reflect_memory_usage() {
+    return reflect_context_memory_usage(&default_context);
 }
 
 // For linked reflection.dat use
 
 #ifdef __APPLE__
-extern __attribute__((weak)) const char reflection_dat_start[] = "";
+extern __attribute__((weak, aligned(8))) const char reflection_dat_start[sizeof(reflect_blob_header_t)] = "";
 #define REFLECTION_DATA_SYMBOL reflection_dat_start
 #else
-extern __attribute__((weak)) const char _reflection_dat_start[] = "";
+extern __attribute__((weak, aligned(8))) const char _reflection_dat_start[sizeof(reflect_blob_header_t)] = "";
 #define REFLECTION_DATA_SYMBOL _reflection_dat_start
 #endif
 
 void reflect_load() {
-    reflect_load_bytes(REFLECTION_DATA_SYMBOL, false);
+    reflect_load_bytes((char*)REFLECTION_DATA_SYMBOL, false);
+}
+
+reflect_name_t reflect_name(const char* name) {
+    reflect_name_t result = { .name = name, .length = 0, .hash = 0 };
+
+    if (name != NULL)
+        result.hash = hash_fnv1a64(name, &result.length);
+
+    return result;
 }
 
 const type_info_t* reflect_type_info_from_name(const char* name) {
-    const size_t result = hashtable_get(&type_hash_table, name);
+    return reflect_ctx_type_info_from_name_h(&default_context, reflect_name(name));
+}
 
-    if (result == -1)
-        return NULL;
+const type_info_t* reflect_type_info_from_name_h(const reflect_name_t name) {
+    return reflect_ctx_type_info_from_name_h(&default_context, name);
+}
+
+size_t reflect_type_info_from_names(const char** names, const size_t count, const type_info_t** out) {
+    return reflect_ctx_type_info_from_names(&default_context, names, count, out);
+}
 
-    return &type_table[result].type;
+const type_info_t* reflect_type_info_from_id(const size_t id) {
+    return reflect_ctx_type_info_from_id(&default_context, id);
 }
 
 const type_info_t* reflect_get_type_info(const void* ptr) {
     if (ptr == NULL)
         return NULL;
 
+    const pool_span_t* span = pool_map_find(ptr);
+
+    if (span != NULL)
+        return pool_span_type(span, ptr);
+
+#if defined(REFLECT_HEADERLESS)
+    // nothing outside of spans is typed, foreign pointers are never read
+    return NULL;
+#else
     const reflect_type_header_t* header = ((const reflect_type_header_t*)ptr) - 1;
 
     if (header->magic != REFLECT_DYNAMIC_ALLOC_MAGIC)
         return NULL;
 
     return header->type_info_ptr;
+#endif
+}
+
+// The pool of type, NULL if type is too large to pool
+static reflect_pool_t* type_pool(const type_info_t* type) {
+    type_info_internal* internal = get_internal_from_type_info(type);
+    reflect_pool_t* pool = __atomic_load_n(&internal->pool, __ATOMIC_ACQUIRE);
+
+    if (pool != NULL || type->size > POOL_MAX_OBJECT)
+        return pool;
+
+    reflect_pool_t* created = pool_adopt(type);
+
+    if (created == NULL && (created = reflect_pool_create(type)) == NULL)
+        return NULL;
+
+    if (!__atomic_compare_exchange_n(&internal->pool, &pool, created, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+        pool_detach(created);
+        return pool;
+    }
+
+    return created;
 }
 
+// Without an allocator objects come from the pool of their type and have no header. Those outlive an unload
+// of the context of type like malloc'd ones, but have no type until a type of the same name and size is
+// loaded again.
+// With REFLECT_HEADERLESS every object comes from a span and the allocator is ignored, types too large
+// to pool get a span of their own.
 void* reflect_alloc(const type_info_t* type, void* allocator, void*(*alloc)(void*, size_t)) {
     if (type == NULL)
         return NULL;
 
+#if defined(REFLECT_HEADERLESS)
+    (void)allocator;
+    (void)alloc;
+
+    reflect_pool_t* pool = type_pool(type);
+    return pool != NULL ? reflect_pool_alloc(pool) : reflect_alloc_array(type, 1);
+#else
+    reflect_pool_t* pool = alloc == NULL ? type_pool(type) : NULL;
+
+    if (pool != NULL)
+        return reflect_pool_alloc(pool);
+
     reflect_type_header_t* allocated = NULL;
 
     if (alloc == NULL)
@@ -241,12 +761,29 @@ void* reflect_alloc(const type_info_t* type, void* allocator, void*(*alloc)(void
     allocated->type_info_ptr = type;
 
     return allocated + 1;
+#endif
 }
 
+// Also frees pooled objects and arrays from reflect_alloc_array(), allocator and free_func are ignored for those.
+// Arena elements are left to their arena.
 void reflect_free(void* ptr, void* allocator, void (*free_func)(void*, void*)) {
     if (ptr == NULL)
         return;
 
+    pool_span_t* span = pool_map_find(ptr);
+
+    if (span != NULL) {
+        if (span->kind == POOL_SPAN_SLAB && pool_span_holds(span, ptr))
+            reflect_pool_free(span->pool, ptr);
+        else if (span->kind == POOL_SPAN_ARRAY && ptr == span->objects)
+            pool_span_destroy(span);
+        return;
+    }
+
+#if defined(REFLECT_HEADERLESS)
+    (void)allocator;
+    (void)free_func;
+#else
     reflect_type_header_t* header = ((reflect_type_header_t*)ptr) - 1;
 
     if (header->magic != REFLECT_DYNAMIC_ALLOC_MAGIC)
@@ -256,77 +793,178 @@ void reflect_free(void* ptr, void* allocator, void (*free_func)(void*, void*)) {
         free(header);
     else
         free_func(allocator, header);
+#endif
+}
+
+// Only reached on a miss, names without a dot never pay for it
+static void* find_nested_field_ptr(void* struct_ptr, const reflect_name_t* field_name, const type_info_t* type_info) {
+    size_t offset = 0;
+
+    if (field_name->name == NULL || strchr(field_name->name, '.') == NULL)
+        return NULL;
+
+    if (find_nested_field(type_info, field_name->name, strlen(field_name->name), &offset) == NULL)
+        return NULL;
+
+    return (char*)struct_ptr + offset;
 }
 
 void* reflect_get_field_manual(void* struct_ptr, const char* field_name, const type_info_t* type_info) {
+    return reflect_get_field_manual_h(struct_ptr, reflect_name(field_name), type_info);
+}
+
+void* reflect_get_field_manual_h(void* struct_ptr, const reflect_name_t field_name, const type_info_t* type_info) {
     if (struct_ptr == NULL || type_info == NULL)
         return NULL;
 
-    const size_t id = hashtable_get(&get_internal_from_type_info(type_info)->field_table, field_name);
+    const type_info_internal* internal = load_fields(type_info);
+    const size_t id = find_field_id(internal, &field_name);
 
     if (id == -1)
-        return NULL;
+        return find_nested_field_ptr(struct_ptr, &field_name, type_info);
 
-    const field_info_t* field_info = get_internal_from_type_info(type_info)->struct_fields + id;
+    const field_info_t* field_info = internal->struct_fields + id;
 
     return struct_ptr + field_info->offset;
 }
 
 void* reflect_get_field(void* struct_ptr, const char* field_name) {
+    return reflect_get_field_h(struct_ptr, reflect_name(field_name));
+}
+
+void* reflect_get_field_h(void* struct_ptr, const reflect_name_t field_name) {
     const type_info_t* struct_type = reflect_get_type_info(struct_ptr);
 
     if (struct_type == NULL)
         return NULL;
 
-    const size_t id = hashtable_get(&get_internal_from_type_info(struct_type)->field_table, field_name);
+    const type_info_internal* internal = load_fields(struct_type);
+    const size_t id = find_field_id(internal, &field_name);
 
     if (id == -1)
-        return NULL;
+        return find_nested_field_ptr(struct_ptr, &field_name, struct_type);
 
-    const field_info_t* field_info = get_internal_from_type_info(struct_type)->struct_fields + id;
+    const field_info_t* field_info = internal->struct_fields + id;
 
     return struct_ptr + field_info->offset;
 }
 
+// The returned field has to carry its offset from the start of type, so dotted misses go to the flat view
+static const field_info_t* find_flat_field(const type_info_t* type, const reflect_name_t* field_name) {
+    if (field_name->name == NULL || strchr(field_name->name, '.') == NULL)
+        return NULL;
+
+    const reflect_flat_fields_t* flat = load_flat_fields(type);
+
+    if (flat->table.capacity == 0)
+        return NULL;
+
+    const size_t id = hashtable_get(&flat->table, field_name->name);
+
+    return id == -1 ? NULL : flat->fields + id;
+}
+
 const field_info_t* reflect_get_field_type(const type_info_t* type, const char* field_name) {
+    return reflect_get_field_type_h(type, reflect_name(field_name));
+}
+
+const field_info_t* reflect_get_field_type_h(const type_info_t* type, const reflect_name_t field_name) {
     if (type == NULL)
         return NULL;
 
-    const size_t id = hashtable_get(&get_internal_from_type_info(type)->field_table, field_name);
+    const type_info_internal* internal = load_fields(type);
+    const size_t id = find_field_id(internal, &field_name);
 
     if (id == -1)
-        return NULL;
+        return find_flat_field(type, &field_name);
+
+    return internal->struct_fields + id;
+}
+
+// Returns how many fields were found, out[i] is NULL for the others
+size_t reflect_get_field_types(const type_info_t* type, const char** field_names, const size_t count, const field_info_t** out) {
+    size_t found = 0;
+
+    if (type == NULL) {
+        for (size_t i = 0; i < count; i++)
+            out[i] = NULL;
+        return 0;
+    }
+
+    const type_info_internal* internal = load_fields(type);
+
+    for (size_t start = 0; start < count; start += REFLECT_BLOB_BATCH) {
+        const size_t n = count - start < REFLECT_BLOB_BATCH ? count - start : REFLECT_BLOB_BATCH;
+        reflect_name_t keys[REFLECT_BLOB_BATCH];
+        size_t ids[REFLECT_BLOB_BATCH];
 
-    return get_internal_from_type_info(type)->struct_fields + id;
+        for (size_t i = 0; i < n; i++)
+            keys[i] = reflect_name(field_names[start + i]);
+
+        if (internal->field_index != 0) {
+            blob_index_get_batch(internal->context->loaded_blob, internal->field_index, keys, n, ids);
+        } else {
+            for (size_t i = 0; i < n; i++)
+                ids[i] = find_field_id(internal, &keys[i]);
+        }
+
+        for (size_t i = 0; i < n; i++) {
+            out[start + i] = ids[i] == (size_t)-1 ? find_flat_field(type, &keys[i]) : internal->struct_fields + ids[i];
+            found += out[start + i] != NULL;
+        }
+    }
+
+    return found;
 }
 
 field_info_t* reflect_field_info_iter_begin(const type_info_t* type_info) {
     if (type_info == NULL)
         return NULL;
 
-    return get_internal_from_type_info(type_info)->struct_fields;
+    return load_fields(type_info)->struct_fields;
 }
 
 field_info_t* reflect_field_info_iter_end(const type_info_t* type_info) {
     if (type_info == NULL)
         return NULL;
 
-    return get_internal_from_type_info(type_info)->struct_fields + type_info->field_count;
+    return load_fields(type_info)->struct_fields + type_info->field_count;
+}
+
+field_info_t* reflect_field_info_flat_begin(const type_info_t* type_info) {
+    if (type_info == NULL)
+        return NULL;
+
+    return load_flat_fields(type_info)->fields;
+}
+
+field_info_t* reflect_field_info_flat_end(const type_info_t* type_info) {
+    if (type_info == NULL)
+        return NULL;
+
+    const reflect_flat_fields_t* flat = load_flat_fields(type_info);
+
+    return flat->fields + flat->count;
+}
+
+const int64_t *reflect_get_enum_value(const type_info_t *enum_type, const char *field_name) {
+    return reflect_get_enum_value_h(enum_type, reflect_name(field_name));
 }
 
-const size_t *reflect_get_enum_value(const type_info_t *enum_type, const char *field_name) {
+const int64_t *reflect_get_enum_value_h(const type_info_t *enum_type, const reflect_name_t field_name) {
     if (enum_type == NULL)
         return NULL;
 
     if (enum_type->variant != Enum)
         return NULL;
 
-    const size_t id = hashtable_get(&get_internal_from_type_info(enum_type)->field_table, field_name);
+    const type_info_internal* internal = load_fields(enum_type);
+    const size_t id = find_field_id(internal, &field_name);
 
     if (id == -1)
         return NULL;
 
-    const enum_field_info_t* result = get_internal_from_type_info(enum_type)->enum_fields + id;
+    const enum_field_info_t* result = internal->enum_fields + id;
 
     return &result->value;
 }
@@ -336,7 +974,7 @@ enum_field_info_t* reflect_enum_info_iter_begin(const type_info_t* enum_type) {
         return NULL;
     }
 
-    return get_internal_from_type_info(enum_type)->enum_fields;
+    return load_fields(enum_type)->enum_fields;
 }
 
 enum_field_info_t* reflect_enum_info_iter_end(const type_info_t* enum_type) {
@@ -344,10 +982,170 @@ enum_field_info_t* reflect_enum_info_iter_end(const type_info_t* enum_type) {
         return NULL;
     }
 
-    return get_internal_from_type_info(enum_type)->enum_fields + enum_type->field_count;
+    return load_fields(enum_type)->enum_fields + enum_type->field_count;
+}
+
+const char* reflect_enum_name_from_value(const type_info_t* enum_type, const int64_t value) {
+    if (enum_type == NULL || enum_type->variant != Enum)
+        return NULL;
+
+    const type_info_internal* internal = load_fields(enum_type);
+    const size_t id = blob_value_index_get(internal->value_index, value);
+
+    return id == REFLECT_BLOB_INDEX_MISS ? NULL : internal->enum_fields[id].name;
+}
+
+// Greedy from the largest enumerator down, the way flag enums are usually printed (A | B | C)
+size_t reflect_enum_decompose_flags(const type_info_t* enum_type, const int64_t value, const char** names, const size_t capacity, int64_t* remainder) {
+    uint64_t left = (uint64_t)value;
+    size_t count = 0;
+
+    if (enum_type != NULL && enum_type->variant == Enum && capacity > 0) {
+        const type_info_internal* internal = load_fields(enum_type);
+        const size_t exact = blob_value_index_get(internal->value_index, value);
+
+        if (exact != REFLECT_BLOB_INDEX_MISS) {
+            names[count++] = internal->enum_fields[exact].name;
+            left = 0;
+        }
+
+        // ranks are in value order, also for dense indexes
+        for (size_t rank = internal->value_index->count; rank-- > 0 && left != 0 && count < capacity;) {
+            const size_t id = blob_value_index_at(internal->value_index, rank);
+
+            if (id == REFLECT_BLOB_INDEX_MISS)
+                continue;
+
+            const uint64_t bits = (uint64_t)internal->enum_fields[id].value;
+
+            if (bits != 0 && (left & bits) == bits) {
+                names[count++] = internal->enum_fields[id].name;
+                left &= ~bits;
+            }
+        }
+    }
+
+    if (remainder != NULL)
+        *remainder = (int64_t)left;
+
+    return count;
+}
+
+bool reflect_load_mapped(const void* data, const size_t size) {
+    if (!blob_validate(data, size))
+        return false;
+
+    // lookups go through the prebuilt indexes, a blob merged with --no-index can't be mapped
+    if (((const reflect_blob_header_t*)data)->type_index == 0)
+        return false;
+
+    __atomic_store_n(&mapped_blob, (const reflect_blob_header_t*)data, __ATOMIC_RELEASE);
+    return true;
+}
+
+const char* reflect_mapped_string(const uint32_t offset) {
+    const reflect_blob_header_t* blob = __atomic_load_n(&mapped_blob, __ATOMIC_ACQUIRE);
+
+    if (blob == NULL || offset >= blob->strings_size)
+        return NULL;
+
+    return blob_strings(blob) + offset;
+}
+
+const reflect_mapped_type_t* reflect_mapped_type_from_name(const char* name) {
+    const reflect_blob_header_t* blob = __atomic_load_n(&mapped_blob, __ATOMIC_ACQUIRE);
+
+    if (blob == NULL || name == NULL)
+        return NULL;
+
+    const reflect_name_t key = reflect_name(name);
+    const size_t id = blob_index_get(blob, blob->type_index, &key);
+
+    if (id == REFLECT_BLOB_INDEX_MISS)
+        return NULL;
+
+    return blob_types(blob) + id;
+}
+
+const reflect_mapped_type_t* reflect_mapped_type_from_id(const size_t id) {
+    const reflect_blob_header_t* blob = __atomic_load_n(&mapped_blob, __ATOMIC_ACQUIRE);
+
+    if (blob == NULL || id == 0 || id > blob->type_count)
+        return NULL;
+
+    return blob_types(blob) + id;
+}
+
+const reflect_mapped_field_t* reflect_mapped_get_field_type(const reflect_mapped_type_t* type, const char* field_name) {
+    if (type == NULL || field_name == NULL || type->field_index == 0)
+        return NULL;
+
+    if (type->variant != Struct && type->variant != Union)
+        return NULL;
+
+    const reflect_name_t key = reflect_name(field_name);
+    const size_t id = blob_index_get(mapped_blob, type->field_index, &key);
+
+    if (id == REFLECT_BLOB_INDEX_MISS)
+        return NULL;
+
+    return blob_fields(mapped_blob) + type->fields + id;
+}
+
+const reflect_mapped_field_t* reflect_mapped_field_iter_begin(const reflect_mapped_type_t* type) {
+    if (type == NULL || (type->variant != Struct && type->variant != Union))
+        return NULL;
+
+    return blob_fields(mapped_blob) + type->fields;
+}
+
+const reflect_mapped_field_t* reflect_mapped_field_iter_end(const reflect_mapped_type_t* type) {
+    if (type == NULL || (type->variant != Struct && type->variant != Union))
+        return NULL;
+
+    return blob_fields(mapped_blob) + type->fields + type->field_count;
+}
+
+const int64_t* reflect_mapped_get_enum_value(const reflect_mapped_type_t* enum_type, const char* field_name) {
+    if (enum_type == NULL || field_name == NULL || enum_type->variant != Enum || enum_type->field_index == 0)
+        return NULL;
+
+    const reflect_name_t key = reflect_name(field_name);
+    const size_t id = blob_index_get(mapped_blob, enum_type->field_index, &key);
+
+    if (id == REFLECT_BLOB_INDEX_MISS)
+        return NULL;
+
+    return &blob_enum_fields(mapped_blob)[enum_type->fields + id].value;
+}
+
+const reflect_mapped_enum_field_t* reflect_mapped_enum_iter_begin(const reflect_mapped_type_t* enum_type) {
+    if (enum_type == NULL || enum_type->variant != Enum)
+        return NULL;
+
+    return blob_enum_fields(mapped_blob) + enum_type->fields;
+}
+
+const reflect_mapped_enum_field_t* reflect_mapped_enum_iter_end(const reflect_mapped_type_t* enum_type) {
+    if (enum_type == NULL || enum_type->variant != Enum)
+        return NULL;
+
+    return blob_enum_fields(mapped_blob) + enum_type->fields + enum_type->field_count;
+}
+
+const reflect_mapped_enum_field_t* reflect_mapped_enum_field_from_value(const reflect_mapped_type_t* enum_type, const int64_t value) {
+    if (enum_type == NULL || enum_type->variant != Enum || enum_type->value_index == 0)
+        return NULL;
+
+    const size_t id = blob_value_index_get((const reflect_blob_value_index_t*)((const char*)mapped_blob + enum_type->value_index), value);
+
+    if (id == REFLECT_BLOB_INDEX_MISS)
+        return NULL;
+
+    return blob_enum_fields(mapped_blob) + enum_type->fields + id;
 }
 
 /* WebAssembly hotreloading by copying state */
 void* reflect_hotreload_get_state_ptr() {
-    return &type_table;
+    return &default_context;
 }
\ No newline at end of file
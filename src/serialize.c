@@ -0,0 +1,839 @@
+#include "reflect.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+// A plan is a list of programs, one per type reachable from the root type (by value or through
+// pointers), each a run of ops over one value of its type. Program 0 is the root.
+// PLAN_COPY ops are the padding-free runs of a value, so equality and hashing can walk them directly.
+// Stream layout per op:
+//   PLAN_COPY     size bytes from offset
+//   PLAN_EMBED    count values of an embedded struct, each through its own program
+//   PLAN_POINTER  count pointer slots, each a presence byte and (if present) the pointee,
+//                 where a pointee of a pointer with ptr_depth > 1 is again a pointer slot
+
+#define PLAN_NONE UINT32_MAX // pointee that is not followed, always written as absent
+
+typedef enum {
+    PLAN_COPY,
+    PLAN_EMBED,
+    PLAN_POINTER,
+} plan_op_kind_t;
+
+typedef enum {
+    PLAN_TARGET_NONE,
+    PLAN_TARGET_VALUE,  // one value through program
+    PLAN_TARGET_STRING, // NUL terminated, written as an uint64_t length and the characters
+} plan_target_t;
+
+typedef struct {
+    plan_op_kind_t kind;
+    plan_target_t target;
+    uint32_t program;
+    uint32_t ptr_depth;
+    size_t offset;
+    size_t size;  // bytes for PLAN_COPY, element size for PLAN_EMBED
+    size_t count; // elements for PLAN_EMBED and PLAN_POINTER
+} plan_op_t;
+
+typedef struct {
+    const type_info_t* type;
+    size_t first_op;
+    size_t op_count;
+    bool pod; // no pointers, a value is plain bytes and can be copied whole
+} plan_program_t;
+
+struct reflect_plan {
+    size_t program_count;
+    plan_program_t* programs;
+    plan_op_t* ops;
+};
+
+typedef struct {
+    plan_program_t* programs;
+    size_t program_count;
+    size_t program_capacity;
+    plan_op_t* ops;
+    size_t op_count;
+    size_t op_capacity;
+} plan_builder_t;
+
+typedef struct {
+    size_t begin;
+    size_t end;
+} plan_range_t;
+
+static bool grow(void** array, size_t* capacity, const size_t needed, const size_t element_size) {
+    if (needed <= *capacity)
+        return true;
+
+    const size_t new_capacity = needed > *capacity * 2 ? needed : *capacity * 2;
+    void* grown = realloc(*array, new_capacity * element_size);
+
+    if (grown == NULL)
+        return false;
+
+    *array = grown;
+    *capacity = new_capacity;
+    return true;
+}
+
+static bool push_op(plan_builder_t* builder, const plan_op_t op) {
+    if (!grow((void**)&builder->ops, &builder->op_capacity, builder->op_count + 1, sizeof(plan_op_t)))
+        return false;
+
+    builder->ops[builder->op_count++] = op;
+    return true;
+}
+
+static int compare_ranges(const void* a, const void* b) {
+    const plan_range_t* left = a;
+    const plan_range_t* right = b;
+    return left->begin < right->begin ? -1 : left->begin > right->begin;
+}
+
+// Embedded structs also show up flattened ("nest.x"), the flattened fields are used instead
+static bool has_flattened_children(const type_info_t* type, const field_info_t* field) {
+    const size_t length = strlen(field->name);
+
+    if (length == 0)
+        return true;
+
+    for (const field_info_t* it = reflect_field_info_iter_begin(type); it != reflect_field_info_iter_end(type); ++it) {
+        if (strncmp(it->name, field->name, length) == 0 && it->name[length] == '.')
+            return true;
+    }
+
+    return false;
+}
+
+static bool is_leaf(const type_info_t* type, const field_info_t* field) {
+    const bool embedded = field->ptr_depth == 0 && field->arr_size == 0 && field->type_ptr != NULL &&
+                          (field->type_ptr->id == 0 || field->type_ptr->variant == Struct || field->type_ptr->variant == Union);
+
+    return !embedded || !has_flattened_children(type, field);
+}
+
+static size_t leaf_size(const field_info_t* field) {
+    const size_t element = field->ptr_depth > 0 ? sizeof(void*) : field->type_ptr->size;
+    return element * (field->arr_size > 0 ? field->arr_size : 1);
+}
+
+// Pointers sharing bytes with another field are members of a union, those are copied as they are
+static bool overlaps_other_leaf(const type_info_t* type, const field_info_t* field) {
+    const size_t end = field->offset + leaf_size(field);
+
+    for (const field_info_t* it = reflect_field_info_iter_begin(type); it != reflect_field_info_iter_end(type); ++it) {
+        if (it == field || it->type_ptr == NULL || !is_leaf(type, it))
+            continue;
+
+        if (it->offset < end && field->offset < it->offset + leaf_size(it))
+            return true;
+    }
+
+    return false;
+}
+
+static uint32_t compile_program(plan_builder_t* builder, const type_info_t* type);
+
+static bool is_string(const type_info_t* type) {
+    return type->variant == Base && type->size == 1 && strcmp(type->name, "char") == 0;
+}
+
+// Compiles the ops of one struct, PLAN_COPY runs first in offset order, then everything that needs
+// more than a copy in field order. Returns false for layouts a plan can't be made for.
+static bool compile_struct(plan_builder_t* builder, const type_info_t* type, plan_op_t** deferred, size_t* deferred_count,
+                           plan_range_t** ranges, size_t* range_count) {
+    size_t deferred_capacity = 0, range_capacity = 0;
+
+    for (const field_info_t* it = reflect_field_info_iter_begin(type); it != reflect_field_info_iter_end(type); ++it) {
+        if (!is_leaf(type, it))
+            continue;
+
+        // unknown types (id 0) have no size, nothing about them can be copied
+        if (it->type_ptr == NULL || (it->ptr_depth == 0 && (it->type_ptr->id == 0 || it->type_ptr->size == 0)))
+            return false;
+
+        const size_t size = leaf_size(it);
+        if (it->offset + size > type->size)
+            return false;
+
+        plan_op_t op = { .offset = it->offset, .count = it->arr_size > 0 ? it->arr_size : 1 };
+
+        if (it->ptr_depth > 0 && !overlaps_other_leaf(type, it)) {
+            op.kind = PLAN_POINTER;
+            op.ptr_depth = it->ptr_depth;
+            op.program = PLAN_NONE;
+            op.target = PLAN_TARGET_NONE;
+
+            if (it->ptr_depth == 1 && is_string(it->type_ptr)) {
+                op.target = PLAN_TARGET_STRING;
+            } else if (it->type_ptr->id != 0 && it->type_ptr->size > 0) {
+                op.program = compile_program(builder, it->type_ptr);
+                if (op.program == PLAN_NONE)
+                    return false;
+
+                op.target = PLAN_TARGET_VALUE;
+            }
+        } else if (it->ptr_depth == 0 && it->type_ptr->variant == Struct) {
+            op.program = compile_program(builder, it->type_ptr);
+            if (op.program == PLAN_NONE)
+                return false;
+
+            op.kind = PLAN_EMBED;
+            op.size = it->type_ptr->size;
+        } else {
+            op.kind = PLAN_COPY;
+        }
+
+        if (op.kind == PLAN_COPY) {
+            if (!grow((void**)ranges, &range_capacity, *range_count + 1, sizeof(plan_range_t)))
+                return false;
+
+            (*ranges)[(*range_count)++] = (plan_range_t){ it->offset, it->offset + size };
+        } else if (op.kind == PLAN_EMBED && builder->programs[op.program].pod) {
+            // the runs of the embedded struct, so its padding stays out as well
+            const plan_program_t* embedded = &builder->programs[op.program];
+
+            if (!grow((void**)ranges, &range_capacity, *range_count + op.count * embedded->op_count, sizeof(plan_range_t)))
+                return false;
+
+            for (size_t element = 0; element < op.count; element++) {
+                for (size_t i = 0; i < embedded->op_count; i++) {
+                    const plan_op_t* run = &builder->ops[embedded->first_op + i];
+                    const size_t begin = op.offset + element * op.size + run->offset;
+                    (*ranges)[(*range_count)++] = (plan_range_t){ begin, begin + run->size };
+                }
+            }
+        } else {
+            if (!grow((void**)deferred, &deferred_capacity, *deferred_count + 1, sizeof(plan_op_t)))
+                return false;
+
+            (*deferred)[(*deferred_count)++] = op;
+        }
+    }
+
+    return true;
+}
+
+// Returns the program index of type, compiling it first if it is new. PLAN_NONE on failure.
+static uint32_t compile_program(plan_builder_t* builder, const type_info_t* type) {
+    for (size_t i = 0; i < builder->program_count; i++) {
+        if (builder->programs[i].type == type)
+            return i;
+    }
+
+    if (!grow((void**)&builder->programs, &builder->program_capacity, builder->program_count + 1, sizeof(plan_program_t)))
+        return PLAN_NONE;
+
+    // registered before the fields are compiled, so pointers back to this type find it. Not POD until its
+    // ops are known, structs embedding it meanwhile (through a pointer cycle) run it as PLAN_EMBED.
+    const uint32_t index = builder->program_count++;
+    builder->programs[index] = (plan_program_t){ .type = type, .pod = false };
+
+    plan_op_t* deferred = NULL;
+    plan_range_t* ranges = NULL;
+    size_t deferred_count = 0, range_count = 0;
+    bool ok = true;
+
+    // unions are raw bytes, which of their members is valid isn't known
+    if (type->variant == Struct) {
+        ok = compile_struct(builder, type, &deferred, &deferred_count, &ranges, &range_count);
+    } else {
+        ranges = malloc(sizeof(plan_range_t));
+        ok = ranges != NULL;
+        if (ok)
+            ranges[range_count++] = (plan_range_t){ 0, type->size };
+    }
+
+    // nested programs were appended while compiling, this program's ops come after them
+    const size_t first_op = builder->op_count;
+
+    if (ok) {
+        // coalesce adjacent and overlapping fields, gaps between them are padding
+        qsort(ranges, range_count, sizeof(plan_range_t), compare_ranges);
+
+        for (size_t i = 0; ok && i < range_count;) {
+            plan_range_t run = ranges[i++];
+
+            while (i < range_count && ranges[i].begin <= run.end) {
+                if (ranges[i].end > run.end)
+                    run.end = ranges[i].end;
+                i++;
+            }
+
+            ok = push_op(builder, (plan_op_t){ .kind = PLAN_COPY, .offset = run.begin, .size = run.end - run.begin });
+        }
+
+        for (size_t i = 0; ok && i < deferred_count; i++)
+            ok = push_op(builder, deferred[i]);
+    }
+
+    free(deferred);
+    free(ranges);
+
+    if (!ok)
+        return PLAN_NONE;
+
+    builder->programs[index].first_op = first_op;
+    builder->programs[index].op_count = builder->op_count - first_op;
+    builder->programs[index].pod = deferred_count == 0;
+
+    return index;
+}
+
+// NULL for types that aren't structs, unions, enums or base types with a size, or whose fields lie outside of it
+reflect_plan_t* reflect_plan_compile(const type_info_t* type) {
+    if (type == NULL || type->id == 0 || type->size == 0)
+        return NULL;
+
+    plan_builder_t builder = { 0 };
+    reflect_plan_t* plan = malloc(sizeof(reflect_plan_t));
+
+    if (plan == NULL || compile_program(&builder, type) == PLAN_NONE) {
+        free(builder.programs);
+        free(builder.ops);
+        free(plan);
+        return NULL;
+    }
+
+    *plan = (reflect_plan_t){
+        .program_count = builder.program_count,
+        .programs = builder.programs,
+        .ops = builder.ops,
+    };
+
+    return plan;
+}
+
+void reflect_plan_free(reflect_plan_t* plan) {
+    if (plan == NULL)
+        return;
+
+    free(plan->programs);
+    free(plan->ops);
+    free(plan);
+}
+
+// Writes stop at the first value that doesn't fit, size keeps counting so callers learn the full size
+typedef struct {
+    char* pos;
+    size_t left;
+    size_t size;
+} plan_writer_t;
+
+typedef struct {
+    const char* pos;
+    size_t left;
+} plan_reader_t;
+
+static void put(plan_writer_t* writer, const void* data, const size_t size) {
+    writer->size += size;
+
+    if (size > writer->left) {
+        writer->left = 0;
+        return;
+    }
+
+    memcpy(writer->pos, data, size);
+    writer->pos += size;
+    writer->left -= size;
+}
+
+static bool take(plan_reader_t* reader, void* data, const size_t size) {
+    if (size > reader->left)
+        return false;
+
+    memcpy(data, reader->pos, size);
+    reader->pos += size;
+    reader->left -= size;
+    return true;
+}
+
+static void serialize_program(const reflect_plan_t* plan, uint32_t program, const char* src, plan_writer_t* writer);
+
+static void serialize_slot(const reflect_plan_t* plan, const plan_op_t* op, const char* value, const uint32_t ptr_depth, plan_writer_t* writer) {
+    const uint8_t present = value != NULL && op->target != PLAN_TARGET_NONE;
+    put(writer, &present, 1);
+
+    if (!present)
+        return;
+
+    if (ptr_depth > 1) {
+        serialize_slot(plan, op, *(const char* const*)value, ptr_depth - 1, writer);
+    } else if (op->target == PLAN_TARGET_STRING) {
+        const uint64_t length = strlen(value);
+        put(writer, &length, sizeof(length));
+        put(writer, value, length);
+    } else {
+        serialize_program(plan, op->program, value, writer);
+    }
+}
+
+static void serialize_program(const reflect_plan_t* plan, const uint32_t program, const char* src, plan_writer_t* writer) {
+    // POD values are a single copy, skip the interpreter
+    if (plan->programs[program].pod) {
+        put(writer, src, plan->programs[program].type->size);
+        return;
+    }
+
+    const plan_op_t* op = plan->ops + plan->programs[program].first_op;
+    const plan_op_t* end = op + plan->programs[program].op_count;
+
+    for (; op != end; op++) {
+        switch (op->kind) {
+        case PLAN_COPY:
+            put(writer, src + op->offset, op->size);
+            break;
+        case PLAN_EMBED:
+            for (size_t i = 0; i < op->count; i++)
+                serialize_program(plan, op->program, src + op->offset + i * op->size, writer);
+            break;
+        case PLAN_POINTER:
+            for (size_t i = 0; i < op->count; i++)
+                serialize_slot(plan, op, ((const char* const*)(src + op->offset))[i], op->ptr_depth, writer);
+            break;
+        }
+    }
+}
+
+// Serializes the value at ptr into buf and returns the size of the serialized value. Like snprintf,
+// a result larger than buf_size means buf was too small, call again with a buffer of the returned size.
+size_t reflect_plan_serialize(const reflect_plan_t* plan, const void* ptr, void* buf, const size_t buf_size) {
+    if (plan == NULL || ptr == NULL)
+        return 0;
+
+    plan_writer_t writer = { .pos = buf, .left = buf == NULL ? 0 : buf_size };
+
+    serialize_program(plan, 0, ptr, &writer);
+    return writer.size;
+}
+
+// Sets every pointer followed by program to NULL, so a failed deserialize can release what it got to
+static void clear_pointers(const reflect_plan_t* plan, const uint32_t program, char* dst) {
+    const plan_op_t* op = plan->ops + plan->programs[program].first_op;
+    const plan_op_t* end = op + plan->programs[program].op_count;
+
+    for (; op != end; op++) {
+        if (op->kind == PLAN_EMBED) {
+            for (size_t i = 0; i < op->count; i++)
+                clear_pointers(plan, op->program, dst + op->offset + i * op->size);
+        } else if (op->kind == PLAN_POINTER && op->target != PLAN_TARGET_NONE) {
+            for (size_t i = 0; i < op->count; i++)
+                ((void**)(dst + op->offset))[i] = NULL;
+        }
+    }
+}
+
+static bool deserialize_program(const reflect_plan_t* plan, uint32_t program, char* dst, plan_reader_t* reader);
+
+static bool deserialize_slot(const reflect_plan_t* plan, const plan_op_t* op, void** slot, const uint32_t ptr_depth, plan_reader_t* reader) {
+    uint8_t present = 0;
+
+    if (!take(reader, &present, 1) || present > 1 || (present && op->target == PLAN_TARGET_NONE))
+        return false;
+
+    if (!present) {
+        *slot = NULL;
+        return true;
+    }
+
+    if (ptr_depth > 1) {
+        void** pointer = malloc(sizeof(void*));
+
+        if (pointer == NULL)
+            return false;
+
+        *pointer = NULL;
+        *slot = pointer;
+        return deserialize_slot(plan, op, pointer, ptr_depth - 1, reader);
+    }
+
+    if (op->target == PLAN_TARGET_STRING) {
+        uint64_t length = 0;
+
+        if (!take(reader, &length, sizeof(length)) || length > reader->left)
+            return false;
+
+        char* string = malloc(length + 1);
+
+        if (string == NULL)
+            return false;
+
+        take(reader, string, length);
+        string[length] = 0;
+        *slot = string;
+        return true;
+    }
+
+    const plan_program_t* pointee = &plan->programs[op->program];
+    char* value = malloc(pointee->type->size);
+
+    if (value == NULL)
+        return false;
+
+    clear_pointers(plan, op->program, value);
+    *slot = value;
+    return deserialize_program(plan, op->program, value, reader);
+}
+
+static bool deserialize_program(const reflect_plan_t* plan, const uint32_t program, char* dst, plan_reader_t* reader) {
+    if (plan->programs[program].pod)
+        return take(reader, dst, plan->programs[program].type->size);
+
+    const plan_op_t* op = plan->ops + plan->programs[program].first_op;
+    const plan_op_t* end = op + plan->programs[program].op_count;
+
+    for (; op != end; op++) {
+        switch (op->kind) {
+        case PLAN_COPY:
+            if (!take(reader, dst + op->offset, op->size))
+                return false;
+            break;
+        case PLAN_EMBED:
+            for (size_t i = 0; i < op->count; i++) {
+                if (!deserialize_program(plan, op->program, dst + op->offset + i * op->size, reader))
+                    return false;
+            }
+            break;
+        case PLAN_POINTER:
+            for (size_t i = 0; i < op->count; i++) {
+                if (!deserialize_slot(plan, op, (void**)(dst + op->offset) + i, op->ptr_depth, reader))
+                    return false;
+            }
+            break;
+        }
+    }
+
+    return true;
+}
+
+static void release_program(const reflect_plan_t* plan, uint32_t program, char* ptr);
+
+static void release_slot(const reflect_plan_t* plan, const plan_op_t* op, void* value, const uint32_t ptr_depth) {
+    if (value == NULL)
+        return;
+
+    if (ptr_depth > 1)
+        release_slot(plan, op, *(void**)value, ptr_depth - 1);
+    else if (op->target == PLAN_TARGET_VALUE)
+        release_program(plan, op->program, value);
+
+    free(value);
+}
+
+static void release_program(const reflect_plan_t* plan, const uint32_t program, char* ptr) {
+    const plan_op_t* op = plan->ops + plan->programs[program].first_op;
+    const plan_op_t* end = op + plan->programs[program].op_count;
+
+    for (; op != end; op++) {
+        if (op->kind == PLAN_EMBED) {
+            for (size_t i = 0; i < op->count; i++)
+                release_program(plan, op->program, ptr + op->offset + i * op->size);
+        } else if (op->kind == PLAN_POINTER && op->target != PLAN_TARGET_NONE) {
+            for (size_t i = 0; i < op->count; i++)
+                release_slot(plan, op, ((void**)(ptr + op->offset))[i], op->ptr_depth);
+        }
+    }
+}
+
+// Reads one value from buf into ptr and returns the bytes consumed, 0 if buf is truncated or malformed.
+// Pointees are allocated with malloc, reflect_plan_release() frees them again.
+size_t reflect_plan_deserialize(const reflect_plan_t* plan, void* ptr, const void* buf, const size_t buf_size) {
+    if (plan == NULL || ptr == NULL || buf == NULL)
+        return 0;
+
+    plan_reader_t reader = { .pos = buf, .left = buf_size };
+
+    clear_pointers(plan, 0, ptr);
+
+    if (!deserialize_program(plan, 0, ptr, &reader)) {
+        release_program(plan, 0, ptr);
+        clear_pointers(plan, 0, ptr);
+        return 0;
+    }
+
+    return buf_size - reader.left;
+}
+
+// Frees the pointees reflect_plan_deserialize() allocated for ptr, not ptr itself
+void reflect_plan_release(const reflect_plan_t* plan, void* ptr) {
+    if (plan == NULL || ptr == NULL)
+        return;
+
+    release_program(plan, 0, ptr);
+}
+
+static bool copy_program(const reflect_plan_t* plan, uint32_t program, char* dst, const char* src);
+
+static bool copy_slot(const reflect_plan_t* plan, const plan_op_t* op, void** slot, const void* value, const uint32_t ptr_depth) {
+    if (value == NULL) {
+        *slot = NULL;
+        return true;
+    }
+
+    if (ptr_depth > 1) {
+        void** pointer = malloc(sizeof(void*));
+
+        if (pointer == NULL)
+            return false;
+
+        *pointer = NULL;
+        *slot = pointer;
+        return copy_slot(plan, op, pointer, *(void* const*)value, ptr_depth - 1);
+    }
+
+    if (op->target == PLAN_TARGET_STRING) {
+        const size_t size = strlen(value) + 1;
+        char* string = malloc(size);
+
+        if (string == NULL)
+            return false;
+
+        memcpy(string, value, size);
+        *slot = string;
+        return true;
+    }
+
+    const plan_program_t* pointee = &plan->programs[op->program];
+    char* copy = malloc(pointee->type->size);
+
+    if (copy == NULL)
+        return false;
+
+    memcpy(copy, value, pointee->type->size);
+    clear_pointers(plan, op->program, copy);
+    *slot = copy;
+    return copy_program(plan, op->program, copy, value);
+}
+
+// dst already holds the bytes of src with its followed pointers cleared
+static bool copy_program(const reflect_plan_t* plan, const uint32_t program, char* dst, const char* src) {
+    if (plan->programs[program].pod)
+        return true;
+
+    const plan_op_t* op = plan->ops + plan->programs[program].first_op;
+    const plan_op_t* end = op + plan->programs[program].op_count;
+
+    for (; op != end; op++) {
+        if (op->kind == PLAN_EMBED) {
+            for (size_t i = 0; i < op->count; i++) {
+                if (!copy_program(plan, op->program, dst + op->offset + i * op->size, src + op->offset + i * op->size))
+                    return false;
+            }
+        } else if (op->kind == PLAN_POINTER && op->target != PLAN_TARGET_NONE) {
+            for (size_t i = 0; i < op->count; i++) {
+                if (!copy_slot(plan, op, (void**)(dst + op->offset) + i, ((const void* const*)(src + op->offset))[i], op->ptr_depth))
+                    return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+// Copies src to dst, with REFLECT_DEEP the pointees are duplicated with malloc as well (free them
+// with reflect_plan_release()). Returns false if an allocation failed, dst holds no pointees then.
+bool reflect_plan_copy(const reflect_plan_t* plan, void* dst, const void* src, const uint32_t flags) {
+    if (plan == NULL || dst == NULL || src == NULL)
+        return false;
+
+    if (dst != src)
+        memcpy(dst, src, plan->programs[0].type->size);
+
+    if (!(flags & REFLECT_DEEP) || plan->programs[0].pod)
+        return true;
+
+    clear_pointers(plan, 0, dst);
+
+    if (!copy_program(plan, 0, dst, src)) {
+        release_program(plan, 0, dst);
+        clear_pointers(plan, 0, dst);
+        return false;
+    }
+
+    return true;
+}
+
+static bool equal_program(const reflect_plan_t* plan, uint32_t program, const char* a, const char* b, bool deep);
+
+static bool equal_slot(const reflect_plan_t* plan, const plan_op_t* op, const void* a, const void* b, const uint32_t ptr_depth) {
+    if (a == b)
+        return true;
+
+    if (a == NULL || b == NULL)
+        return false;
+
+    if (ptr_depth > 1)
+        return equal_slot(plan, op, *(const void* const*)a, *(const void* const*)b, ptr_depth - 1);
+
+    if (op->target == PLAN_TARGET_STRING)
+        return strcmp(a, b) == 0;
+
+    return equal_program(plan, op->program, a, b, true);
+}
+
+static bool equal_program(const reflect_plan_t* plan, const uint32_t program, const char* a, const char* b, const bool deep) {
+    const plan_op_t* op = plan->ops + plan->programs[program].first_op;
+    const plan_op_t* end = op + plan->programs[program].op_count;
+
+    for (; op != end; op++) {
+        switch (op->kind) {
+        case PLAN_COPY:
+            if (memcmp(a + op->offset, b + op->offset, op->size) != 0)
+                return false;
+            break;
+        case PLAN_EMBED:
+            for (size_t i = 0; i < op->count; i++) {
+                if (!equal_program(plan, op->program, a + op->offset + i * op->size, b + op->offset + i * op->size, deep))
+                    return false;
+            }
+            break;
+        case PLAN_POINTER:
+            for (size_t i = 0; i < op->count; i++) {
+                const void* left = ((const void* const*)(a + op->offset))[i];
+                const void* right = ((const void* const*)(b + op->offset))[i];
+
+                if (!deep || op->target == PLAN_TARGET_NONE ? left != right : !equal_slot(plan, op, left, right, op->ptr_depth))
+                    return false;
+            }
+            break;
+        }
+    }
+
+    return true;
+}
+
+// Compares the fields of a and b bytewise, padding excluded. Pointers are compared by address, with
+// REFLECT_DEEP by their pointees instead.
+bool reflect_plan_equal(const reflect_plan_t* plan, const void* a, const void* b, const uint32_t flags) {
+    if (plan == NULL || a == NULL || b == NULL)
+        return false;
+
+    return a == b || equal_program(plan, 0, a, b, flags & REFLECT_DEEP);
+}
+
+// 64 bit block hash, mixes 8 bytes at a time (murmur3 style)
+static uint64_t hash_word(uint64_t hash, uint64_t word) {
+    word *= 0x87c37b91114253d5ull;
+    word = (word << 31) | (word >> 33);
+    word *= 0x4cf5ad432745937full;
+    hash ^= word;
+    hash = (hash << 27) | (hash >> 37);
+    return hash * 5 + 0x52dce729;
+}
+
+static uint64_t hash_bytes(uint64_t hash, const char* data, size_t size) {
+    for (; size >= sizeof(uint64_t); data += sizeof(uint64_t), size -= sizeof(uint64_t)) {
+        uint64_t word;
+        memcpy(&word, data, sizeof(word));
+        hash = hash_word(hash, word);
+    }
+
+    if (size > 0) {
+        uint64_t word = 0;
+        memcpy(&word, data, size);
+        hash = hash_word(hash, word);
+    }
+
+    return hash;
+}
+
+static uint64_t hash_program(const reflect_plan_t* plan, uint32_t program, const char* ptr, uint64_t hash, bool deep);
+
+static uint64_t hash_slot(const reflect_plan_t* plan, const plan_op_t* op, const void* value, const uint32_t ptr_depth, uint64_t hash) {
+    hash = hash_word(hash, value != NULL);
+
+    if (value == NULL)
+        return hash;
+
+    if (ptr_depth > 1)
+        return hash_slot(plan, op, *(const void* const*)value, ptr_depth - 1, hash);
+
+    if (op->target == PLAN_TARGET_STRING) {
+        const size_t length = strlen(value);
+        return hash_bytes(hash_word(hash, length), value, length);
+    }
+
+    return hash_program(plan, op->program, value, hash, true);
+}
+
+static uint64_t hash_program(const reflect_plan_t* plan, const uint32_t program, const char* ptr, uint64_t hash, const bool deep) {
+    const plan_op_t* op = plan->ops + plan->programs[program].first_op;
+    const plan_op_t* end = op + plan->programs[program].op_count;
+
+    for (; op != end; op++) {
+        switch (op->kind) {
+        case PLAN_COPY:
+            hash = hash_bytes(hash, ptr + op->offset, op->size);
+            break;
+        case PLAN_EMBED:
+            for (size_t i = 0; i < op->count; i++)
+                hash = hash_program(plan, op->program, ptr + op->offset + i * op->size, hash, deep);
+            break;
+        case PLAN_POINTER:
+            if (!deep || op->target == PLAN_TARGET_NONE) {
+                hash = hash_bytes(hash, ptr + op->offset, op->count * sizeof(void*));
+                break;
+            }
+
+            for (size_t i = 0; i < op->count; i++)
+                hash = hash_slot(plan, op, ((const void* const*)(ptr + op->offset))[i], op->ptr_depth, hash);
+            break;
+        }
+    }
+
+    return hash;
+}
+
+// Hash consistent with reflect_plan_equal() for the same flags
+uint64_t reflect_plan_hash(const reflect_plan_t* plan, const void* ptr, const uint32_t flags) {
+    if (plan == NULL || ptr == NULL)
+        return 0;
+
+    uint64_t hash = hash_program(plan, 0, ptr, plan->programs[0].type->size, flags & REFLECT_DEEP);
+
+    // fmix64, spreads the last blocks over all bits
+    hash ^= hash >> 33;
+    hash *= 0xff51afd7ed558ccdull;
+    hash ^= hash >> 33;
+    hash *= 0xc4ceb9fe1a85ec53ull;
+    hash ^= hash >> 33;
+    return hash;
+}
+
+// One shot versions, these compile a plan every call
+size_t reflect_serialize(const void* ptr, const type_info_t* type, void* buf, const size_t buf_size) {
+    reflect_plan_t* plan = reflect_plan_compile(type);
+    const size_t size = reflect_plan_serialize(plan, ptr, buf, buf_size);
+    reflect_plan_free(plan);
+    return size;
+}
+
+size_t reflect_deserialize(void* ptr, const type_info_t* type, const void* buf, const size_t buf_size) {
+    reflect_plan_t* plan = reflect_plan_compile(type);
+    const size_t size = reflect_plan_deserialize(plan, ptr, buf, buf_size);
+    reflect_plan_free(plan);
+    return size;
+}
+
+bool reflect_copy(void* dst, const void* src, const type_info_t* type, const uint32_t flags) {
+    reflect_plan_t* plan = reflect_plan_compile(type);
+    const bool copied = reflect_plan_copy(plan, dst, src, flags);
+    reflect_plan_free(plan);
+    return copied;
+}
+
+bool reflect_equal(const void* a, const void* b, const type_info_t* type, const uint32_t flags) {
+    reflect_plan_t* plan = reflect_plan_compile(type);
+    const bool equal = reflect_plan_equal(plan, a, b, flags);
+    reflect_plan_free(plan);
+    return equal;
+}
+
+uint64_t reflect_hash(const void* ptr, const type_info_t* type, const uint32_t flags) {
+    reflect_plan_t* plan = reflect_plan_compile(type);
+    const uint64_t hash = reflect_plan_hash(plan, ptr, flags);
+    reflect_plan_free(plan);
+    return hash;
+}
@@ -0,0 +1,188 @@
+#include "reflect.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+// Structure of arrays built from the field list of a type. Every column is one contiguous,
+// 64 byte aligned array and all of them share a single allocation.
+
+#define SOA_ALIGNMENT 64
+
+static size_t soa_align(const size_t size) {
+    return (size + SOA_ALIGNMENT - 1) & ~(size_t)(SOA_ALIGNMENT - 1);
+}
+
+static size_t element_size(const field_info_t* field) {
+    return field->ptr_depth > 0 ? sizeof(void*) : field->type_ptr->size;
+}
+
+// Embedded structs also show up flattened ("nest.x"), those children become the columns. The flat view
+// has them for blobs of nested=hierarchical too.
+static bool has_flattened_children(const type_info_t* type, const field_info_t* field) {
+    const size_t length = strlen(field->name);
+
+    if (length == 0)
+        return true; // anonymous members are always flattened
+
+    for (const field_info_t* it = reflect_field_info_flat_begin(type); it != reflect_field_info_flat_end(type); ++it) {
+        if (strncmp(it->name, field->name, length) == 0 && it->name[length] == '.')
+            return true;
+    }
+
+    return false;
+}
+
+static bool is_embedded(const field_info_t* field, const reflect_obj_type_t variant) {
+    return field->type_ptr != NULL && field->ptr_depth == 0 && field->arr_size == 0 && field->type_ptr->variant == variant;
+}
+
+// Members of an embedded union follow it in the flat view and start within its bytes, struct fields never overlap otherwise
+static bool is_union_member(const type_info_t* type, const field_info_t* field) {
+    for (const field_info_t* it = reflect_field_info_flat_begin(type); it != field; ++it) {
+        if (is_embedded(it, Union) && field->offset >= it->offset && field->offset < it->offset + it->type_ptr->size)
+            return true;
+    }
+
+    return false;
+}
+
+static bool is_column(const type_info_t* type, const field_info_t* field) {
+    if (field->type_ptr == NULL || element_size(field) == 0 || is_union_member(type, field))
+        return false;
+
+    // members of a union overlap, an embedded union is one column of its own size like a top level one
+    if (is_embedded(field, Union))
+        return true;
+
+    return !is_embedded(field, Struct) || !has_flattened_children(type, field);
+}
+
+// Returns the column count of type, and describes them in columns unless it is NULL
+static size_t soa_columns(const type_info_t* type, const uint32_t flags, reflect_soa_column_t* columns) {
+    size_t count = 0;
+
+    // members of a union overlap, the union is kept as a single column of its own size
+    if (type->variant == Union) {
+        if (columns != NULL) {
+            columns[0] = (reflect_soa_column_t){
+                .size = type->size,
+                .layout = { .name = type->name, .type_ptr = type },
+            };
+        }
+        return 1;
+    }
+
+    for (const field_info_t* it = reflect_field_info_flat_begin(type); it != reflect_field_info_flat_end(type); ++it) {
+        if (!is_column(type, it))
+            continue;
+
+        const bool explode = (flags & REFLECT_SOA_EXPLODE_ARRAYS) != 0 && it->arr_size > 0;
+        const size_t elements = explode ? it->arr_size : 1;
+
+        for (size_t element = 0; element < elements; element++, count++) {
+            if (columns == NULL)
+                continue;
+
+            field_info_t layout = *it;
+            if (explode) {
+                layout.offset += element * element_size(it);
+                layout.arr_size = 0;
+            }
+
+            columns[count] = (reflect_soa_column_t){
+                .field = it,
+                .element = element,
+                .size = explode ? element_size(it) : element_size(it) * (it->arr_size > 0 ? it->arr_size : 1),
+                .layout = layout,
+            };
+        }
+    }
+
+    return count;
+}
+
+reflect_soa_t* reflect_soa_create(const type_info_t* type, const size_t count, const uint32_t flags) {
+    if (type == NULL || (type->variant != Struct && type->variant != Union))
+        return NULL;
+
+    const size_t column_count = soa_columns(type, flags, NULL);
+    reflect_soa_t* soa = malloc(sizeof(reflect_soa_t) + column_count * sizeof(reflect_soa_column_t));
+
+    if (soa == NULL)
+        return NULL;
+
+    *soa = (reflect_soa_t){
+        .type = type,
+        .count = count,
+        .column_count = column_count,
+        .columns = (reflect_soa_column_t*)(soa + 1),
+    };
+    soa_columns(type, flags, soa->columns);
+
+    size_t total = 0;
+    for (size_t i = 0; i < column_count; i++)
+        total += soa_align(soa->columns[i].size * count);
+
+    // over allocate by the alignment instead of relying on aligned_alloc, this is C99
+    soa->block = malloc(total + SOA_ALIGNMENT);
+
+    if (soa->block == NULL) {
+        free(soa);
+        return NULL;
+    }
+
+    char* data = (char*)soa_align((uintptr_t)soa->block);
+    for (size_t i = 0; i < column_count; i++) {
+        soa->columns[i].data = data;
+        data += soa_align(soa->columns[i].size * count);
+    }
+
+    return soa;
+}
+
+reflect_soa_t* reflect_soa_from_aos(const type_info_t* type, const void* base, const size_t count, const uint32_t flags) {
+    if (base == NULL)
+        return NULL;
+
+    reflect_soa_t* soa = reflect_soa_create(type, count, flags);
+
+    if (soa == NULL)
+        return NULL;
+
+    for (size_t i = 0; i < soa->column_count; i++)
+        reflect_gather(type, &soa->columns[i].layout, base, count, 0, soa->columns[i].data);
+
+    return soa;
+}
+
+// Writes all rows back into soa->count structs at base, padding bytes are left untouched
+void reflect_soa_to_aos(const reflect_soa_t* soa, void* base) {
+    if (soa == NULL || base == NULL)
+        return;
+
+    for (size_t i = 0; i < soa->column_count; i++)
+        reflect_scatter(soa->type, &soa->columns[i].layout, base, soa->count, 0, soa->columns[i].data);
+}
+
+// element picks the array element of exploded array fields, 0 otherwise
+const reflect_soa_column_t* reflect_soa_column(const reflect_soa_t* soa, const char* field_name, const size_t element) {
+    if (soa == NULL || field_name == NULL)
+        return NULL;
+
+    for (size_t i = 0; i < soa->column_count; i++) {
+        const reflect_soa_column_t* column = &soa->columns[i];
+
+        if (column->element == element && strcmp(column->layout.name, field_name) == 0)
+            return column;
+    }
+
+    return NULL;
+}
+
+void reflect_soa_free(reflect_soa_t* soa) {
+    if (soa == NULL)
+        return;
+
+    free(soa->block);
+    free(soa);
+}
@@ -0,0 +1,27 @@
+#include <stdio.h>
+#include <assert.h>
+#include <reflect.h>
+
+// generated by merge.py next to reflection.dat, so this file is compiled after the merge
+#include "reflect_generated.h"
+
+void test_generated() {
+    const type_info_t* struct_info = reflect_type_info_from_name("struct_test_t");
+
+    assert(REFLECT_TYPE(struct_test_t) == struct_info);
+    assert(REFLECT_TYPE_ID(struct_test_t) == struct_info->id);
+    assert(REFLECT_SIZE_struct_test_t == struct_info->size);
+    assert(REFLECT_TYPE(unsigned_int) == reflect_type_info_from_name("unsigned int"));
+    assert(reflect_type_info_from_id(0) == NULL);
+    assert(reflect_type_info_from_id(REFLECT_GENERATED_TYPE_COUNT + 1) == NULL);
+
+    void* obj = reflect_alloc(struct_info, NULL, NULL);
+
+    assert(REFLECT_FIELD_INFO(struct_test_t, b) == reflect_get_field_type(struct_info, "b"));
+    assert(REFLECT_FIELD_OFFSET(struct_test_t, b) == reflect_get_field_type(struct_info, "b")->offset);
+    assert(REFLECT_FIELD_PTR(obj, struct_test_t, e) == reflect_get_field(obj, "e"));
+
+    reflect_free(obj, NULL, NULL);
+
+    printf("✅ test_generated passed!\n");
+}
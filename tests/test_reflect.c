@@ -2,8 +2,13 @@
 #include <stdlib.h>
 #include <string.h>
 #include <assert.h>
+#include <stddef.h>
 #include <reflect.h>
 
+#if !defined(_WIN32)
+#include <pthread.h>
+#endif
+
 typedef enum {
     ENUM_ONE = 1,
     ENUM_TWO = 2,
@@ -63,12 +68,74 @@ typedef struct {
     int c;
 } anon_test_t;
 
+typedef struct {
+    struct_2d_t* inner;
+    struct_test_t items[4];
+} path_test_t;
+
+typedef struct serialize_test_t serialize_test_t;
+
+struct serialize_test_t {
+    const char* name;
+    serialize_test_t* next;
+    char tag;
+    int values[3];
+    path_test_t* path;
+    union_test_t u;
+};
+
+// mutually recursive through a pointer, tree_test_t is embedded by value in tree_list_test_t
+typedef struct tree_list_test_t tree_list_test_t;
+
+typedef struct {
+    tree_list_test_t* kids;
+    int v;
+} tree_test_t;
+
+struct tree_list_test_t {
+    tree_test_t items[2];
+};
+
+typedef enum {
+    STATUS_ERROR = -100,
+    STATUS_FAILED = -1,
+    STATUS_OK = 0,
+    STATUS_SUCCESS = 0,
+    STATUS_DONE = 1000000
+} status_enum_t;
+
+typedef enum {
+    FLAG_NONE = 0,
+    FLAG_READ = 1,
+    FLAG_WRITE = 2,
+    FLAG_EXEC = 4, // out of value order, decomposing still goes by value
+    FLAG_READ_WRITE = 3
+} flags_enum_t;
+
+typedef struct {
+    status_enum_t status;
+    flags_enum_t flags;
+} enum_lookup_test_t;
+
+typedef union {
+    char* s;
+    int i;
+} variant_value_t;
+
+typedef struct {
+    int kind; // 0 for i, 1 for s
+    variant_value_t value;
+} variant_test_t;
+
 /* We reference them in code so the linker won't discard them. */
 static struct_test_t    global_test_s;
 static struct_2d_t      global_2d_struct;
 static union_test_t     global_u;
 static reflect_typedef_alias_test reflect_type_alias;
 static anon_test_t anon_test_s;
+static path_test_t path_test_s;
+static serialize_test_t serialize_test_s;
+static enum_lookup_test_t enum_lookup_test_s;
 
 void test_type_info() {
     const type_info_t* int_type = reflect_type_info_from_name("int");
@@ -97,12 +164,162 @@ void test_alloc_free() {
     printf("✅ test_alloc_free passed!\n");
 }
 
+static void* test_alloc_callback(void* allocator, size_t size) {
+    (void)allocator;
+    return malloc(size);
+}
+
+static void test_free_callback(void* allocator, void* ptr) {
+    (void)allocator;
+    free(ptr);
+}
+
+#if !defined(_WIN32)
+static void* test_pool_thread(void* pool) {
+    void* object = reflect_pool_alloc(pool);
+    reflect_pool_free(pool, object);
+    return object;
+}
+
+// runs after the pool cache of its thread was flushed (glibc runs destructors in key order)
+static void test_pool_late_destructor(void* pool) {
+    reflect_pool_free(pool, reflect_pool_alloc(pool));
+}
+
+static pthread_key_t test_pool_late_key;
+
+static void* test_pool_late_thread(void* pool) {
+    pthread_setspecific(test_pool_late_key, pool);
+    return test_pool_thread(pool);
+}
+#endif
+
+void test_pools() {
+    const type_info_t* struct_info = reflect_type_info_from_name("struct_test_t");
+    reflect_pool_t* pool = reflect_pool_create(struct_info);
+    assert(pool != NULL);
+
+    // more than one slab, every object knows its type
+    struct_test_t* objects[5000];
+    for (int i = 0; i < 5000; i++) {
+        objects[i] = reflect_pool_alloc(pool);
+        assert(objects[i] != NULL && reflect_get_type_info(objects[i]) == struct_info);
+        objects[i]->a = i;
+    }
+    for (int i = 0; i < 5000; i++)
+        assert(objects[i]->a == i);
+    assert(reflect_get_type_info((char*)objects[1] + 1) == NULL);
+
+    for (int i = 0; i < 5000; i++)
+        reflect_pool_free(pool, objects[i]);
+
+    // freed slots are handed out again
+    struct_test_t* reused = reflect_pool_alloc(pool);
+    assert(reused == objects[4999]);
+    reflect_pool_free(pool, reused);
+    reflect_pool_destroy(pool);
+
+    // pools in the same cache set take turns without losing slots
+    reflect_pool_t* pools[17];
+    for (int i = 0; i < 17; i++)
+        pools[i] = reflect_pool_create(struct_info);
+    for (int i = 0; i < 1000; i++) {
+        reflect_pool_t* turn = pools[i % 2 == 0 ? 0 : 16];
+        void* object = reflect_pool_alloc(turn);
+        assert(object != NULL);
+        reflect_pool_free(turn, object);
+        assert(reflect_pool_alloc(turn) == object);
+        reflect_pool_free(turn, object);
+    }
+    for (int i = 0; i < 17; i++)
+        reflect_pool_destroy(pools[i]);
+
+#if !defined(_WIN32)
+    // an exiting thread hands its cached slots back
+    pool = reflect_pool_create(struct_info);
+    pthread_t thread;
+    void* cached = NULL;
+    assert(pthread_create(&thread, NULL, test_pool_thread, pool) == 0);
+    assert(pthread_join(thread, &cached) == 0);
+    bool returned = false;
+    for (int i = 0; i < 32; i++)
+        returned |= reflect_pool_alloc(pool) == cached;
+    assert(returned);
+
+    // pools used by a later thread local destructor still work
+    assert(pthread_key_create(&test_pool_late_key, test_pool_late_destructor) == 0);
+    assert(pthread_create(&thread, NULL, test_pool_late_thread, pool) == 0);
+    assert(pthread_join(thread, NULL) == 0);
+    pthread_key_delete(test_pool_late_key);
+    reflect_pool_destroy(pool);
+#endif
+
+    // one header for the whole array, every element resolves
+    struct_test_t* array = reflect_alloc_array(struct_info, 1000);
+    assert(array != NULL);
+    assert(reflect_get_type_info(array) == struct_info && reflect_get_type_info(&array[999]) == struct_info);
+    assert(reflect_get_type_info(&array[500].b) == NULL);
+    array[999].b = 7;
+    assert(*(int*)reflect_get_field(&array[999], "b") == 7);
+    reflect_free(array, NULL, NULL);
+
+    // reflect_alloc pools, an allocator still gets a header
+    struct_test_t* pooled = reflect_alloc(struct_info, NULL, NULL);
+    assert(reflect_get_type_info(pooled) == struct_info);
+    reflect_free(pooled, NULL, NULL);
+
+    struct_test_t* headed = reflect_alloc(struct_info, NULL, test_alloc_callback);
+    assert(reflect_get_type_info(headed) == struct_info);
+    reflect_free(headed, NULL, test_free_callback);
+
+    assert(reflect_pool_create(NULL) == NULL);
+    assert(reflect_alloc_array(struct_info, 0) == NULL);
+
+    printf("✅ test_pools passed!\n");
+}
+
+void test_arenas() {
+    const type_info_t* struct_info = reflect_type_info_from_name("struct_test_t");
+    reflect_arena_t* arena = reflect_arena_create(struct_info);
+    assert(arena != NULL);
+
+    // singles and runs across several chunks, no space between them
+    struct_test_t* first = reflect_arena_alloc(arena, 1);
+    struct_test_t* second = reflect_arena_alloc(arena, 1);
+    assert(second == first + 1);
+
+    struct_test_t* run = NULL;
+    for (int i = 0; i < 1000; i++) {
+        run = reflect_arena_alloc(arena, 10);
+        assert(run != NULL && reflect_get_type_info(run) == struct_info && reflect_get_type_info(&run[9]) == struct_info);
+    }
+    struct_test_t* large = reflect_arena_alloc(arena, 100000);
+    assert(reflect_get_type_info(&large[99999]) == struct_info);
+    assert(reflect_get_type_info(&large[5].b) == NULL);
+
+    // arena elements are only freed with the arena
+    run->a = 5;
+    reflect_free(run, NULL, NULL);
+    assert(run->a == 5 && reflect_get_type_info(run) == struct_info);
+
+    reflect_arena_destroy(arena);
+    assert(reflect_arena_create(NULL) == NULL);
+
+#if defined(REFLECT_HEADERLESS)
+    // foreign and released pointers are never read
+    struct_test_t local;
+    assert(reflect_get_type_info(&local) == NULL && reflect_get_type_info(run) == NULL);
+#endif
+
+    printf("✅ test_arenas passed!\n");
+}
+
 void test_enum_reflection() {
     const type_info_t* enum_info = reflect_type_info_from_name("enum_test_t");
     assert(enum_info != NULL);
     assert(enum_info->variant == Enum);
 
-    const size_t* value = reflect_get_enum_value(enum_info, "ENUM_ONE");
+    const int64_t* value = reflect_get_enum_value(enum_info, "ENUM_ONE");
     assert(value != NULL);
     assert(*value == 1);
 
@@ -187,10 +404,10 @@ void test_new_enum_reflection() {
     assert(enum_info != NULL);
     assert(enum_info->variant == Enum);
 
-    const size_t* valA = reflect_get_enum_value(enum_info, "NEW_ENUM_A");
+    const int64_t* valA = reflect_get_enum_value(enum_info, "NEW_ENUM_A");
     assert(valA != NULL && *valA == 10);
 
-    const size_t* valB = reflect_get_enum_value(enum_info, "NEW_ENUM_B");
+    const int64_t* valB = reflect_get_enum_value(enum_info, "NEW_ENUM_B");
     assert(valB != NULL && *valB == 20);
 
     printf("✅ test_new_enum_reflection passed!\n");
@@ -206,7 +423,7 @@ void test_enum_field_iteration() {
 
     size_t count_found = 0;
     for (; it != end; ++it) {
-        printf(" enum_test_t enumerator: %s => %zu\n", it->name, it->value);
+        printf(" enum_test_t enumerator: %s => %lld\n", it->name, (long long)it->value);
         if (strcmp(it->name, "ENUM_ONE") == 0) {
             assert(it->value == 1);
         }
@@ -224,6 +441,49 @@ void test_enum_field_iteration() {
     printf("✅ test_enum_field_iteration passed!\n");
 }
 
+void test_enum_names() {
+    const type_info_t* status = reflect_type_info_from_name("status_enum_t");
+    const type_info_t* flags = reflect_type_info_from_name("flags_enum_t");
+    assert(status != NULL && flags != NULL);
+
+    // sparse, negative and duplicate values
+    assert(*reflect_get_enum_value(status, "STATUS_ERROR") == -100);
+    assert(strcmp(reflect_enum_name_from_value(status, -100), "STATUS_ERROR") == 0);
+    assert(strcmp(reflect_enum_name_from_value(status, -1), "STATUS_FAILED") == 0);
+    assert(strcmp(reflect_enum_name_from_value(status, 0), "STATUS_OK") == 0);
+    assert(strcmp(reflect_enum_name_from_value(status, 1000000), "STATUS_DONE") == 0);
+    assert(reflect_enum_name_from_value(status, 1) == NULL);
+    assert(reflect_enum_name_from_value(status, -101) == NULL);
+    assert(reflect_enum_name_from_value(status, INT64_MIN) == NULL);
+
+    // dense
+    assert(strcmp(reflect_enum_name_from_value(flags, 2), "FLAG_WRITE") == 0);
+    assert(reflect_enum_name_from_value(flags, 5) == NULL);
+    assert(reflect_enum_name_from_value(flags, -1) == NULL);
+    assert(reflect_enum_name_from_value(reflect_type_info_from_name("struct_test_t"), 0) == NULL);
+
+    const char* names[4];
+    int64_t remainder = -1;
+
+    assert(reflect_enum_decompose_flags(flags, FLAG_READ_WRITE, names, 4, &remainder) == 1);
+    assert(strcmp(names[0], "FLAG_READ_WRITE") == 0 && remainder == 0);
+
+    assert(reflect_enum_decompose_flags(flags, FLAG_EXEC | FLAG_READ | 8, names, 4, &remainder) == 2);
+    assert(strcmp(names[0], "FLAG_EXEC") == 0 && strcmp(names[1], "FLAG_READ") == 0 && remainder == 8);
+
+    assert(reflect_enum_decompose_flags(flags, 7, names, 4, &remainder) == 2);
+    assert(strcmp(names[0], "FLAG_EXEC") == 0 && strcmp(names[1], "FLAG_READ_WRITE") == 0 && remainder == 0);
+
+    assert(reflect_enum_decompose_flags(flags, 0, names, 4, &remainder) == 1);
+    assert(strcmp(names[0], "FLAG_NONE") == 0 && remainder == 0);
+
+    // names that don't fit leave their bits in remainder
+    assert(reflect_enum_decompose_flags(flags, 7, names, 1, &remainder) == 1);
+    assert(strcmp(names[0], "FLAG_EXEC") == 0 && remainder == 3);
+
+    printf("✅ test_enum_names passed!\n");
+}
+
 void test_union_reflection() {
     const type_info_t* union_info = reflect_type_info_from_name("union_test_t");
     assert(union_info != NULL);
@@ -308,11 +568,801 @@ void test_anon() {
     printf("✅ test_anon passed!\n");
 }
 
+#ifdef __APPLE__
+extern const char reflection_dat_start[];
+extern const char reflection_dat_end[];
+#define REFLECTION_DATA_START reflection_dat_start
+#define REFLECTION_DATA_END reflection_dat_end
+#else
+extern const char _reflection_dat_start[];
+extern const char _reflection_dat_end[];
+#define REFLECTION_DATA_START _reflection_dat_start
+#define REFLECTION_DATA_END _reflection_dat_end
+#endif
+
+// The same fragments merged with --nested hierarchical, see tests/CMakeLists.txt
+#ifdef __APPLE__
+extern const char reflection_dat_hierarchical[];
+#define REFLECTION_HIERARCHICAL_START reflection_dat_hierarchical
+#else
+extern const char _reflection_dat_hierarchical[];
+#define REFLECTION_HIERARCHICAL_START _reflection_dat_hierarchical
+#endif
+
+void test_mapped() {
+    assert(reflect_load_mapped(REFLECTION_DATA_START, REFLECTION_DATA_END - REFLECTION_DATA_START));
+
+    const reflect_mapped_type_t* t2d = reflect_mapped_type_from_name("struct_2d_t");
+    assert(t2d != NULL);
+    assert(t2d->variant == Struct);
+    assert(t2d->size == sizeof(struct_2d_t));
+    assert(strcmp(reflect_mapped_string(t2d->name), "struct_2d_t") == 0);
+
+    const reflect_mapped_field_t* nest_x = reflect_mapped_get_field_type(t2d, "nest.x");
+    assert(nest_x != NULL);
+    assert(nest_x->offset == offsetof(struct_2d_t, nest.x));
+    assert(strcmp(reflect_mapped_string(reflect_mapped_type_from_id(nest_x->type_id)->name), "int") == 0);
+    assert(reflect_mapped_get_field_type(t2d, "missing") == NULL);
+
+    size_t field_count = 0;
+    for (const reflect_mapped_field_t* it = reflect_mapped_field_iter_begin(t2d); it != reflect_mapped_field_iter_end(t2d); ++it)
+        field_count++;
+    assert(field_count == t2d->field_count);
+
+    const reflect_mapped_type_t* alias = reflect_mapped_type_from_name("reflect_typedef_alias_test");
+    assert(alias != NULL && alias == reflect_mapped_type_from_name("ReflectTypedefAliasTest"));
+
+    const reflect_mapped_type_t* enum_type = reflect_mapped_type_from_name("new_enum_t");
+    assert(enum_type != NULL);
+    const int64_t* value = reflect_mapped_get_enum_value(enum_type, "NEW_ENUM_B");
+    assert(value != NULL && *value == NEW_ENUM_B);
+
+    const reflect_mapped_type_t* status = reflect_mapped_type_from_name("status_enum_t");
+    assert(status != NULL && status->value_index != 0);
+    const reflect_mapped_enum_field_t* failed = reflect_mapped_enum_field_from_value(status, -1);
+    assert(failed != NULL && strcmp(reflect_mapped_string(failed->name), "STATUS_FAILED") == 0);
+    assert(reflect_mapped_enum_field_from_value(status, 5) == NULL);
+
+    assert(reflect_mapped_type_from_name("not_a_type") == NULL);
+    assert(!reflect_load_mapped(REFLECTION_DATA_START, 4));
+
+    printf("✅ test_mapped passed!\n");
+}
+
+void test_name_index() {
+    // every type name and field name must resolve to its own record through the perfect hash
+    size_t type_count = 0;
+
+    for (size_t id = 1; reflect_mapped_type_from_id(id) != NULL; id++) {
+        const reflect_mapped_type_t* type = reflect_mapped_type_from_id(id);
+        const char* name = reflect_mapped_string(type->name);
+
+        assert(reflect_mapped_type_from_name(name) == type);
+        assert(reflect_type_info_from_name(name)->id == id);
+
+        for (const reflect_mapped_field_t* it = reflect_mapped_field_iter_begin(type); it != reflect_mapped_field_iter_end(type); ++it) {
+            const char* field_name = reflect_mapped_string(it->name);
+
+            if (field_name[0] != 0)
+                assert(strcmp(reflect_mapped_string(reflect_mapped_get_field_type(type, field_name)->name), field_name) == 0);
+        }
+
+        type_count++;
+    }
+
+    assert(type_count > 0);
+    assert(reflect_type_info_from_name("struct_test_") == NULL);
+    assert(reflect_get_field_type(reflect_type_info_from_name("struct_test_t"), "ab") == NULL);
+
+    printf("✅ test_name_index passed!\n");
+}
+
+void test_name_handles() {
+    static const char* field_names[] = { "a", "b", "e" };
+    reflect_name_t handles[3];
+
+    for (size_t i = 0; i < 3; i++)
+        handles[i] = reflect_name(field_names[i]);
+
+    const reflect_name_t type_name = reflect_name("struct_test_t");
+    assert(type_name.length == strlen("struct_test_t"));
+
+    const type_info_t* struct_info = reflect_type_info_from_name_h(type_name);
+    assert(struct_info == reflect_type_info_from_name("struct_test_t"));
+
+    struct_test_t* test = reflect_alloc(struct_info, NULL, NULL);
+
+    // handles are hashed once and reused for every lookup
+    for (size_t i = 0; i < 3; i++) {
+        assert(reflect_get_field_type_h(struct_info, handles[i]) == reflect_get_field_type(struct_info, field_names[i]));
+        assert(reflect_get_field_h(test, handles[i]) == reflect_get_field(test, field_names[i]));
+        assert(reflect_get_field_manual_h(test, handles[i], struct_info) == reflect_get_field_h(test, handles[i]));
+    }
+
+    const int64_t* value = reflect_get_enum_value_h(reflect_type_info_from_name("enum_test_t"), reflect_name("ENUM_ONE"));
+    assert(value != NULL && *value == 1);
+
+    // a prefix of a stored name must not match
+    assert(reflect_type_info_from_name_h(reflect_name("struct_test")) == NULL);
+    assert(reflect_type_info_from_name_h(reflect_name(NULL)) == NULL);
+    assert(reflect_get_field_type_h(struct_info, reflect_name(NULL)) == NULL);
+
+    reflect_free(test, NULL, NULL);
+
+    printf("✅ test_name_handles passed!\n");
+}
+
+void test_paths() {
+    const type_info_t* path_info = reflect_type_info_from_name("path_test_t");
+    assert(path_info != NULL);
+
+    int row0[3] = { 0 }, row1[3] = { 0 };
+    int* rows[2] = { row0, row1 };
+    struct_2d_t inner = { .double_ptr = rows };
+    path_test_t value = { .inner = &inner };
+
+    reflect_path_t* item = reflect_path_compile(path_info, "items[2].b");
+    assert(item != NULL);
+    assert(reflect_path_get(item, &value) == &value.items[2].b);
+    assert(reflect_path_type(item) == reflect_type_info_from_name("int"));
+    assert(reflect_path_field(item) == reflect_get_field_type(reflect_type_info_from_name("struct_test_t"), "b"));
+
+    reflect_path_t* nested = reflect_path_compile(path_info, "inner->nest.x");
+    assert(reflect_path_get(nested, &value) == &inner.nest.x);
+
+    reflect_path_t* matrix = reflect_path_compile(path_info, "inner->matrix[4]");
+    assert(reflect_path_get(matrix, &value) == &inner.matrix[1][1]);
+
+    reflect_path_t* pointers = reflect_path_compile(path_info, "inner->double_ptr[1][2]");
+    assert(reflect_path_get(pointers, &value) == &row1[2]);
+
+    // NULL pointers on the way end the walk
+    value.inner = NULL;
+    assert(reflect_path_get(nested, &value) == NULL);
+
+    assert(reflect_path_compile(path_info, "items[4].b") == NULL); // out of bounds
+    assert(reflect_path_compile(path_info, "items.b") == NULL);    // array not indexed
+    assert(reflect_path_compile(path_info, "inner.nest") == NULL); // pointer without ->
+    assert(reflect_path_compile(path_info, "items[1].") == NULL);
+    assert(reflect_path_compile(path_info, "inner->double_ptr[-1]") == NULL);  // only digits index
+    assert(reflect_path_compile(path_info, "inner->double_ptr[ 1]") == NULL);
+    assert(reflect_path_compile(path_info, "inner->double_ptr[+1]") == NULL);
+    assert(reflect_path_compile(path_info, "inner->double_ptr[99999999999999999999]") == NULL);
+    assert(reflect_path_compile(path_info, "inner->double_ptr[4611686018427387904]") == NULL); // offset overflows
+    assert(reflect_path_compile(path_info, "missing") == NULL);
+
+    reflect_path_free(item);
+    reflect_path_free(nested);
+    reflect_path_free(matrix);
+    reflect_path_free(pointers);
+
+    printf("✅ test_paths passed!\n");
+}
+
+void test_gather_scatter() {
+    const type_info_t* struct_info = reflect_type_info_from_name("struct_test_t");
+    const type_info_t* union_info = reflect_type_info_from_name("union_test_t");
+    struct_test_t items[37];
+    union_test_t unions[11];
+    int values[37];
+    char chars[11][8];
+
+    for (int i = 0; i < 37; i++)
+        items[i] = (struct_test_t){ .a = i, .b = i * 3 };
+
+    // odd count so both the unrolled/vector body and the tail run
+    reflect_gather(struct_info, reflect_get_field_type(struct_info, "b"), items, 37, 0, values);
+    for (int i = 0; i < 37; i++)
+        assert(values[i] == i * 3);
+
+    for (int i = 0; i < 37; i++)
+        values[i] = -i;
+
+    reflect_scatter(struct_info, reflect_get_field_type(struct_info, "a"), items, 37, 0, values);
+    for (int i = 0; i < 37; i++)
+        assert(items[i].a == -i && items[i].b == i * 3);
+
+    // every second struct through an explicit stride
+    reflect_gather(struct_info, reflect_get_field_type(struct_info, "b"), items, 18, sizeof(struct_test_t) * 2, values);
+    for (int i = 0; i < 18; i++)
+        assert(values[i] == i * 6);
+
+    // char[8] array field, copied as a whole
+    for (int i = 0; i < 11; i++)
+        snprintf(unions[i].c, sizeof(unions[i].c), "u%d", i);
+
+    reflect_gather(union_info, reflect_get_field_type(union_info, "c"), unions, 11, 0, chars);
+    for (int i = 0; i < 11; i++)
+        assert(memcmp(chars[i], unions[i].c, 8) == 0);
+
+    printf("✅ test_gather_scatter passed!\n");
+}
+
+void test_soa() {
+    const type_info_t* t2d_info = reflect_type_info_from_name("struct_2d_t");
+    struct_2d_t rows[5];
+    int* pointers[5];
+
+    memset(rows, 0, sizeof(rows));
+    for (int i = 0; i < 5; i++) {
+        for (int j = 0; j < 6; j++)
+            rows[i].matrix[j / 3][j % 3] = i * 10 + j;
+        rows[i].double_ptr = &pointers[i];
+        rows[i].nest.x = i;
+        rows[i].nest.e = NEW_ENUM_B;
+    }
+
+    reflect_soa_t* soa = reflect_soa_from_aos(t2d_info, rows, 5, REFLECT_SOA_EXPLODE_ARRAYS);
+    assert(soa != NULL && soa->count == 5);
+    assert(soa->column_count == 6 + 1 + 2); // matrix elements, double_ptr, nest.x, nest.e
+    assert(reflect_soa_column(soa, "nest", 0) == NULL);
+
+    const reflect_soa_column_t* x = reflect_soa_column(soa, "nest.x", 0);
+    const reflect_soa_column_t* m4 = reflect_soa_column(soa, "matrix", 4);
+    const reflect_soa_column_t* ptr = reflect_soa_column(soa, "double_ptr", 0);
+    assert(((uintptr_t)x->data & 63) == 0);
+
+    for (int i = 0; i < 5; i++) {
+        assert(((int*)x->data)[i] == i);
+        assert(((int*)m4->data)[i] == i * 10 + 4);
+        assert(((int***)ptr->data)[i] == &pointers[i]);
+    }
+
+    for (int i = 0; i < 5; i++)
+        ((int*)x->data)[i] *= 2;
+
+    struct_2d_t copy[5];
+    memset(copy, 0, sizeof(copy));
+    reflect_soa_to_aos(soa, copy);
+
+    for (int i = 0; i < 5; i++) {
+        assert(copy[i].nest.x == i * 2);
+        assert(copy[i].nest.e == NEW_ENUM_B);
+        assert(copy[i].double_ptr == &pointers[i]);
+        assert(memcmp(copy[i].matrix, rows[i].matrix, sizeof(rows[i].matrix)) == 0);
+    }
+
+    reflect_soa_free(soa);
+
+    // without exploding, the array is one column of whole arrays
+    soa = reflect_soa_create(t2d_info, 5, 0);
+    assert(soa->column_count == 1 + 1 + 2);
+    assert(reflect_soa_column(soa, "matrix", 0)->size == sizeof(rows[0].matrix));
+    reflect_soa_free(soa);
+
+    // an embedded union is one column, its overlapping members get none
+    variant_test_t variants[3] = { { 0, { .i = 7 } }, { 1, { .s = "abc" } }, { 0, { .i = -1 } } };
+    soa = reflect_soa_from_aos(reflect_type_info_from_name("variant_test_t"), variants, 3, 0);
+    assert(soa->column_count == 2);
+    assert(reflect_soa_column(soa, "value", 0)->size == sizeof(variant_value_t));
+    assert(reflect_soa_column(soa, "value.s", 0) == NULL);
+    assert(reflect_soa_column(soa, "value.i", 0) == NULL);
+
+    variant_test_t variants_copy[3];
+    memset(variants_copy, 0, sizeof(variants_copy));
+    reflect_soa_to_aos(soa, variants_copy);
+    assert(variants_copy[0].value.i == 7 && variants_copy[1].value.s == variants[1].value.s && variants_copy[2].kind == 0);
+    reflect_soa_free(soa);
+
+    printf("✅ test_soa passed!\n");
+}
+
+void test_serialize() {
+    const type_info_t* info = reflect_type_info_from_name("serialize_test_t");
+    reflect_plan_t* plan = reflect_plan_compile(info);
+    assert(plan != NULL);
+
+    int pointee = 7;
+    int* pointee_ptr = &pointee;
+    struct_2d_t inner = { .matrix = { { 1, 2, 3 }, { 4, 5, 6 } }, .double_ptr = &pointee_ptr, .nest = { 9, NEW_ENUM_B } };
+    path_test_t path = { .inner = &inner, .items = { { 1, 2, ENUM_ONE }, [3] = { 3, 4, ENUM_THREE } } };
+    serialize_test_t second = { .name = NULL, .tag = 'b', .values = { 4, 5, 6 } };
+    serialize_test_t first = { .name = "first", .next = &second, .tag = 'a', .values = { 1, 2, 3 }, .path = &path, .u.i = 42 };
+
+    const size_t size = reflect_plan_serialize(plan, &first, NULL, 0);
+    assert(size > 0);
+
+    char* buf = malloc(size);
+    assert(reflect_plan_serialize(plan, &first, buf, size) == size);
+    assert(reflect_serialize(&first, info, buf, size) == size);
+
+    serialize_test_t copy;
+    memset(&copy, 0xff, sizeof(copy));
+    assert(reflect_plan_deserialize(plan, &copy, buf, size) == size);
+
+    assert(strcmp(copy.name, "first") == 0 && copy.name != first.name);
+    assert(copy.tag == 'a' && copy.values[2] == 3 && copy.u.i == 42);
+    assert(copy.next != NULL && copy.next->name == NULL && copy.next->next == NULL && copy.next->path == NULL);
+    assert(copy.next->tag == 'b' && copy.next->values[0] == 4);
+    assert(copy.path->items[3].b == 4 && copy.path->items[0].e == ENUM_ONE);
+    assert(copy.path->inner->matrix[1][2] == 6 && copy.path->inner->nest.x == 9);
+    assert(**copy.path->inner->double_ptr == 7 && copy.path->inner->double_ptr != inner.double_ptr);
+
+    reflect_plan_release(plan, &copy);
+
+    // truncated input fails and leaves nothing allocated behind
+    assert(reflect_plan_deserialize(plan, &copy, buf, size - 1) == 0);
+    assert(copy.name == NULL && copy.next == NULL && copy.path == NULL);
+
+    // a too small buffer reports the full size
+    char small[8];
+    assert(reflect_plan_serialize(plan, &first, small, sizeof(small)) == size);
+
+    free(buf);
+    reflect_plan_free(plan);
+
+    // types without pointers are a single copy
+    struct_test_t value = { 1, 2, ENUM_TWO }, value_copy;
+    const type_info_t* value_info = reflect_type_info_from_name("struct_test_t");
+    assert(reflect_serialize(&value, value_info, NULL, 0) == sizeof(value));
+
+    char value_buf[sizeof(value)];
+    reflect_serialize(&value, value_info, value_buf, sizeof(value_buf));
+    assert(reflect_deserialize(&value_copy, value_info, value_buf, sizeof(value_buf)) == sizeof(value));
+    assert(memcmp(&value, &value_copy, sizeof(value)) == 0);
+
+    // mutually recursive types, nodes embedded in a list still have their pointers followed
+    const type_info_t* tree_info = reflect_type_info_from_name("tree_test_t");
+    reflect_plan_t* tree_plan = reflect_plan_compile(tree_info);
+    assert(tree_plan != NULL);
+
+    tree_list_test_t leaves = { .items = { { NULL, 1 }, { NULL, 2 } } };
+    tree_list_test_t kids = { .items = { { &leaves, 7 }, { NULL, 9 } } };
+    tree_test_t tree = { &kids, 3 }, tree_copy;
+
+    const size_t tree_size = reflect_plan_serialize(tree_plan, &tree, NULL, 0);
+    char* tree_buf = malloc(tree_size);
+    assert(reflect_serialize(&tree, tree_info, tree_buf, tree_size) == tree_size);
+    assert(reflect_deserialize(&tree_copy, tree_info, tree_buf, tree_size) == tree_size);
+    assert(tree_copy.v == 3 && tree_copy.kids != &kids && tree_copy.kids->items[1].v == 9);
+    assert(tree_copy.kids->items[0].kids != &leaves && tree_copy.kids->items[1].kids == NULL);
+    assert(tree_copy.kids->items[0].kids->items[1].v == 2 && tree_copy.kids->items[0].kids->items[0].kids == NULL);
+
+    reflect_plan_release(tree_plan, &tree_copy);
+    free(tree_buf);
+    reflect_plan_free(tree_plan);
+
+    assert(reflect_plan_compile(NULL) == NULL);
+
+    printf("✅ test_serialize passed!\n");
+}
+
+void test_copy_equal_hash() {
+    const type_info_t* info = reflect_type_info_from_name("serialize_test_t");
+    reflect_plan_t* plan = reflect_plan_compile(info);
+    assert(plan != NULL);
+
+    int pointee = 7;
+    int* pointee_ptr = &pointee;
+    struct_2d_t inner = { .matrix = { { 1, 2, 3 }, { 4, 5, 6 } }, .double_ptr = &pointee_ptr, .nest = { 9, NEW_ENUM_B } };
+    path_test_t path = { .inner = &inner, .items = { [2] = { 5, 6, ENUM_TWO } } };
+    serialize_test_t second = { .name = "second", .tag = 'b' };
+
+    // different garbage in the padding after tag must not matter
+    serialize_test_t a, b;
+    memset(&a, 0x11, sizeof(a));
+    memset(&b, 0x22, sizeof(b));
+    a.name = b.name = "first";
+    a.next = b.next = &second;
+    a.tag = b.tag = 'a';
+    a.values[0] = b.values[0] = 1;
+    a.values[1] = b.values[1] = 2;
+    a.values[2] = b.values[2] = 3;
+    a.path = b.path = &path;
+    memset(&a.u, 0, sizeof(a.u));
+    memset(&b.u, 0, sizeof(b.u));
+    a.u.i = b.u.i = 42;
+
+    assert(reflect_plan_equal(plan, &a, &b, 0));
+    assert(reflect_plan_hash(plan, &a, 0) == reflect_plan_hash(plan, &b, 0));
+    assert(reflect_equal(&a, &b, info, REFLECT_DEEP));
+    assert(reflect_hash(&a, info, REFLECT_DEEP) == reflect_hash(&b, info, REFLECT_DEEP));
+
+    b.values[1] = 5;
+    assert(!reflect_plan_equal(plan, &a, &b, 0));
+    assert(reflect_plan_hash(plan, &a, 0) != reflect_plan_hash(plan, &b, 0));
+    b.values[1] = 2;
+
+    // a deep copy duplicates every pointee, shallow equality then sees different addresses
+    serialize_test_t copy;
+    assert(reflect_plan_copy(plan, &copy, &a, REFLECT_DEEP));
+    assert(copy.name != a.name && copy.next != a.next && copy.path != a.path && copy.path->inner != &inner);
+    assert(strcmp(copy.next->name, "second") == 0 && copy.path->items[2].b == 6);
+    assert(**copy.path->inner->double_ptr == 7 && *copy.path->inner->double_ptr != pointee_ptr);
+    assert(!reflect_plan_equal(plan, &a, &copy, 0));
+    assert(reflect_plan_equal(plan, &a, &copy, REFLECT_DEEP));
+    assert(reflect_plan_hash(plan, &a, REFLECT_DEEP) == reflect_plan_hash(plan, &copy, REFLECT_DEEP));
+
+    copy.path->inner->nest.x = 10;
+    assert(!reflect_plan_equal(plan, &a, &copy, REFLECT_DEEP));
+    assert(reflect_plan_hash(plan, &a, REFLECT_DEEP) != reflect_plan_hash(plan, &copy, REFLECT_DEEP));
+    reflect_plan_release(plan, &copy);
+
+    // a shallow copy shares the pointees
+    assert(reflect_copy(&copy, &a, info, 0));
+    assert(copy.name == a.name && copy.path == a.path && reflect_plan_equal(plan, &a, &copy, 0));
+
+    // NULL against a present pointee
+    b.next = NULL;
+    assert(!reflect_plan_equal(plan, &a, &b, REFLECT_DEEP));
+
+    reflect_plan_free(plan);
+
+    // recursive types, the nodes embedded in a list are compared, hashed and copied deeply too
+    const type_info_t* tree_info = reflect_type_info_from_name("tree_test_t");
+    tree_list_test_t leaves = { .items = { { NULL, 7 }, { NULL, 9 } } };
+    tree_list_test_t other_leaves = { .items = { { NULL, 100 }, { NULL, 200 } } };
+    tree_list_test_t kids = { .items = { { &leaves, 1 }, { NULL, 2 } } };
+    tree_list_test_t other_kids = { .items = { { &other_leaves, 1 }, { NULL, 2 } } };
+    tree_test_t tree = { &kids, 3 }, other_tree = { &other_kids, 3 }, tree_copy;
+
+    assert(!reflect_equal(&tree, &other_tree, tree_info, REFLECT_DEEP));
+    assert(reflect_hash(&tree, tree_info, REFLECT_DEEP) != reflect_hash(&other_tree, tree_info, REFLECT_DEEP));
+
+    assert(reflect_copy(&tree_copy, &tree, tree_info, REFLECT_DEEP));
+    assert(tree_copy.kids != &kids && tree_copy.kids->items[0].kids != &leaves);
+    assert(tree_copy.kids->items[0].kids->items[1].v == 9);
+    assert(reflect_equal(&tree, &tree_copy, tree_info, REFLECT_DEEP));
+    assert(reflect_hash(&tree, tree_info, REFLECT_DEEP) == reflect_hash(&tree_copy, tree_info, REFLECT_DEEP));
+
+    reflect_plan_t* tree_plan = reflect_plan_compile(tree_info);
+    reflect_plan_release(tree_plan, &tree_copy);
+    reflect_plan_free(tree_plan);
+
+    printf("✅ test_copy_equal_hash passed!\n");
+}
+
+void test_delta() {
+    const type_info_t* info = reflect_type_info_from_name("struct_2d_t");
+    reflect_delta_plan_t* plan = reflect_delta_plan_compile(info);
+    assert(plan != NULL);
+
+    struct_2d_t old, new;
+    memset(&old, 0, sizeof(old));
+    old.nest.x = 1;
+    new = old;
+
+    uint64_t mask[REFLECT_DELTA_MASK_WORDS(5)];
+    assert(reflect_delta_plan_diff(plan, &old, &new, mask) == 0 && mask[0] == 0);
+
+    // nest.x and nest.e lie inside nest, only nest (field 2) is reported
+    new.matrix[1][2] = 6;
+    new.nest.e = NEW_ENUM_B;
+    assert(reflect_delta_plan_diff(plan, &old, &new, mask) == 2);
+    assert(mask[0] == ((1u << 0) | (1u << 2)));
+    assert(reflect_diff(info, &old, &new, mask) == 2);
+
+    char patch[64];
+    const size_t size = reflect_delta_plan_encode(plan, &old, &new, patch, sizeof(patch));
+    assert(size == 1 + sizeof(old.matrix) + 1 + sizeof(old.nest) + 1);
+    assert(reflect_delta_encode(info, &old, &new, NULL, 0) == size);
+
+    struct_2d_t target = old;
+    assert(reflect_delta_plan_apply(plan, &target, patch, size) == size);
+    assert(memcmp(&target, &new, sizeof(new)) == 0);
+
+    // a truncated patch is rejected without touching the value
+    target = old;
+    assert(reflect_delta_apply(info, &target, patch, size - 1) == 0);
+    assert(memcmp(&target, &old, sizeof(old)) == 0);
+
+    // a patch of equal values is just the terminator
+    assert(reflect_delta_plan_encode(plan, &new, &new, patch, sizeof(patch)) == 1);
+    reflect_delta_plan_free(plan);
+
+    // padding is not a change and union members are covered by the widest one
+    const type_info_t* serialize_info = reflect_type_info_from_name("serialize_test_t");
+    serialize_test_t a, b;
+    memset(&a, 0x11, sizeof(a));
+    memset(&b, 0x22, sizeof(b));
+    a.name = b.name = NULL;
+    a.next = b.next = NULL;
+    a.tag = b.tag = 'a';
+    memset(a.values, 0, sizeof(a.values));
+    memset(b.values, 0, sizeof(b.values));
+    a.path = b.path = NULL;
+    memset(&a.u, 0, sizeof(a.u));
+    b.u = a.u;
+    assert(reflect_diff(serialize_info, &a, &b, mask) == 0);
+
+    b.u.i = 3;
+    const type_info_t* union_info = reflect_type_info_from_name("union_test_t");
+    assert(reflect_diff(union_info, &a.u, &b.u, mask) == 1 && mask[0] == (1u << 2));
+
+    printf("✅ test_delta passed!\n");
+}
+
+typedef struct {
+    char data[512];
+    size_t size;
+} json_sink_t;
+
+static bool json_sink_flush(void* user, const char* data, size_t size) {
+    json_sink_t* sink = user;
+    if (sink->size + size >= sizeof(sink->data))
+        return false;
+    memcpy(sink->data + sink->size, data, size);
+    sink->size += size;
+    sink->data[sink->size] = 0;
+    return true;
+}
+
+void test_json() {
+    const type_info_t* t2d_info = reflect_type_info_from_name("struct_2d_t");
+    int pointee = 7;
+    int* pointee_ptr = &pointee;
+    struct_2d_t value = { .matrix = { { 1, 2, 3 }, { 4, 5, -6 } }, .double_ptr = &pointee_ptr, .nest = { 9, NEW_ENUM_B } };
+
+    // a tiny buffer forces flushes in the middle of keys and numbers
+    char small[7];
+    json_sink_t sink = { .size = 0 };
+    reflect_json_writer_t writer = { .buf = small, .size = sizeof(small), .flush = json_sink_flush, .user = &sink };
+
+    assert(reflect_json_write(&value, t2d_info, &writer));
+    assert(reflect_json_flush(&writer));
+    assert(strcmp(sink.data, "{\"matrix\":[1,2,3,4,5,-6],\"double_ptr\":7,\"nest\":{\"x\":9,\"e\":\"NEW_ENUM_B\"}}") == 0);
+
+    // without a flush callback a full buffer fails the write
+    reflect_json_writer_t fixed = { .buf = small, .size = sizeof(small) };
+    assert(!reflect_json_write(&value, t2d_info, &fixed));
+
+    // keys in any order, unknown keys, whitespace and enums by number
+    const char* text = " {\"nest\": {\"e\": 10, \"x\": -3}, \"unknown\": [1, {\"a\": null}],\n"
+                       "  \"matrix\": [6, 5], \"double_ptr\": null} {\"nest\":{\"e\":\"NEW_ENUM_B\"}}";
+    reflect_json_reader_t reader = { .data = text, .size = strlen(text) };
+    struct_2d_t parsed = value;
+
+    assert(reflect_json_read(&reader, &parsed, t2d_info));
+    assert(parsed.nest.x == -3 && parsed.nest.e == NEW_ENUM_A && parsed.double_ptr == NULL);
+    assert(parsed.matrix[0][0] == 6 && parsed.matrix[0][1] == 5 && parsed.matrix[0][2] == 3);
+
+    // the reader continues after the first value
+    assert(reflect_json_read(&reader, &parsed, t2d_info));
+    assert(parsed.nest.e == NEW_ENUM_B && parsed.nest.x == -3);
+
+    const char* bad = "{\"nest\":{\"e\":\"NEW_ENUM_C\"}}";
+    reflect_json_reader_t bad_reader = { .data = bad, .size = strlen(bad) };
+    assert(!reflect_json_read(&bad_reader, &parsed, t2d_info) && bad_reader.pos == 0);
+
+    // floats are written in their shortest form that reads back the same
+    const type_info_t* union_info = reflect_type_info_from_name("union_test_t");
+    union_test_t u = { .f = 0.1f };
+    char union_buf[128];
+    reflect_json_writer_t union_writer = { .buf = union_buf, .size = sizeof(union_buf) - 1 };
+
+    assert(reflect_json_write(&u, union_info, &union_writer));
+    union_buf[union_writer.pos] = 0;
+    assert(strstr(union_buf, "\"f\":0.1,") != NULL);
+
+    const char* union_text = "{\"f\": -2.25e1}";
+    reflect_json_reader_t union_reader = { .data = union_text, .size = strlen(union_text) };
+    assert(reflect_json_read(&union_reader, &u, union_info) && u.f == -22.5f);
+
+    // pointers are followed and allocated when read back
+    const type_info_t* info = reflect_type_info_from_name("serialize_test_t");
+    reflect_json_plan_t* plan = reflect_json_plan_compile(info);
+    assert(plan != NULL);
+
+    serialize_test_t second = { .name = "tab\there \"quoted\"", .tag = 'b', .values = { 4, 5, 6 } };
+    serialize_test_t first = { .name = "first", .next = &second, .tag = 'a', .values = { 1, 2, 3 }, .u.c = "union" };
+
+    char buf[1024];
+    reflect_json_writer_t buf_writer = { .buf = buf, .size = sizeof(buf) };
+    assert(reflect_json_plan_write(plan, &first, &buf_writer));
+
+    serialize_test_t copy;
+    memset(&copy, 0xff, sizeof(copy));
+    reflect_json_reader_t copy_reader = { .data = buf, .size = buf_writer.pos };
+
+    assert(reflect_json_plan_read(plan, &copy_reader, &copy) && copy_reader.pos == buf_writer.pos);
+    assert(strcmp(copy.name, "first") == 0 && copy.tag == 'a' && copy.values[2] == 3 && copy.path == NULL);
+    assert(strcmp(copy.u.c, "union") == 0);
+    assert(copy.next != NULL && strcmp(copy.next->name, second.name) == 0 && copy.next->values[0] == 4);
+    assert(copy.next->next == NULL);
+
+    reflect_json_plan_release(plan, &copy);
+    assert(copy.name == NULL && copy.next == NULL);
+    reflect_json_plan_free(plan);
+
+    // a pointer in a union may be another member's bytes, it is neither followed, read nor released
+    const type_info_t* variant_info = reflect_type_info_from_name("variant_test_t");
+    variant_test_t variant = { .kind = 0, .value.i = 12345 };
+    char variant_buf[128];
+    reflect_json_writer_t variant_writer = { .buf = variant_buf, .size = sizeof(variant_buf) - 1 };
+
+    assert(reflect_json_write(&variant, variant_info, &variant_writer));
+    variant_buf[variant_writer.pos] = 0;
+    assert(strcmp(variant_buf, "{\"kind\":0,\"value\":{\"i\":12345}}") == 0);
+
+    const char* variant_text = "{\"kind\":1,\"value\":{\"s\":\"abc\",\"i\":7}}";
+    reflect_json_reader_t variant_reader = { .data = variant_text, .size = strlen(variant_text) };
+    plan = reflect_json_plan_compile(variant_info);
+    assert(reflect_json_plan_read(plan, &variant_reader, &variant) && variant.kind == 1 && variant.value.i == 7);
+    reflect_json_plan_release(plan, &variant);
+    assert(variant.value.i == 7);
+    reflect_json_plan_free(plan);
+
+    // recursive types, the lists inside embedded nodes are released too (ASan reports leaks otherwise)
+    const type_info_t* tree_info = reflect_type_info_from_name("tree_test_t");
+    const char* tree_text = "{\"kids\":{\"items\":[{\"kids\":{\"items\":[{\"v\":5},{\"v\":6}]},\"v\":1},{\"v\":2}]},\"v\":3}";
+    reflect_json_reader_t tree_reader = { .data = tree_text, .size = strlen(tree_text) };
+    tree_test_t tree;
+    memset(&tree, 0, sizeof(tree));
+    plan = reflect_json_plan_compile(tree_info);
+    assert(reflect_json_plan_read(plan, &tree_reader, &tree) && tree.v == 3 && tree.kids->items[1].v == 2);
+    assert(tree.kids->items[0].kids->items[1].v == 6 && tree.kids->items[0].kids->items[0].kids == NULL);
+    reflect_json_plan_release(plan, &tree);
+    assert(tree.kids == NULL);
+    reflect_json_plan_free(plan);
+
+    printf("✅ test_json passed!\n");
+}
+
+void test_batched_lookup() {
+    // more names than one batch round, hits interleaved with misses
+    const char* names[40];
+    const type_info_t* out[40];
+    size_t expected = 0;
+
+    for (size_t i = 0; i < 40; i++) {
+        const type_info_t* type = reflect_type_info_from_id(i / 2 + 1);
+
+        if (i % 2 == 0 && type != NULL) {
+            names[i] = type->name;
+            expected++;
+        } else {
+            names[i] = i % 3 == 0 ? NULL : "struct_test_";
+        }
+    }
+
+    assert(reflect_type_info_from_names(names, 40, out) == expected);
+
+    for (size_t i = 0; i < 40; i++)
+        assert(out[i] == (names[i] == NULL ? NULL : reflect_type_info_from_name(names[i])));
+
+    const type_info_t* struct_info = reflect_type_info_from_name("struct_test_t");
+    const char* field_names[] = { "e", "a", "x", "b" };
+    const field_info_t* fields[4];
+
+    assert(reflect_get_field_types(struct_info, field_names, 4, fields) == 3);
+    assert(fields[0] == reflect_get_field_type(struct_info, "e"));
+    assert(fields[1] == reflect_get_field_type(struct_info, "a"));
+    assert(fields[2] == NULL);
+    assert(fields[3] == reflect_get_field_type(struct_info, "b"));
+
+    printf("✅ test_batched_lookup passed!\n");
+}
+
+void test_contexts() {
+    reflect_context_t* plugin = reflect_context_create();
+    reflect_context_load_bytes(plugin, (char*)REFLECTION_DATA_START, true);
+
+    // same blob, separate tables
+    const type_info_t* own = reflect_ctx_type_info_from_name(plugin, "struct_test_t");
+    const type_info_t* global = reflect_type_info_from_name("struct_test_t");
+    assert(own != NULL && global != NULL && own != global);
+    assert(reflect_ctx_type_info_from_id(plugin, own->id) == own);
+    assert(reflect_get_field_type(own, "b")->offset == reflect_get_field_type(global, "b")->offset);
+    assert(reflect_get_field_type(own, "e")->type_ptr == reflect_ctx_type_info_from_name(plugin, "enum_test_t"));
+    assert(reflect_context_memory_usage(plugin).reserved > reflect_memory_usage().reserved);
+
+    // an empty context chained to the default one resolves through it
+    reflect_context_t* chained = reflect_context_create();
+    assert(reflect_ctx_type_info_from_name(chained, "struct_test_t") == NULL);
+    assert(reflect_context_set_parent(chained, reflect_context_default()));
+    assert(reflect_ctx_type_info_from_name(chained, "struct_test_t") == global);
+    assert(!reflect_context_set_parent(reflect_context_default(), chained));
+
+    assert(reflect_context_set_parent(chained, plugin));
+    assert(reflect_ctx_type_info_from_name(chained, "struct_test_t") == own);
+
+    // pooled objects outlive an unload and get their type back with the next load
+    struct_test_t* pooled = reflect_alloc(own, NULL, NULL);
+    assert(pooled != NULL && reflect_get_type_info(pooled) == own);
+    reflect_context_unload(plugin);
+    pooled->a = 42;
+    assert(reflect_get_type_info(pooled) == NULL);
+    reflect_context_load_bytes(plugin, (char*)REFLECTION_DATA_START, true);
+    own = reflect_ctx_type_info_from_name(plugin, "struct_test_t");
+    struct_test_t* reloaded = reflect_alloc(own, NULL, NULL);
+    assert(reloaded != pooled && reflect_get_type_info(reloaded) == own);
+    assert(reflect_get_type_info(pooled) == own && pooled->a == 42);
+    reflect_free(reloaded, NULL, NULL);
+    reflect_free(pooled, NULL, NULL);
+
+    reflect_context_destroy(chained);
+    reflect_context_destroy(plugin);
+
+    printf("✅ test_contexts passed!\n");
+}
+
+void test_hierarchical() {
+    reflect_context_t* ctx = reflect_context_create();
+    reflect_context_load_bytes(ctx, (char*)REFLECTION_HIERARCHICAL_START, true);
+
+    const type_info_t* flattened = reflect_type_info_from_name("struct_2d_t");
+    const type_info_t* nested = reflect_ctx_type_info_from_name(ctx, "struct_2d_t");
+
+    // matrix, double_ptr, nest and the flattened nest.x, nest.e
+    assert(flattened->field_count == 5);
+    assert(nested->field_count == 3);
+    assert(strcmp(reflect_field_info_iter_begin(nested)[2].name, "nest") == 0);
+
+    // dotted names resolve through the type of nest
+    const field_info_t* nest_e = reflect_get_field_type(nested, "nest.e");
+    assert(nest_e != NULL);
+    assert(nest_e->offset == offsetof(struct_2d_t, nest.e));
+    assert(nest_e->type_ptr == reflect_ctx_type_info_from_name(ctx, "new_enum_t"));
+    assert(reflect_get_field_type(nested, "nest.y") == NULL);
+    assert(reflect_get_field_type(nested, "matrix.x") == NULL);
+
+    struct_2d_t value;
+    assert(reflect_get_field_manual(&value, "nest.x", nested) == &value.nest.x);
+    assert(reflect_get_field_manual(&value, "nest.e", nested) == &value.nest.e);
+    assert(reflect_get_field_manual(&value, "nest.", nested) == NULL);
+
+    const char* names[] = { "double_ptr", "nest.x", "nest.z" };
+    const field_info_t* found[3];
+    assert(reflect_get_field_types(nested, names, 3, found) == 2);
+    assert(found[1]->offset == offsetof(struct_2d_t, nest.x) && found[2] == NULL);
+
+    // the flat view matches the flattened blob, which it only wraps
+    const field_info_t* flat = reflect_field_info_flat_begin(nested);
+    const field_info_t* expected = reflect_field_info_flat_begin(flattened);
+    assert(expected == reflect_field_info_iter_begin(flattened));
+    assert(reflect_field_info_flat_end(nested) - flat == 5);
+    assert(reflect_field_info_flat_end(flattened) - expected == 5);
+
+    for (size_t i = 0; i < 5; i++) {
+        assert(strcmp(flat[i].name, expected[i].name) == 0);
+        assert(flat[i].offset == expected[i].offset);
+        assert(flat[i].type_ptr->size == expected[i].type_ptr->size);
+    }
+
+    // embedded structs of anonymous type have no type to reference and stay flattened
+    assert(reflect_ctx_type_info_from_name(ctx, "anon_test_t")->field_count == reflect_type_info_from_name("anon_test_t")->field_count);
+
+    reflect_soa_t* soa = reflect_soa_create(nested, 4, 0);
+    reflect_soa_t* expected_soa = reflect_soa_create(flattened, 4, 0);
+    assert(soa->column_count == expected_soa->column_count);
+    assert(reflect_soa_column(soa, "nest.e", 0) != NULL);
+    reflect_soa_free(soa);
+    reflect_soa_free(expected_soa);
+
+    reflect_context_destroy(ctx);
+
+    printf("✅ test_hierarchical passed!\n");
+}
+
+void test_unload() {
+    const reflect_memory_usage_t usage = reflect_memory_usage();
+    assert(usage.reserved > 0);
+    assert(usage.used <= usage.reserved);
+
+    reflect_unload();
+    assert(reflect_type_info_from_name("struct_test_t") == NULL);
+    assert(reflect_memory_usage().reserved == 0);
+
+    reflect_load();
+    assert(reflect_memory_usage().reserved == usage.reserved);
+
+    const type_info_t* struct_info = reflect_type_info_from_name("struct_test_t");
+    assert(struct_info != NULL);
+    assert(reflect_get_field_type(struct_info, "b")->offset == 4);
+
+    printf("✅ test_unload passed!\n");
+}
+
+// tests/test_generated.c, built after merge.py has written reflect_generated.h
+void test_generated();
+
 int main() {
     reflect_load();
 
     test_type_info();
     test_alloc_free();
+    test_pools();
+    test_arenas();
     test_enum_reflection();
     test_field_info();
 
@@ -320,10 +1370,26 @@ int main() {
     test_new_enum_reflection();
 
     test_enum_field_iteration();
+    test_enum_names();
     test_union_reflection();
 
     test_aliases();
     test_anon();
+    test_mapped();
+    test_name_index();
+    test_name_handles();
+    test_generated();
+    test_paths();
+    test_gather_scatter();
+    test_soa();
+    test_serialize();
+    test_copy_equal_hash();
+    test_delta();
+    test_json();
+    test_batched_lookup();
+    test_contexts();
+    test_hierarchical();
+    test_unload();
 
     printf("🎉 All tests passed!\n");
     return 0;